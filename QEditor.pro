@@ -15,20 +15,34 @@ QTPLUGIN += qtvirtualkeyboardplugin
 RC_ICONS = QEditorIcon.ico
 
 HEADERS       = \
+    include/common/AhoCorasick.h \
     include/common/Constants.h \
+    include/common/FenwickTree.h \
     include/common/Logger.h \
+    include/common/OffsetTracker.h \
     include/common/RangeMap.h \
     include/common/Settings.h \
     include/common/SingleApp.h \
+    include/common/TextSearch.h \
     include/common/Utils.h \
     include/diff/diff_match_patch_stl.h \
 #    include/diff/diff_match_patch/diff_match_patch.h \
     include/diff/Diff.h \
+    include/file/AutoSaveJournal.h \
+    include/file/BatchFileOpener.h \
     include/file/FileEncoding.h \
+    include/file/FileFollower.h \
+    include/file/FileLoader.h \
     include/file/FileRecorder.h \
+    include/file/FileSaver.h \
+    include/file/FileSearcher.h \
     include/file/FileType.h \
+    include/file/LineIndex.h \
+    include/file/PieceTable.h \
+    include/file/RawByteCache.h \
     include/file/RecentFiles.h \
     include/file/SearchTargets.h \
+    include/file/StreamDecompressor.h \
     include/hierarchy/AnfNodeHierarchy.h \
     include/hierarchy/AnfNodeHierarchyScene.h \
     include/hierarchy/AnfNodeItem.h \
@@ -40,18 +54,24 @@ HEADERS       = \
     include/hierarchy/NodeItem.h \
     include/parser/IParser.h \
     include/parser/IrParser.h \
+    include/view/BracketIndex.h \
+    include/view/CapabilityManager.h \
     include/view/ComboView.h \
     include/view/DiffView.h \
     include/view/DockView.h \
     include/view/EditView.h \
     include/view/ExplorerTreeView.h \
     include/view/GotoLineDialog.h \
+    include/view/HighlightOverlay.h \
+    include/view/LargeFileView.h \
     include/view/MainTabView.h \
     include/view/MainWindow.h \
+    include/view/MarkScanner.h \
+    include/view/MiniMap.h \
     include/view/OutlineList.h \
     include/view/SearchDialog.h \
-    include/view/SearchResultItem.h \
     include/view/SearchResultList.h \
+    include/view/SearchResultModel.h \
     include/view/TextHighlighter.h \
     include/view/Toast.h \
     include/win/WinTheme.h \
@@ -66,14 +86,27 @@ HEADERS       = \
 
 SOURCES       = \
     src/Entry.cpp \
+    src/common/AhoCorasick.cpp \
     src/common/Constants.cpp \
+    src/common/OffsetTracker.cpp \
     src/common/Settings.cpp \
+    src/common/TextSearch.cpp \
 #    src/diff/diff_match_patch/diff_match_patch.cpp \
     src/diff/Diff.cpp \
+    src/file/AutoSaveJournal.cpp \
+    src/file/BatchFileOpener.cpp \
     src/file/FileEncoding.cpp \
+    src/file/FileFollower.cpp \
+    src/file/FileLoader.cpp \
     src/file/FileRecorder.cpp \
+    src/file/FileSaver.cpp \
+    src/file/FileSearcher.cpp \
+    src/file/LineIndex.cpp \
+    src/file/PieceTable.cpp \
+    src/file/RawByteCache.cpp \
     src/file/RecentFiles.cpp \
     src/file/SearchTargets.cpp \
+    src/file/StreamDecompressor.cpp \
     src/hierarchy/AnfNodeHierarchy.cpp \
     src/hierarchy/AnfNodeHierarchyScene.cpp \
     src/hierarchy/AnfNodeItem.cpp \
@@ -84,18 +117,24 @@ SOURCES       = \
     src/hierarchy/HierarchyScene.cpp \
     src/hierarchy/NodeItem.cpp \
     src/parser/IrParser.cpp \
+    src/view/BracketIndex.cpp \
+    src/view/CapabilityManager.cpp \
     src/view/ComboView.cpp \
     src/view/DiffView.cpp \
     src/view/DockView.cpp \
     src/view/EditView.cpp \
     src/view/ExplorerTreeView.cpp \
     src/view/GotoLineDialog.cpp \
+    src/view/HighlightOverlay.cpp \
+    src/view/LargeFileView.cpp \
     src/view/MainTabView.cpp \
     src/view/MainWindow.cpp \
+    src/view/MarkScanner.cpp \
+    src/view/MiniMap.cpp \
     src/view/OutlineList.cpp \
     src/view/SearchDialog.cpp \
-    src/view/SearchResultItem.cpp \
     src/view/SearchResultList.cpp \
+    src/view/SearchResultModel.cpp \
     src/view/TextHighlighter.cpp \
     src/view/Toast.cpp \
     ansiescapecodehandler.cpp \
@@ -107,6 +146,21 @@ SOURCES       = \
 #    src/view/TerminalView.cpp \
 
 
+# Optional decompression backends for opening compressed files.
+CONFIG += link_pkgconfig
+packagesExist(zlib) {
+    PKGCONFIG += zlib
+    DEFINES += HAVE_ZLIB
+}
+packagesExist(libzstd) {
+    PKGCONFIG += libzstd
+    DEFINES += HAVE_ZSTD
+}
+packagesExist(liblzma) {
+    PKGCONFIG += liblzma
+    DEFINES += HAVE_LZMA
+}
+
 RESOURCES = QEditor.qrc
 
 TRANSLATIONS = \
@@ -0,0 +1,59 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AHOCORASICK_H
+#define AHOCORASICK_H
+
+#include <QString>
+#include <QVector>
+#include <utility>
+#include <vector>
+
+namespace QEditor {
+// Multi-pattern automaton, to find all patterns in one pass of the text.
+// Case sensitive, and the empty patterns are ignored.
+class AhoCorasick {
+   public:
+    static constexpr int kRoot = 0;
+
+    AhoCorasick() = default;
+    explicit AhoCorasick(const QVector<QString> &patterns);
+
+    // No pattern to find.
+    bool empty() const { return nodes_.size() == 1; }
+    int patternCount() const { return static_cast<int>(patternLengths_.size()); }
+    int patternLength(int index) const { return patternLengths_[index]; }
+
+    // The state after 'ch' is read in 'state'.
+    int Next(int state, char16_t ch) const;
+    // Indexes of the patterns ending at 'state'.
+    const std::vector<int> &Matches(int state) const { return nodes_[state].matches; }
+
+   private:
+    struct Node {
+        std::vector<std::pair<char16_t, int>> children;  // Sorted by char.
+        int fail{kRoot};
+        std::vector<int> matches;  // Including the ones of the fail states.
+    };
+
+    int Child(int state, char16_t ch) const;
+
+    std::vector<Node> nodes_ = std::vector<Node>(1);
+    std::vector<int> patternLengths_;
+};
+}  // namespace QEditor
+
+#endif  // AHOCORASICK_H
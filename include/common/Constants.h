@@ -32,6 +32,7 @@ constexpr auto kAppInternalRecentFilesDirName = ".recent_files";
 constexpr auto kAppInternalRecentFilesFileName = "recent_files";
 constexpr auto kAppInternalSearchTargetsDirName = ".search_targets";
 constexpr auto kAppInternalSearchTargetsFileName = "search_targets";
+constexpr auto kAppInternalLineIndexDirName = ".line_index";
 constexpr auto kAppInternalSingleRunFile = ".single_lock";
 constexpr auto kConfigFile = ".config.ini";
 
@@ -39,11 +40,6 @@ constexpr auto kAppInternalLogsRelativePath = "logs/";
 
 constexpr auto kSingleAppHostName = "QEditor::SingleApp";
 
-constexpr auto kMaxExtraSelectionsMarkCount = 2000;
-
-constexpr auto kMaxCharsNumToPairBracket = 20000;
-constexpr auto kMaxRecursiveDepthToPairBracket = 10;
-
 constexpr auto kMaxOpenRecentFilesNum = 100;
 constexpr auto kMaxSearchTargetsNum = 20;
 
@@ -58,12 +54,54 @@ extern QString kAppInternalPath;  // Should initialize once when startup.
 extern qreal kMonoSingleSpace;
 
 constexpr auto kMaxParseFileSize = 15000000;  // ~15M
-constexpr auto kMaxParseLineNum = 50000;
+
+// The rich features are tiered by the cost measured on this machine, see CapabilityManager.
+constexpr auto kCapabilityFullBudget = 100;         // ms, to run at once.
+constexpr auto kCapabilityBackgroundBudget = 5000;  // ms, to run deferred or in worker thread.
+constexpr auto kCapabilityMinSampleChars = 65536;   // Chars of a run to measure the cost.
+// The chars fitting the background budget before the cost measured.
 constexpr auto kMaxParseCharNum = 9000000;
+constexpr auto kMaxHighlightScrollbarCharNum = 256000000;
+
+constexpr auto kParseDelay = 500;  // ms, parse after the editing settles in background tier.
+
+constexpr auto kMiniMapWidth = 80;                 // px
+constexpr auto kMaxMiniMapInlineBlocks = 10000;  // Summarize more changed blocks in worker thread.
+
+constexpr auto kSearchChunkSize = 1 << 20;  // Chars, to stream the matches of finding all.
+
+constexpr auto kFindInFilesFrameInterval = 100;                  // ms, to pass the matches of the files.
+constexpr auto kFindInFilesDefaultMaxSize = 64LL * 1024 * 1024;  // Bytes, the larger files are skipped.
+constexpr auto kFindInFilesBinaryCheckSize = 8000;               // Bytes of the head to check NUL.
+
+constexpr auto kSearchResultFetchSize = 1000;     // Hits added as rows at once, when scrolled to the end.
+constexpr auto kMaxSearchResultLineLength = 500;  // Chars of a line to list.
+
+constexpr auto kSelectionCountDelay = 150;        // ms, count the selected text after the selection settles.
+constexpr auto kMaxSelectionCountLength = 10000;  // Chars of the selected text to count.
+
+constexpr auto kMaxLargeFileLineDisplayBytes = 10000;
+constexpr auto kMaxLineIndexCacheNum = 20;
+constexpr auto kLargeFileSearchWindowSize = 64 * 1024 * 1024;  // Bytes read at once to search the edited text.
+constexpr auto kEncodingHeadSampleSize = 1000000;              // ~1M, if the file can't be mapped.
+
+constexpr auto kEncodingSampleWindowCount = 8;
+constexpr auto kEncodingSampleWindowSize = 64 * 1024;
+
+constexpr auto kFileLoadFirstChunkSize = 32 * 1024;  // Enough for the first screen.
+constexpr auto kFileLoadChunkSize = 256 * 1024;
+constexpr auto kFileFollowPollInterval = 1000;  // ms
+constexpr auto kSaveEncodeChunkSize = 1000000;  // Chars encoded by one thread at least.
+constexpr auto kTabPrefetchInterval = 200;      // ms, to restore the next tab of last session.
+
+constexpr auto kAutoSaveFlushInterval = 1000;       // ms
+constexpr auto kAutoSaveJournalMaxRecordNum = 512;  // Compact the journal into base if exceeds.
+constexpr auto kAutoSaveJournalMaxSize = 1024 * 1024;
+
+constexpr auto kBatchOpenFrameInterval = 16;  // ms
+constexpr auto kBatchOpenFrameBudget = 8;     // ms, to add the decoded files as tabs in one frame.
 
-constexpr auto kMaxHighlightScrollbarFileSize = 5000000;  // ~15M
-constexpr auto kMaxHighlightScrollbarLineNum = 10000;
-constexpr auto kMaxHighlightScrollbarCharNum = 1000000;
+constexpr auto kRawByteCacheMaxSize = 64 * 1024 * 1024;  // Compressed raw bytes of loaded files.
 
 constexpr auto kCodecMibBom = "BOM";
 }  // namespace Constants
@@ -0,0 +1,119 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FENWICKTREE_H
+#define FENWICKTREE_H
+
+#include <vector>
+
+namespace QEditor {
+// Binary indexed tree of values, for O(log n) update, prefix sum and the index of a prefix sum.
+// The values should not be negative for UpperBound().
+template <typename T>
+class FenwickTree {
+   public:
+    FenwickTree() = default;
+
+    // Build in O(n).
+    void Assign(std::vector<T> values) {
+        values_ = std::move(values);
+        Rebuild();
+    }
+    void Clear() {
+        values_.clear();
+        tree_.clear();
+    }
+
+    // Append in O(log n).
+    void PushBack(const T &value) {
+        if (tree_.empty()) {
+            tree_.emplace_back();
+        }
+        values_.emplace_back(value);
+        const int i = size();
+        tree_.emplace_back(value + PrefixSum(i - 1) - PrefixSum(i - (i & -i)));
+    }
+
+    int size() const { return static_cast<int>(values_.size()); }
+    bool empty() const { return values_.empty(); }
+    T Value(int index) const { return values_[index]; }
+
+    void Set(int index, const T &value) { Add(index, value - values_[index]); }
+    void Add(int index, const T &delta) {
+        values_[index] += delta;
+        for (int i = index + 1; i < static_cast<int>(tree_.size()); i += i & -i) {
+            tree_[i] += delta;
+        }
+    }
+
+    // Replace 'count' values from 'index' by 'values'.
+    // O(log n) for each value if the size is not changed, otherwise rebuild in O(n).
+    void Replace(int index, int count, const std::vector<T> &values) {
+        if (count == static_cast<int>(values.size())) {
+            for (int i = 0; i < count; ++i) {
+                Set(index + i, values[i]);
+            }
+            return;
+        }
+        values_.erase(values_.begin() + index, values_.begin() + index + count);
+        values_.insert(values_.begin() + index, values.cbegin(), values.cend());
+        Rebuild();
+    }
+
+    // Sum of the first 'count' values.
+    T PrefixSum(int count) const {
+        T sum{};
+        for (int i = count; i > 0; i -= i & -i) {
+            sum += tree_[i];
+        }
+        return sum;
+    }
+    T Sum() const { return PrefixSum(size()); }
+
+    // The smallest index whose prefix sum including itself exceeds 'sum', or size() if none.
+    int UpperBound(T sum) const {
+        int index = 0;
+        int step = 1;
+        while (step * 2 < static_cast<int>(tree_.size())) {
+            step *= 2;
+        }
+        for (; step > 0; step /= 2) {
+            if (index + step < static_cast<int>(tree_.size()) && tree_[index + step] <= sum) {
+                index += step;
+                sum -= tree_[index];
+            }
+        }
+        return index;
+    }
+
+   private:
+    void Rebuild() {
+        tree_.assign(values_.size() + 1, T{});
+        for (int i = 1; i < static_cast<int>(tree_.size()); ++i) {
+            tree_[i] += values_[i - 1];
+            auto parent = i + (i & -i);
+            if (parent < static_cast<int>(tree_.size())) {
+                tree_[parent] += tree_[i];
+            }
+        }
+    }
+
+    std::vector<T> values_;
+    std::vector<T> tree_;  // 1-based, tree_[i] is the sum of the values in (i - (i & -i), i].
+};
+}  // namespace QEditor
+
+#endif  // FENWICKTREE_H
@@ -0,0 +1,53 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef OFFSETTRACKER_H
+#define OFFSETTRACKER_H
+
+#include "FenwickTree.h"
+#include <vector>
+
+namespace QEditor {
+// The sorted and not overlapping hits in a document, following the edits without a cursor for each.
+// The gaps between the positions are kept in a Fenwick tree, so an edit changes one gap in O(log n),
+// and a position is the prefix sum of the gaps when it's used.
+class OffsetTracker {
+   public:
+    // Not before the end of the last one.
+    void Append(int offset, int length);
+    void Remove(int index);
+    void Clear();
+
+    int size() const { return gaps_.size(); }
+    int Offset(int index) const { return gaps_.PrefixSum(index + 1); }
+    // If the text of the hit was replaced or removed. The offset is where the removed text was.
+    bool removed(int index) const { return removed_[index]; }
+
+    // Call it on each contentsChange of the document.
+    void HandleContentsChange(int position, int charsRemoved, int charsAdded);
+
+   private:
+    // The first index whose offset is not less than 'offset', or size() if none.
+    int LowerBound(int offset) const { return gaps_.UpperBound(offset - 1); }
+
+    FenwickTree<int> gaps_;
+    std::vector<int> lengths_;
+    std::vector<bool> removed_;
+};
+}  // namespace QEditor
+
+#endif  // OFFSETTRACKER_H
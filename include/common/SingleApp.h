@@ -100,20 +100,19 @@ class SingleAppServer : public QObject {
             qDebug() << "socket is null.";
             return;
         }
-        QTextStream stream(socket);
-        QString text = stream.readAll();
-        qDebug() << "Read data from client: " << text;
-        QFileInfo fileInfo(text);
-        if (fileInfo.isFile()) {
-            qDebug() << "Open file: " << fileInfo.canonicalFilePath();
-            ShowWindow();
-
-            MainWindow::Instance().tabView()->OpenFile(fileInfo.canonicalFilePath());
-        } else {
-            qDebug() << "Fail to open file: " << fileInfo.canonicalFilePath();
-            ShowWindow();
-
-            // Toast::Instance().Show(Toast::kError, QString(tr("Can't open multiple window.")));
+        // One path in each line, the lines not received yet are handled in next ready read.
+        QStringList filePaths;
+        while (socket->canReadLine()) {
+            QString line = QString::fromLocal8Bit(socket->readLine());
+            line.chop(1);
+            qDebug() << "Read data from client: " << line;
+            if (QFileInfo(line).exists()) {
+                filePaths.append(line);
+            }
+        }
+        ShowWindow();
+        if (!filePaths.isEmpty()) {
+            MainWindow::Instance().tabView()->OpenFiles(filePaths);
         }
 
         QString response = "FIN";
@@ -185,9 +184,13 @@ class SingleApp : public QObject {
     SingleApp() = default;
     ~SingleApp() = default;
 
-    bool TryRun(const QString &filePath) {
-        // Already running.
-        if (client_.ConnectToServer(filePath.isEmpty() ? "[NO_FILE]" : filePath)) {
+    bool TryRun(const QStringList &filePaths) {
+        // Already running. Send the absolute paths, since the server runs in another directory.
+        QString message;
+        for (const auto &filePath : filePaths) {
+            message += QFileInfo(filePath).absoluteFilePath() + "\n";
+        }
+        if (client_.ConnectToServer(message.isEmpty() ? "[NO_FILE]\n" : message)) {
             return false;
         }
         // Start a server.
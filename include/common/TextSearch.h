@@ -0,0 +1,63 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TEXTSEARCH_H
+#define TEXTSEARCH_H
+
+#include <QString>
+#include <array>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace QEditor {
+// (offset, length) of each match in the text.
+using TextMatches = std::vector<std::pair<int, int>>;
+// Find the matches starting in [from, to) of the text, return where to go on for the next range.
+using TextFindFunction = std::function<int(const QString &text, int from, int to, TextMatches &matches)>;
+
+// Find all matches of a literal in a contiguous UTF-16 text, such as a document snapshot.
+// The candidates are filtered by the first and the last chars of the pattern, 8 chars at once with SSE2, then
+// verified. A long pattern is searched by Boyer-Moore-Horspool instead, as its shifts skip more.
+// The same as QTextDocument::find() looping, the matches are not overlapped.
+class TextSearch {
+   public:
+    TextSearch(const QString &pattern, bool caseSensitive, bool wholeWord);
+
+    bool empty() const { return pattern_.empty(); }
+
+    // Append the matches starting in [from, to) of the text, return where to go on for the next range.
+    int FindAll(const QChar *data, int size, int from, int to, TextMatches &matches) const;
+
+   private:
+    static constexpr int kHorspoolMinLength = 16;
+    static constexpr size_t kMaxCaseVariants = 4;  // Compared by SSE2, scalar if more chars fold to one.
+
+    char16_t CharAt(const char16_t *text, int pos) const;
+    bool Verify(const char16_t *text, int size, int pos) const;
+    int FindByHorspool(const char16_t *text, int size, int from, int to, TextMatches &matches) const;
+
+    bool caseSensitive_;
+    bool wholeWord_;
+    std::vector<char16_t> pattern_;  // Case folded if not case sensitive.
+    // The chars of the same folded char, to filter the first and the last chars.
+    std::vector<char16_t> firstChars_;
+    std::vector<char16_t> lastChars_;
+    std::array<int, 256> shifts_{};  // Of the low byte of the window's last char, the min one if collided.
+};
+}  // namespace QEditor
+
+#endif  // TEXTSEARCH_H
@@ -0,0 +1,96 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AUTOSAVEJOURNAL_H
+#define AUTOSAVEJOURNAL_H
+
+#include "Logger.h"
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QThread>
+#include <QTimer>
+#include <vector>
+
+namespace QEditor {
+// Auto save the modified text of each tab as a base file and an append-only journal of the changes.
+// The operations are queued by UI, and written in its own thread every 'kAutoSaveFlushInterval'.
+// Both files start with the generation of the base, so a journal left by a crash is not replayed on a newer base.
+class AutoSaveJournal : public QObject {
+    Q_OBJECT
+   public:
+    static AutoSaveJournal &Instance();
+    ~AutoSaveJournal();
+
+    // Not used by any file in the auto save directory.
+    int NewId() { return nextId_++; }
+
+    // Replace the base by the whole text, and discard the journal.
+    void Rebase(int id, int mibEnum, const QString &text);
+    // Append a change as QTextDocument::contentsChange reports, with the inserted text.
+    void Append(int id, int position, int charsRemoved, const QString &insertedText);
+    // Remove the files of the ids not in 'ids'.
+    void Retain(const QSet<int> &ids);
+    // Write all queued operations and stop the thread, to call before exit.
+    void Stop();
+
+    // Read the base and replay the journal on it. The incomplete record at the end is dropped.
+    static bool Load(int id, int *mibEnum, QString *text);
+
+   private slots:
+    void HandleStartInThread();
+    void HandleStopInThread();
+    void HandleTimeout();
+
+   private:
+    AutoSaveJournal();
+
+    struct Operation {
+        enum Type { kRebase, kAppend, kRetain };
+        Type type;
+        int id{-1};
+        int mibEnum{106};
+        int position{0};
+        int charsRemoved{0};
+        QString text;
+        QSet<int> ids;
+    };
+    void Enqueue(Operation &&operation);
+    void Flush();
+    bool WriteBase(int id, int mibEnum, const QString &text);
+    void Compact(int id);
+    void RemoveOthers(const QSet<int> &ids);
+
+    static QString DirPath();
+    static QString BasePath(int id);
+    static QString JournalPath(int id);
+
+    QThread *thread_{nullptr};
+    QTimer *timer_{nullptr};  // Lives in the thread.
+
+    QMutex mutex_;
+    std::vector<Operation> operations_;
+    bool stopped_{false};
+
+    int nextId_{0};
+    QHash<int, int> recordCounts_;    // Records appended since rebased, only used by Flush().
+    QHash<int, qint64> generations_;  // Of the bases written, only used by Flush().
+    qint64 nextGeneration_;
+};
+}  // namespace QEditor
+
+#endif  // AUTOSAVEJOURNAL_H
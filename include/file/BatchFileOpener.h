@@ -0,0 +1,77 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BATCHFILEOPENER_H
+#define BATCHFILEOPENER_H
+
+#include "Logger.h"
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+
+namespace QEditor {
+// Read and decode many files concurrently in a thread pool.
+// The results are passed to UI in the order of opening, only a few in each frame.
+class BatchFileOpener : public QObject {
+    Q_OBJECT
+   public:
+    explicit BatchFileOpener(QObject *parent = nullptr);
+    // Cancel and wait for the pool.
+    ~BatchFileOpener();
+
+    class Result {
+       public:
+        QString filePath_;
+        bool success_{false};
+        QString errorString_;
+        QString text_;
+        int mibEnum_{106};
+        bool hasBom_{false};
+        qint64 loadedSize_{0};
+        bool compressed_{false};
+    };
+
+    // Can be called again before the former files finished.
+    void Open(const QStringList &filePaths);
+
+   signals:
+    // Emitted in UI thread.
+    void sigFileDecoded(const BatchFileOpener::Result &result);
+    void sigProgressChanged(int finishedCount, int totalCount);
+    void sigFinished();
+
+   private slots:
+    void HandleTimeout();
+
+   private:
+    // Run in the pool.
+    void Decode(int index, const QString &filePath);
+
+    QThreadPool pool_;
+    std::atomic<bool> canceled_{false};
+    QTimer timer_;
+
+    QMutex mutex_;
+    QMap<int, Result> results_;  // Decoded but not passed yet.
+    int nextIndex_{0};           // To pass next.
+    int totalCount_{0};
+};
+}  // namespace QEditor
+
+#endif  // BATCHFILEOPENER_H
@@ -147,6 +147,15 @@ class FileEncoding : public QObject {
     // Find proper codec, then change owned codec and return decoded text.
     QString ProcessAnsi(QFile &file);
 
+    // Whether the whole buffer is valid UTF-8.
+    static bool ValidateUtf8(const char *data, qint64 size);
+    // Guess the codec of the buffer without BOM, by checking a few sampled windows only.
+    static QTextCodec *DetectCodec(const char *data, qint64 size);
+    // Rank the ANSI codecs on the sampled windows, and return the best one.
+    static QTextCodec *DetectAnsiCodec(const char *data, qint64 size);
+    // The codec to use if no BOM and not UTF-8, never null.
+    static QTextCodec *AnsiCodec();
+
     static int GetMibByName(const QString &name);
     static QStringList encodingNames();
 
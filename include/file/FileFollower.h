@@ -0,0 +1,75 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FILEFOLLOWER_H
+#define FILEFOLLOWER_H
+
+#include "Logger.h"
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
+#include <QTextCodec>
+#else
+#include <QtCore5Compat/QTextCodec>
+#endif
+#include <memory>
+
+namespace QEditor {
+// Watch a growing file in its own thread, like 'tail -F'.
+// Only the bytes appended after 'offset' are read and decoded.
+class FileFollower : public QObject {
+    Q_OBJECT
+   public:
+    FileFollower(const QString &filePath, QTextCodec *codec, qint64 offset);
+    ~FileFollower();
+
+    void Start();
+    // Stop watching and wait for the thread.
+    void Stop();
+
+    // The offset read to, valid after stopped.
+    qint64 offset() const { return offset_; }
+
+   signals:
+    void sigTextAppended(const QString &text);
+    // The file is truncated or replaced by a new one, to discard the text followed before.
+    void sigReset();
+
+   private slots:
+    void HandleStartInThread();
+    void HandleStopInThread();
+    void HandleFileChanged();
+    void HandleTimeout();
+
+   private:
+    void Reset();
+    void ReadAppended();
+
+    QThread *thread_{nullptr};
+    // Both live in the thread.
+    QFileSystemWatcher *watcher_{nullptr};
+    QTimer *timer_{nullptr};
+
+    QString filePath_;
+    QTextCodec *codec_;
+    std::unique_ptr<QTextDecoder> decoder_;
+    qint64 offset_;
+};
+}  // namespace QEditor
+
+#endif  // FILEFOLLOWER_H
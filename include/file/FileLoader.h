@@ -0,0 +1,99 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FILELOADER_H
+#define FILELOADER_H
+
+#include "Logger.h"
+#include "RawByteCache.h"
+#include "StreamDecompressor.h"
+#include <QFile>
+#include <QObject>
+#include <QThread>
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
+#include <QTextCodec>
+#else
+#include <QtCore5Compat/QTextCodec>
+#endif
+#include <atomic>
+#include <memory>
+
+namespace QEditor {
+// Read and decode a file in chunks in its own thread.
+// The first chunk is small to show the first screen as soon as possible,
+// and the text is always emitted at line boundaries.
+// The gzip, zstd or xz compressed file is decompressed on the fly.
+class FileLoader : public QObject {
+    Q_OBJECT
+   public:
+    // If no BOM and not forced, the codec is detected by FileEncoding::DetectCodec().
+    // The raw bytes are kept in RawByteCache after loaded.
+    FileLoader(const QString &filePath, QTextCodec *codec, bool hasBom, bool forceUseCodec);
+    // Decode the raw bytes kept by the former loading by 'codec', without reading the file.
+    FileLoader(const QString &filePath, std::shared_ptr<const RawBytes> rawBytes, QTextCodec *codec, bool hasBom);
+    ~FileLoader();
+
+    void Start();
+    // Load in the calling thread instead, the signals are emitted directly.
+    void Load();
+    // Stop reading and wait for the thread. No signal is emitted after it returns.
+    // If loading by Load(), only stop reading, and can be called in other threads.
+    void Cancel();
+
+    // Bytes read from the file, valid after finished.
+    qint64 loadedSize() const { return loadedSize_; }
+    bool compressed() const { return format_ != StreamDecompressor::kNone; }
+
+   signals:
+    void sigEncodingDetected(int mibEnum, bool hasBom);
+    // The text loaded before is decoded by wrong codec, to discard it.
+    void sigRestarted();
+    void sigChunkLoaded(const QString &text);
+    void sigProgressChanged(int percent);
+    void sigFinished(bool success, const QString &errorString);
+
+   private slots:
+    void HandleLoadInThread();
+
+   private:
+    // 'hasBom' is set only for the compressed file, the plain one is checked before loading.
+    QTextCodec *DetectCodec(QFile &file, bool ansiOnly, bool *hasBom);
+    // Read from the start, and pass the decompressed data if compressed.
+    bool Read(QFile &file, const StreamDecompressor::Consumer &consumer);
+    // Read the raw bytes kept instead of the file.
+    bool ReadRawBytes(const StreamDecompressor::Consumer &consumer);
+    // Return false if decoding by UTF-8 failed, or 'errorString_' is set.
+    bool Decode(QFile &file, QTextCodec *codec, bool stopIfFailure);
+
+    QThread *thread_{nullptr};
+    std::atomic<bool> canceled_{false};
+
+    QString filePath_;
+    QTextCodec *codec_;
+    bool hasBom_;
+    bool forceUseCodec_;
+    qint64 fileSize_{0};
+    qint64 loadedSize_{0};
+    int percent_{-1};
+    qint64 readSize_{0};  // Bytes passed to decode, for progress.
+    std::shared_ptr<const RawBytes> rawBytes_;
+    std::shared_ptr<RawBytes> newRawBytes_;  // Kept while decoding.
+    StreamDecompressor::Format format_{StreamDecompressor::kNone};
+    QString errorString_;
+};
+}  // namespace QEditor
+
+#endif  // FILELOADER_H
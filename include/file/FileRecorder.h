@@ -19,6 +19,7 @@
 
 #include "Constants.h"
 #include "EditView.h"
+#include "LargeFileView.h"
 #include <QDataStream>
 #include <QObject>
 
@@ -68,7 +69,7 @@ class FileRecorder : public QObject {
 
         ///////////////////////////////////////////
         /// New file or open file.
-        int index_;  // Used as file name for storing data.
+        int index_;  // Journal id of the text, see AutoSaveJournal.
                      // -1 if no need to store or load. Such as: Open file edit but not change, or empty new file edit.
         int num_;    // New file edit, "* new xxx".
         QString path_;  // Open file edit.
@@ -136,6 +137,8 @@ class FileRecorder : public QObject {
     // To call before StoreFiles().
     void SetPos(int pos) { pos_ = pos; }
     void SetEditViews(QVector<EditView *> editViews) { editViews_ = std::move(editViews); }
+    // Large file views are always stored as original open files.
+    void SetLargeFileViews(QVector<LargeFileView *> largeFileViews) { largeFileViews_ = std::move(largeFileViews); }
 
     // Get loaded text for each tab.
     // To call after LoadFiles().
@@ -166,6 +169,7 @@ class FileRecorder : public QObject {
 
     int pos_;  // Focused edit view.
     QVector<EditView *> editViews_;
+    QVector<LargeFileView *> largeFileViews_;
 
     std::vector<QString> texts_;
     std::vector<int> mibEnums_;
@@ -0,0 +1,64 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FILESAVER_H
+#define FILESAVER_H
+
+#include "Logger.h"
+#include <QObject>
+#include <QThread>
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
+#include <QTextCodec>
+#else
+#include <QtCore5Compat/QTextCodec>
+#endif
+#include <vector>
+
+namespace QEditor {
+// Encode a snapshot of text and write it through QSaveFile in its own thread.
+class FileSaver : public QObject {
+    Q_OBJECT
+   public:
+    FileSaver(const QString &filePath, const QString &text, QTextCodec *codec, bool hasBom);
+    // Wait for the saving to finish, it's never canceled.
+    ~FileSaver();
+
+    void Start();
+    // Wait in the caller thread, then the result can be read without sigFinished().
+    void Wait();
+    const QString &errorString() const { return errorString_; }
+
+    // Encode in parallel chunks if the codec is stateless, the BOM not included.
+    static std::vector<QByteArray> Encode(const QString &text, QTextCodec *codec);
+
+   signals:
+    void sigFinished(bool success, const QString &errorString);
+
+   private slots:
+    void HandleSaveInThread();
+
+   private:
+    QThread *thread_{nullptr};
+
+    QString filePath_;
+    const QString text_;
+    QTextCodec *codec_;
+    bool hasBom_;
+    QString errorString_;
+};
+}  // namespace QEditor
+
+#endif  // FILESAVER_H
@@ -0,0 +1,131 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef FILESEARCHER_H
+#define FILESEARCHER_H
+
+#include "Constants.h"
+#include "TextSearch.h"
+#include <QMutex>
+#include <QObject>
+#include <QRegularExpression>
+#include <QTimer>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace QEditor {
+// Find in the files under a directory by a pool of workers.
+// Each worker walks the directories and scans the files in its own queue, and steals from the others if empty.
+// The files are mapped to read, and decoded by the detected codec. The matches are passed to UI in batches.
+class FileSearcher : public QObject {
+    Q_OBJECT
+   public:
+    explicit FileSearcher(QObject *parent = nullptr);
+    // Cancel and wait for the workers.
+    ~FileSearcher() override;
+
+    class Filter {
+       public:
+        QStringList globs_;  // Of the file names, like "*.cpp", or "!*.o" to skip.
+        qint64 maxFileSize_{Constants::kFindInFilesDefaultMaxSize};
+    };
+
+    class Hit {
+       public:
+        int line_{0};
+        int column_{0};
+        int length_{0};
+        int lineTextIndex_{0};  // In FileMatches::lineTexts_.
+        int lineTextColumn_{0};
+    };
+
+    class FileMatches {
+       public:
+        QString filePath_;
+        QString codecName_;
+        std::vector<Hit> hits_;
+        // The lines of the hits, one for the hits in the same line, or a part around them if the line is too long.
+        std::vector<QString> lineTexts_;
+    };
+
+    // Cancel the last one, then start to find by 'find' in the files under 'rootPath'.
+    void Start(const QString &rootPath, const Filter &filter, const TextFindFunction &find);
+    // sigFinished() as canceled if searching.
+    void Cancel();
+    bool searching() const { return searching_; }
+
+   signals:
+    // Emitted in UI thread.
+    void sigFound(const std::vector<FileSearcher::FileMatches> &batch);
+    void sigProgressChanged(int scannedCount, int skippedCount);
+    void sigFinished(bool canceled);
+
+   private slots:
+    void HandleTimeout();
+
+   private:
+    class Task {
+       public:
+        QString path_;
+        bool directory_{false};
+    };
+
+    // The tasks of a worker, popped from back by itself, and stolen from front by the others.
+    class TaskQueue {
+       public:
+        QMutex mutex_;
+        std::deque<Task> tasks_;
+    };
+
+    // Run in the workers.
+    void Work(int index);
+    void PushTask(int index, Task &&task);
+    bool PopTask(int index, Task &task);
+    bool StealTask(int index, Task &task);
+    void Walk(int index, const QString &dirPath);
+    void Scan(const QString &filePath);
+    bool Accept(const QString &fileName, qint64 size) const;
+
+    // Whether a NUL byte is in the head, as a text file without BOM has none.
+    static bool IsBinary(const char *data, qint64 size);
+    static void MakeHits(const QString &text, const TextMatches &matches, FileMatches &fileMatches);
+
+    void Join();
+
+    TextFindFunction find_;
+    qint64 maxFileSize_{0};
+    std::vector<QRegularExpression> includes_;
+    std::vector<QRegularExpression> excludes_;
+
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<int> pendingCount_{0};  // The tasks queued or running.
+    std::atomic<int> scannedCount_{0};
+    std::atomic<int> skippedCount_{0};  // Binary or unreadable.
+    std::atomic<bool> canceled_{false};
+    bool searching_{false};
+
+    QMutex mutex_;
+    std::vector<FileMatches> found_;  // Not passed yet.
+    QTimer timer_;
+};
+}  // namespace QEditor
+
+#endif  // FILESEARCHER_H
@@ -0,0 +1,65 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <QFileInfo>
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+
+namespace QEditor {
+// Sparse newline index of a byte buffer.
+// Only the start offset of every kStride-th line is kept, the lines between
+// two checkpoints are located by scanning forward from the nearer one.
+class LineIndex {
+   public:
+    static constexpr qint64 kStride = 64;
+
+    LineIndex() = default;
+    ~LineIndex() = default;
+    LineIndex(LineIndex &&) = default;
+    LineIndex &operator=(LineIndex &&) = default;
+
+    // Scan the whole buffer. Return false if canceled.
+    bool Build(const char *data, qint64 size, const std::atomic<bool> &canceled);
+    // Scan the bytes [from, size) appended after the built buffer of 'from' bytes.
+    void Extend(const char *data, qint64 from, qint64 size);
+    void Clear();
+
+    // Store to or load from the cache in the internal path, keyed by the path, size and modified time.
+    bool StoreCache(const QFileInfo &fileInfo) const;
+    bool LoadCache(const QFileInfo &fileInfo);
+
+    bool built() const { return built_; }
+    qint64 lineCount() const { return lineCount_; }
+
+    // Start offset of line 'line', 0-based. Work before Build() too, by scanning from the beginning.
+    qint64 LineStart(qint64 line, const char *data, qint64 size) const;
+    // End offset of the line starting at 'start', excluding the '\n' and a trailing '\r'.
+    static qint64 LineEnd(qint64 start, const char *data, qint64 size);
+    // Line number of the byte at 'offset', 0-based.
+    qint64 LineOf(qint64 offset, const char *data, qint64 size) const;
+
+   private:
+    std::vector<qint64> checkpoints_;  // checkpoints_[i] is the start offset of line (i * kStride).
+    qint64 lineCount_{0};
+    bool built_{false};
+};
+}  // namespace QEditor
+
+#endif  // LINEINDEX_H
@@ -0,0 +1,124 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include "LineIndex.h"
+#include <QByteArray>
+#include <QIODevice>
+#include <functional>
+#include <vector>
+
+namespace QEditor {
+// Editable bytes over a read-only original buffer, such as a memory mapped file.
+// The inserted bytes go to an append-only buffer, and the text is the sequence of pieces of both buffers.
+// The pieces are kept in a treap with the sums of bytes and newlines, for O(log n) offset and line lookups.
+// The newlines of the original pieces are counted by its LineIndex, nothing of the original is copied.
+class PieceTable {
+   public:
+    PieceTable() = default;
+    ~PieceTable();
+    PieceTable(const PieceTable &) = delete;
+    PieceTable &operator=(const PieceTable &) = delete;
+
+    // Drop all edits and the history. 'lineIndex' is of the original buffer, and should outlive the table.
+    void Reset(const char *data, qint64 size, const LineIndex *lineIndex);
+
+    // The original buffer is mapped again at 'data' with the same bytes, the edits are kept.
+    void SetOriginal(const char *data) { data_ = data; }
+
+    // Not editable until the line index of the original buffer is built.
+    bool editable() const { return lineIndex_ != nullptr && lineIndex_->built(); }
+    bool modified() const { return savePoint_ != static_cast<qint64>(undoStack_.size()); }
+    bool canUndo() const { return !undoStack_.empty(); }
+    bool canRedo() const { return !redoStack_.empty(); }
+    qint64 size() const;
+    // Only exact if editable().
+    qint64 lineCount() const;
+
+    // The same as LineIndex ones, but on the edited bytes.
+    qint64 LineStart(qint64 line) const;
+    qint64 LineEnd(qint64 start) const;
+    qint64 LineOf(qint64 offset) const;
+
+    char At(qint64 offset) const;
+    // Bytes in [start, end). Not copied if all in one original piece, so use it before the next edit.
+    QByteArray Read(qint64 start, qint64 end) const;
+    // Visit the continuous bytes in [start, end) in order, until 'visitor' returns false.
+    void ForEachSpan(qint64 start, qint64 end, const std::function<bool(const char *, qint64)> &visitor) const;
+    // Write all bytes in order. Only reads the table, so can run in another thread if not edited meanwhile.
+    bool WriteTo(QIODevice *device) const;
+
+    void Insert(qint64 offset, const QByteArray &bytes);
+    void Remove(qint64 start, qint64 end);
+    // Return the cursor offset after undo or redo, or -1 if nothing to do.
+    qint64 Undo();
+    qint64 Redo();
+    // Mark the current state as not modified, after saved.
+    void SetSavePoint() { savePoint_ = undoStack_.size(); }
+
+   private:
+    struct Node {
+        bool added;  // In the append buffer, or the original one.
+        qint64 start;
+        qint64 length;
+        qint64 newlines;
+        quint32 priority;
+        Node *left{nullptr};
+        Node *right{nullptr};
+        qint64 totalLength{0};  // Of the subtree.
+        qint64 totalNewlines{0};
+    };
+    // The removed pieces are kept by the edit, so undo and redo only move pieces.
+    struct Edit {
+        bool insert;
+        qint64 offset;
+        qint64 length;
+        Node *detached;  // The removed pieces, or the inserted ones after undone.
+    };
+
+    void Clear();
+    void ClearRedo();
+    const char *Buffer(bool added) const { return added ? add_.constData() : data_; }
+    qint64 CountNewlines(bool added, qint64 start, qint64 end) const;
+    // Offset in the piece of its n-th newline, 1-based.
+    qint64 NthNewline(const Node *node, qint64 n) const;
+
+    Node *NewNode(bool added, qint64 start, qint64 length, qint64 newlines);
+    static void Update(Node *node);
+    static void Delete(Node *node);
+    static Node *Merge(Node *left, Node *right);
+    // Split into [0, offset) and [offset, end), the piece across 'offset' is cut into two.
+    void Split(Node *node, qint64 offset, Node **left, Node **right);
+    Node *Extract(qint64 offset, qint64 length);
+    void Attach(qint64 offset, Node *node);
+    bool VisitSpans(const Node *node, qint64 nodeOffset, qint64 start, qint64 end,
+                    const std::function<bool(bool, const char *, qint64)> &visitor) const;
+
+    const char *data_{nullptr};
+    qint64 size_{0};
+    const LineIndex *lineIndex_{nullptr};
+    QByteArray add_;
+
+    Node *root_{nullptr};
+    std::vector<Edit> undoStack_;
+    std::vector<Edit> redoStack_;
+    qint64 savePoint_{0};  // Size of the undo stack when saved, -1 if can't get back.
+};
+}  // namespace QEditor
+
+#endif  // PIECETABLE_H
@@ -0,0 +1,62 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RAWBYTECACHE_H
+#define RAWBYTECACHE_H
+
+#include "StreamDecompressor.h"
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace QEditor {
+// The raw bytes of a loaded file, compressed in chunks by qCompress().
+// For the compressed file, the bytes are decompressed ones.
+class RawBytes {
+   public:
+    std::vector<QByteArray> chunks_;
+    qint64 size_{0};  // Memory used by the chunks.
+
+    qint64 loadedSize_{0};  // Bytes read from the file.
+    StreamDecompressor::Format format_{StreamDecompressor::kNone};
+    QDateTime lastModified_;
+};
+
+// Keep the raw bytes of the files loaded, to decode again by another codec without reading the file.
+// The least recently used ones are released if exceeding 'kRawByteCacheMaxSize'. Thread safe.
+class RawByteCache {
+   public:
+    static RawByteCache &Instance();
+
+    void Put(const QString &filePath, std::shared_ptr<const RawBytes> rawBytes);
+    // Return null if released, or the file is changed after loaded.
+    std::shared_ptr<const RawBytes> Get(const QString &filePath);
+    void Remove(const QString &filePath);
+
+   private:
+    RawByteCache() = default;
+
+    QMutex mutex_;
+    // The most recently used is at front.
+    std::list<std::pair<QString, std::shared_ptr<const RawBytes>>> entries_;
+    qint64 totalSize_{0};
+};
+}  // namespace QEditor
+
+#endif  // RAWBYTECACHE_H
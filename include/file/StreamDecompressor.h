@@ -0,0 +1,56 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STREAMDECOMPRESSOR_H
+#define STREAMDECOMPRESSOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <functional>
+#include <memory>
+
+namespace QEditor {
+// Decompress the data fed in pieces, without the whole input or output in memory.
+// The backends are built only if the libraries are found, see QEditor.pro.
+class StreamDecompressor {
+   public:
+    enum Format { kNone, kGzip, kZstd, kXz };
+
+    // Return false to stop.
+    using Consumer = std::function<bool(const char *data, qint64 size)>;
+
+    virtual ~StreamDecompressor() = default;
+
+    // Detect by the magic bytes, at most 6 bytes are checked.
+    static Format DetectFormat(const QByteArray &head);
+    static QString FormatName(Format format);
+    // Return null if the format is not supported in this build.
+    static std::unique_ptr<StreamDecompressor> Create(Format format);
+
+    // Output is passed to 'consumer' in pieces no larger than 'kFileLoadChunkSize'.
+    // Return false if the data is corrupted, or stopped by 'consumer'.
+    virtual bool Decompress(const char *data, qint64 size, const Consumer &consumer) = 0;
+    // Flush at the end of input. Return false if the input is truncated.
+    virtual bool Finish(const Consumer &consumer) = 0;
+
+    QString errorString() const { return errorString_; }
+
+   protected:
+    QString errorString_;
+};
+}  // namespace QEditor
+
+#endif  // STREAMDECOMPRESSOR_H
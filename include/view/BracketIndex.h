@@ -0,0 +1,72 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BRACKETINDEX_H
+#define BRACKETINDEX_H
+
+#include <QTextDocument>
+#include <vector>
+
+namespace QEditor {
+// Find the pairing bracket without walking through the text between.
+// Each block keeps its unmatched brackets, and a segment tree over the groups of blocks skips the balanced ones,
+// so only the blocks of both brackets are scanned. Built at the first query, then updated by the changed blocks.
+class BracketIndex {
+   public:
+    explicit BracketIndex(const QTextDocument *document) : document_(document) {}
+
+    // Call it on each contentsChange of the document.
+    void HandleContentsChange(int from, int charsAdded);
+    void Invalidate();
+
+    // Position of the close bracket pairing the open one at 'position', or -1.
+    int FindClose(int position, QChar open, QChar close) const;
+    // Position of the open bracket pairing the close one at 'position', or -1.
+    int FindOpen(int position, QChar open, QChar close) const;
+
+   private:
+    static constexpr int kTypeCount = 4;
+    static constexpr int kGroupSize = 64;  // Blocks of a leaf of the tree.
+
+    // The unmatched brackets of a block or blocks, like ")))(((" for each type.
+    struct Balance {
+        int close[kTypeCount]{};
+        int open[kTypeCount]{};
+    };
+
+    static int TypeOf(QChar open, QChar close);
+    static Balance Measure(const QString &text);
+    static Balance Combine(const Balance &lhs, const Balance &rhs);
+
+    void EnsureBuilt() const;
+    void BuildTree() const;
+    void UpdateGroup(int group) const;
+    Balance GroupBalance(int group) const;
+
+    // The first group from 'from' where 'depth' unmatched open brackets are closed, or -1.
+    int FindGroupForward(int node, int lo, int hi, int from, int type, int &depth) const;
+    // The last group before 'to' where 'depth' unmatched close brackets are opened, or -1.
+    int FindGroupBackward(int node, int lo, int hi, int to, int type, int &depth) const;
+
+    const QTextDocument *document_;
+    mutable std::vector<Balance> blocks_;
+    mutable std::vector<Balance> tree_;  // 1-based, the children of i are 2i and 2i+1.
+    mutable int groupCount_{0};
+    mutable bool built_{false};
+};
+}  // namespace QEditor
+
+#endif  // BRACKETINDEX_H
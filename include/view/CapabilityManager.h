@@ -0,0 +1,51 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAPABILITYMANAGER_H
+#define CAPABILITYMANAGER_H
+
+#include <QTextDocument>
+
+namespace QEditor {
+// Decide the tier of each rich feature of a document by its cost on this machine.
+// The cost per char of each feature is measured when it runs, and shared by all documents.
+// Before measured, the cost is assumed to fit the old fixed limits into the background budget.
+class CapabilityManager {
+   public:
+    enum Feature { kParsing, kHighlighting, kScrollbarScan, kFeatureCount };
+    enum Tier { kOff, kBackground, kFull };
+
+    explicit CapabilityManager(const QTextDocument *document) : document_(document) {}
+
+    // Cache the size of the file, not to read the file stats on each check.
+    void SetFileSize(qint64 fileSize) { fileSize_ = fileSize; }
+
+    // Full if the estimated cost fits the full budget, background if fits the background budget, or off.
+    Tier tier(Feature feature) const;
+    bool Allow(Feature feature) const { return tier(feature) != kOff; }
+
+    // Record a run of 'feature' on 'chars' chars, callable in any thread.
+    static void Record(Feature feature, qint64 chars, qint64 nsecs);
+    // Estimated ms of 'feature' on 'chars' chars.
+    static qreal EstimateCost(Feature feature, qint64 chars);
+
+   private:
+    const QTextDocument *document_;
+    qint64 fileSize_{0};
+};
+}  // namespace QEditor
+
+#endif  // CAPABILITYMANAGER_H
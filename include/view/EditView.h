@@ -17,20 +17,32 @@
 #ifndef EDITVIEW_H
 #define EDITVIEW_H
 
+#include "BracketIndex.h"
+#include "CapabilityManager.h"
+#include "FenwickTree.h"
 #include "FileEncoding.h"
 #include "FileType.h"
+#include "HighlightOverlay.h"
 #include "IParser.h"
 #include "Logger.h"
 #include "TextHighlighter.h"
 #include <QFileInfo>
 #include <QGraphicsView>
+#include <QImage>
 #include <QPlainTextEdit>
 #include <QRandomGenerator>
 #include <QScrollBar>
+#include <QTextBlock>
+#include <QTimer>
 
 namespace QEditor {
 class TabView;
+class FileFollower;
+class FileLoader;
+class FileSaver;
 class IParser;
+class MarkScanner;
+class MiniMap;
 class OutlineList;
 class FunctionHierarchy;
 class NewFileNum;
@@ -43,14 +55,18 @@ class EditView : public QPlainTextEdit {
     EditView(QWidget *parent = nullptr);
     EditView(const QString &fileName, QWidget *parent = nullptr);
     EditView(const QFileInfo &fileInfo, QWidget *parent = nullptr);
-    ~EditView() = default;
+    ~EditView();
 
     using ScrollBarInfo = QHash<int, std::vector<std::pair<std::vector<int>, QColor>>>;
 
     void Init();
 
     void SetCurrentFile(const QString &filePath);
+    // Save in background, the modified flag is cleared and the new path applied after written.
     bool SaveFile(const QString &filePath);
+    bool saving() const { return fileSaver_ != nullptr; }
+    // Wait for the background saving, before the view is closed. Return false if it failed.
+    bool WaitForSaving();
     bool Save();
     bool SaveAs();
     bool MaybeSave();
@@ -76,8 +92,10 @@ class EditView : public QPlainTextEdit {
     void AddMarkText(const QString &str);
     bool RemoveMarkText(const QString &str);
     void ClearMarkTexts();
-    QColor GetMarkTextBackground(int i);
+    static QColor GetMarkTextBackground(int i);
     void HighlightMarkTexts();
+    // Mark the text to search in the highlight scrollbar, found in background.
+    void ScanSearchText(const QString &text);
 
     std::pair<QTextCursor, bool> FindPairingBracketCursor(QTextCursor cursor, QTextCursor::MoveOperation direct,
                                                           const QChar &startBracketChar, const QChar &endBracketChar);
@@ -100,7 +118,38 @@ class EditView : public QPlainTextEdit {
     virtual void SetModified(bool modified);
 
     bool fileLoaded() { return fileLoaded_; };
-    void setFileLoaded(bool fileLoaded) { fileLoaded_ = fileLoaded; }
+    void setFileLoaded(bool fileLoaded) {
+        fileLoaded_ = fileLoaded;
+        if (fileLoaded) {
+            emit sigFileLoaded();
+        }
+    }
+
+    // Load the file in background, the view is read-only until finished.
+    void LoadFile(const QString &filePath, FileEncoding &&fileEncoding, bool forceUseFileEncoding);
+    void CancelLoading();
+    bool loading() const { return fileLoader_ != nullptr; }
+    // Set the text decoded in other place, as loaded from the file.
+    void SetLoadedText(const QString &text, FileEncoding &&fileEncoding, qint64 loadedSize, bool compressed);
+
+    // Restored from the last session, the content is filled when the tab is first activated.
+    // Load from 'filePath_' if 'fromFile', otherwise set 'text'.
+    void SetPendingRestore(bool fromFile, const QString &text = QString());
+    bool pendingRestore() const { return pendingRestore_; }
+    const QString &pendingText() const { return pendingText_; }
+    void Restore();
+
+    // Journal the changes for auto save since modified, -1 if not journaled.
+    int journalId() const { return journalId_; }
+    // Rebase the journal by the whole text, return the journal id.
+    int StartJournal();
+    // Continue the journal of last session.
+    void AdoptJournal(int id) { journalId_ = id; }
+
+    // Append the text written to the file since loaded, the view is read-only while following.
+    void StartFollowing();
+    void StopFollowing();
+    bool following() const { return fileFollower_ != nullptr; }
 
     TabView *tabView() { return tabView_; }
 
@@ -109,6 +158,7 @@ class EditView : public QPlainTextEdit {
 
     void ApplyWrapTextState();
     void ApplySpecialCharsVisible();
+    void ApplyMiniMapVisible();
     void ApplyTabCharNum();
 
     FileEncoding &fileEncoding() { return fileEncoding_; }
@@ -129,23 +179,7 @@ class EditView : public QPlainTextEdit {
     void JumpHint(QTextCursor &cursor);
     void Jump();
 
-    bool AllowRichParsing() {
-        QFile file(filePath_);
-        if (file.size() > Constants::kMaxParseFileSize) {
-            return false;
-        }
-        return (blockCount() <= Constants::kMaxParseLineNum &&
-                document()->characterCount() <= Constants::kMaxParseCharNum);
-    }
-
-    bool AllowHighlightScrollbar() {
-        QFile file(filePath_);
-        if (file.size() > Constants::kMaxHighlightScrollbarFileSize) {
-            return false;
-        }
-        return (blockCount() <= Constants::kMaxHighlightScrollbarLineNum &&
-                document()->characterCount() <= Constants::kMaxHighlightScrollbarCharNum);
-    }
+    bool AllowHighlightScrollbar() const { return capabilities_.Allow(CapabilityManager::kScrollbarScan); }
 
     qreal LineSpacing() {
         QFont currentFont = font();
@@ -163,15 +197,21 @@ class EditView : public QPlainTextEdit {
 
     void setHightlightScrollbarInvalid(bool hightlightScrollbarInvalid);
 
+    // The visual lines if wrapping, measured lazily and updated by the changed blocks only.
     int LineNumber(const QTextCursor &cursor) const;
     int LineCount() const;
-
-    std::vector<int> lineOffset() const;
+    // First visual line of the block, O(log n).
+    int LineNumberOfBlock(int blockNumber) const;
 
     int lastPos() const;
     void setLastPos(int lastPos);
 
-    void HandleLineOffset();
+    // Measure all blocks again at next query.
+    void InvalidateVisualLines() { visualLines_.Clear(); }
+
+   signals:
+    // The text is complete, after loaded in background or restored.
+    void sigFileLoaded();
 
    protected:
     void showEvent(QShowEvent *) override;
@@ -197,6 +237,9 @@ class EditView : public QPlainTextEdit {
     void HandleTextChanged();
     void HandleContentsChange(int from, int charsRemoved, int charsAdded);
     void HandleContentsChanged();
+    void HandleMarksScanned();
+    void HandleSelectionScanned();
+    void HandleSearchScanned();
     void HandleCopyAvailable(bool avail);
     void HandleUndoAvailable(bool avail);
     void HandleRedoAvailable(bool avail);
@@ -209,16 +252,26 @@ class EditView : public QPlainTextEdit {
 
    private:
     friend class HighlightScrollBar;
+    friend class MiniMap;
     void UpdateLineNumberArea(const QRect &rect, int dy);
+    // In the right margin of the viewport, so moved when the margins change.
+    void UpdateMiniMapGeometry();
+    // Return false and warn if failed.
+    bool HandleSaveFinished(bool success, const QString &errorString);
+
+    // Parse and update the outline and hierarchy, the cost is measured for the capability tier.
+    void Parse();
 
     void HighlightFocusChars();
     void HighlightFocusNearBracket();
     void HighlightBrackets(const QTextCursor &leftCursor, const QTextCursor &rightCursor);
 
-    void HighlightVisibleChars(const QString &text, const QColor &foreground = QColor(Qt::lightGray),
+    // Add the visible ranges of 'text' to the overlay layer.
+    void HighlightVisibleChars(const QString &text, int layer,
                                const QColor &background = QColor(52, 58, 78));  // (52, 58, 64),  // QColor(54, 54, 100)
-    // Return false if too many highlighting times.
-    bool HighlightChars(int startPos, int count, const QColor &foreground = QColor(Qt::lightGray),
+    // Paint the overlay ranges in the viewport, before the text painted.
+    void PaintOverlay(QPaintEvent *event);
+    void HighlightChars(int startPos, int count, const QColor &foreground = QColor(Qt::lightGray),
                         const QColor &background = QColor(52, 58, 78),  // (52, 58, 64),  // QColor(54, 54, 100)
                         bool underline = false);
     bool highlighterInvalid() {
@@ -229,6 +282,9 @@ class EditView : public QPlainTextEdit {
     // Select SPACE or TAB when double clicked.
     void SelectAllSpaces(QTextCursor &cursor, const QChar &charactor, const QChar &space);
 
+    void JournalChange(int from, int charsRemoved, int charsAdded);
+    std::vector<int> LineNumbersOfBlocks(const std::vector<int> &blockNumbers) const;
+
     TabView *tabView_;
     QWidget *lineNumberArea_;
     int currentBlockNumber_{0};
@@ -246,13 +302,41 @@ class EditView : public QPlainTextEdit {
     bool highlighterInvalid_{true};
     QString selectedText_;
     int selectedTextMatchCount_{0};
+    MarkScanner *selectionScanner_{nullptr};
+    QTimer *selectionCountTimer_{nullptr};
+    MarkScanner *searchScanner_{nullptr};
     TextHighlighter *highlighter_{nullptr};
+    HighlightOverlay overlay_;
     QVector<QString> markTexts_;
+    MarkScanner *markScanner_{nullptr};
     const QMap<QString, QString> leftBrackets_ = {{"(", ")"}, {"[", "]"}, {"{", "}"}, {"<", ">"}};
     const QMap<QString, QString> rightBrackets_ = {{")", "("}, {"]", "["}, {"}", "{"}, {">", "<"}};
+    BracketIndex bracketIndex_{document()};
+    MiniMap *miniMap_{nullptr};
+    CapabilityManager capabilities_{document()};
     bool contentChanged_{false};
     bool fileLoaded_{false};
 
+    FileLoader *fileLoader_{nullptr};
+    int loadId_{0};  // To drop the signals queued by a canceled loader.
+    qint64 loadedFileSize_{0};
+    bool compressed_{false};  // Decompressed when loading, not to save in place.
+
+    bool pendingRestore_{false};
+    bool restoreFromFile_{false};
+    QString pendingText_;
+
+    int journalId_{-1};
+    int journalLength_{0};  // Text length after the journaled changes.
+
+    FileSaver *fileSaver_{nullptr};
+    int saveId_{0};  // To drop the signal of the saving already waited.
+    int saveRevision_{0};
+    QString saveFilePath_;  // The path saved to, applied to the view after written.
+
+    FileFollower *fileFollower_{nullptr};
+    int followId_{0};
+
     bool copyAvail_{false};
     bool undoAvail_{false};
     bool redoAvail_{false};
@@ -260,6 +344,7 @@ class EditView : public QPlainTextEdit {
     FileEncoding fileEncoding_ /*{106}*/;
 
     IParser *parser_{nullptr};
+    QTimer *parseTimer_{nullptr};  // To parse after the editing settles in background tier.
     OutlineList *outlineList_{nullptr};
     FunctionHierarchy *hierarchy_{nullptr};
 
@@ -276,10 +361,14 @@ class EditView : public QPlainTextEdit {
     ScrollBarInfo scrollbarLineInfos_;
     bool hightlightScrollbarInvalid_{false};
 
-    // QSizeF documentSize_;
-    std::vector<int> lineOffset_;
-    bool layoutRequested_{false};
-    bool resized_{false};
+    // Visual line count of each block if wrapping. Measured again if the width or font changed.
+    void EnsureVisualLines() const;
+    void UpdateVisualLines(int from, int charsAdded);
+    qreal VisualLineWidth() const;
+    int VisualLineCount(const QTextBlock &block, qreal width) const;
+    mutable FenwickTree<int> visualLines_;
+    mutable qreal visualLinesWidth_{0};
+    mutable QFont visualLinesFont_;
 };
 
 class NewFileNum : public QObject {
@@ -353,12 +442,13 @@ class HighlightScrollBar : public QScrollBar {
     void sliderChange(SliderChange change) override;
 
    private:
-    std::vector<std::pair<int, QColor>> PreparePositions();
-    void PaintLines(QPainter &painter, const QRect &aboveHandleRect, const QRect &handleRect,
-                    const QRect &belowHandleRect, const QColor &color, int pos, bool inHandle);
+    void RebuildMarkers(const QRect &grooveRect, int lineCount);
 
     EditView *editView_{nullptr};
-    int height_{0};
+    QImage markerImage_;                         // A pixel row for the markers of the lines in it.
+    std::vector<std::pair<int, QRgb>> markers_;  // Sorted by line, to mark the visible lines in the handle.
+    QRect markerGroove_;
+    int markerLineCount_{-1};
 };
 }  // namespace QEditor
 
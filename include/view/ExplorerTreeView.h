@@ -45,6 +45,8 @@ class ExplorerTreeView : public QTreeView {
     void HandleDirLoaded(const QString &path);
 
     void GotoPathPosition(const QString &path);
+    // The root directory, or the one of the current item if all drives are shown.
+    QString rootPath() const;
 
     bool event(QEvent *event) override {
         qDebug() << event->type();
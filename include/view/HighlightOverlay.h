@@ -0,0 +1,69 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HIGHLIGHTOVERLAY_H
+#define HIGHLIGHTOVERLAY_H
+
+#include <QColor>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace QEditor {
+// Background highlights painted under the text, instead of one ExtraSelection for each range.
+// Each layer has its own color and keeps its ranges sorted and merged, so painting only looks up the visible ones.
+// The layers are painted in the order of their ids, the latter over the former.
+class HighlightOverlay {
+   public:
+    enum LayerId : int {
+        kLayerCurrentBlock = 0,
+        kLayerBracket = 1,
+        kLayerMark = 100,  // kLayerMark + i for the i-th mark text.
+        kLayerUnrecognizedChar = 1 << 20,
+        kLayerFocus,
+    };
+
+    struct Range {
+        int start;
+        int end;  // Exclusive.
+    };
+
+    HighlightOverlay() = default;
+
+    void Clear() { layers_.clear(); }
+    bool empty() const { return layers_.empty(); }
+
+    // A full width layer paints the whole width of the lines its ranges touch.
+    void SetLayer(int id, const QColor &background, bool fullWidth = false);
+    // Overlapped or adjacent ranges are merged. O(1) if added in order.
+    void AddRange(int id, int start, int end);
+
+    // Visit the layers in painting order, with their ranges intersecting [from, to), in O(log n + k).
+    void ForEachRange(int from, int to,
+                      const std::function<void(const QColor &, bool fullWidth, const Range &)> &visitor) const;
+
+   private:
+    struct Layer {
+        QColor background;
+        bool fullWidth{false};
+        std::vector<Range> ranges;  // Sorted, not overlapped.
+    };
+
+    std::map<int, Layer> layers_;
+};
+}  // namespace QEditor
+
+#endif  // HIGHLIGHTOVERLAY_H
@@ -0,0 +1,199 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LARGEFILEVIEW_H
+#define LARGEFILEVIEW_H
+
+#include "FileEncoding.h"
+#include "LineIndex.h"
+#include "Logger.h"
+#include "PieceTable.h"
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QFileInfo>
+#include <QMenu>
+#include <QSaveFile>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace QEditor {
+class TabView;
+
+// Viewer and editor for the file too large to load into a QTextDocument.
+// The file is memory mapped, a sparse newline index is built in background,
+// and only the visible lines are decoded and painted.
+// The edits are kept in a piece table over the map, so the memory is about the file size plus the edits.
+class LargeFileView : public QAbstractScrollArea {
+    Q_OBJECT
+   public:
+    LargeFileView(const QFileInfo &fileInfo, QWidget *parent = nullptr);
+    ~LargeFileView();
+
+    // Map the file and start indexing. Return false if the file can't be viewed.
+    bool Load();
+
+    QString fileName() const { return fileName_; }
+    QString filePath() const { return filePath_; }
+    qint64 fileSize() const { return file_.size(); }
+
+    FileEncoding &fileEncoding() { return fileEncoding_; }
+    void setFileEncoding(FileEncoding &&fileEncoding);
+
+    bool indexed() const { return lineIndex_.built(); }
+    qint64 lineCount() const { return table_.lineCount(); }
+    bool modified() const { return table_.modified(); }
+
+    // Jump to line, 0-based. Deferred until the index is ready.
+    void GotoLine(qint64 line);
+
+    // Search the bytes of 'text' in current encoding, from the cursor.
+    bool FindNext(const QString &text, bool caseSensitive, bool backward, bool wrapAround);
+
+    QVector<QString> markTexts() const { return markTexts_; }
+    void AddMarkText(const QString &str);
+    bool RemoveMarkText(const QString &str);
+    void ClearMarkTexts();
+
+    QString GetCursorText();
+    void Copy();
+    void Cut();
+    void Paste();
+    void Undo();
+    void Redo();
+
+    // Write the pieces into the file in background. Return false if can't start.
+    bool Save();
+    // Return true if saved or discarded, false if canceled.
+    bool MaybeSave();
+    // Wait for the background saving, before the view is closed. Return false if it failed.
+    bool WaitForSaving();
+
+    // Show the bytes appended to the file, like 'tail -f'. The view is read-only while following.
+    void StartFollowing();
+    void StopFollowing();
+    bool following() const { return followTimer_ != nullptr; }
+
+    void ZoomIn();
+    void ZoomOut();
+
+    void UpdateStatusBarWithCursor();
+
+    // Whether the file encoding keeps '\n' as a single byte, required by the newline index.
+    static bool IsByteNewLineCodec(int mibEnum);
+
+   protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+   private:
+    bool Map();
+    void Unmap();
+    void DetectEncoding();
+    void StartIndexing();
+    void HandleIndexFinished(const std::shared_ptr<LineIndex> &lineIndex);
+    // Map the file again if it grew or shrank, only the appended bytes are indexed if it grew.
+    void HandleFollowTimeout();
+    // Commit the written file and map it. Return false and warn if failed.
+    bool HandleSaveFinished();
+    void UpdateScrollBars();
+    void EnsureLineVisible(qint64 line);
+
+    qint64 FirstVisibleLine() const;
+    int VisibleLineCount() const;
+    int LineHeight() const { return fontMetrics().lineSpacing(); }
+    int GutterWidth() const;
+
+    // Decode the bytes [start, end) with the current codec.
+    QString DecodeLine(qint64 start, qint64 end);
+    QString ExpandTabs(const QString &text) const;
+    // X coordinate of the byte 'offset' in the line which starts at 'lineStart', relative to the text start.
+    qreal OffsetToX(qint64 lineStart, qint64 offset);
+    // Byte offset of the viewport point, or -1 if nothing mapped.
+    qint64 PointToOffset(const QPoint &pos, qint64 *line = nullptr);
+    // Byte range of the word (or the run of spaces) at 'offset'.
+    std::pair<qint64, qint64> WordRangeAt(qint64 offset);
+    void SetCursor(qint64 line, qint64 offset);
+    void MoveCursor(qint64 offset);
+    // Byte offset of the character before or after 'offset', a line break is one character.
+    qint64 PreviousCharOffset(qint64 offset);
+    qint64 NextCharOffset(qint64 offset);
+    bool HasSelection() const { return selectionStart_ >= 0 && selectionEnd_ > selectionStart_; }
+    // Return the offset of 'pattern' found from 'from', or -1 if not found.
+    qint64 SearchBytes(const QByteArray &pattern, qint64 from, bool caseSensitive, bool backward) const;
+    // Return the offset of the first, or the last if 'backward', 'pattern' in the buffer, or -1 if not found.
+    static qint64 SearchBuffer(const char *data, qint64 size, const QByteArray &pattern, bool caseSensitive,
+                               bool backward);
+
+    // Show the reason in status bar if can't edit now.
+    bool CheckEditable();
+    void ReplaceSelection(const QString &text);
+    void ReplaceRange(qint64 start, qint64 end, const QByteArray &bytes);
+    void HandleEdited(qint64 cursor);
+    void SetModifiedIcon(bool modified);
+
+    void PaintHighlight(QPainter &painter, qint64 lineStart, qint64 start, qint64 end, int top,
+                        const QColor &background);
+
+    TabView *tabView_;
+    QString fileName_;
+    QString filePath_;
+
+    QFile file_;
+    uchar *map_{nullptr};
+    const char *data_{nullptr};  // Text data in the map, without the BOM.
+    qint64 size_{0};
+    PieceTable table_;  // The text with edits, always read through it.
+
+    FileEncoding fileEncoding_;
+
+    LineIndex lineIndex_;
+    std::thread indexThread_;
+    std::atomic<bool> indexCanceled_{false};
+    qint64 pendingLine_{-1};
+
+    std::thread saveThread_;
+    std::unique_ptr<QSaveFile> saveFile_;  // Written in the thread, then committed here.
+    bool saveWritten_{false};              // Set by the thread.
+    int saveId_{0};                        // To drop the signal of the saving already waited.
+    bool saving_{false};                   // Not to edit while the pieces are being written.
+
+    QTimer *followTimer_{nullptr};
+    qint64 followBomSize_{0};  // To skip the BOM again when mapped again.
+
+    qint64 currentLine_{0};
+    qint64 cursorOffset_{0};
+    // Selected byte range, [selectionStart_, selectionEnd_).
+    qint64 selectionStart_{-1};
+    qint64 selectionEnd_{-1};
+    qint64 selectionAnchor_{-1};
+
+    int maxLineWidth_{0};
+
+    QVector<QString> markTexts_;
+    QMenu *menu_;
+};
+}  // namespace QEditor
+
+#endif  // LARGEFILEVIEW_H
@@ -17,9 +17,11 @@
 #ifndef TABVIEW_H
 #define TABVIEW_H
 
+#include "BatchFileOpener.h"
 #include "Diff.h"
 #include "DiffView.h"
 #include "EditView.h"
+#include "LargeFileView.h"
 #include "Logger.h"
 #ifdef OPEN_TERM
 #include "TerminalView.h"
@@ -42,15 +44,22 @@ class TabView : public QTabWidget {
     void UpdateWindowTitle(int index = -1);
     void ChangeTabCloseButtonToolTip(int index, const QString &tip);
 
+    // Return true if the saving started, the open and recent files are updated after written.
     bool ActionSave();
     bool ActionSaveAs();
+    // Called by the view after written to the new path.
+    void HandleFileSavedAs(EditView *editView, const QString &oldFilePath);
     bool TabCloseMaybeSave();
     bool TabCloseMaybeSaveInner(EditView *editView);
+    // Ask to save the modified large files, return false if canceled.
+    bool LargeFilesMaybeSave();
     bool TabForceClose();
     bool TabForceCloseInner(EditView *editView);
 
     void AutoStore();
+    // Add the tabs of last session, but only the focused one is loaded at once.
     bool AutoLoad();
+    void PrefetchPendingTab();
 
     void DeleteWidget(int index);
     void DeleteWidget(QWidget *widget);
@@ -95,13 +104,18 @@ class TabView : public QTabWidget {
         return diffView;
     }
 
+    LargeFileView *CurrentLargeFileView() { return qobject_cast<LargeFileView *>(currentWidget()); }
+
+    LargeFileView *GetLargeFileView(int index) { return qobject_cast<LargeFileView *>(widget(index)); }
+
     int FindEditViewIndex(const QString &filePath) {
         for (int i = 0; i < count(); ++i) {
             auto editView = GetEditView(i);
-            if (editView == nullptr) {
-                continue;
+            if (editView != nullptr && editView->filePath() == filePath) {
+                return i;
             }
-            if (editView->filePath() == filePath) {
+            auto largeFileView = GetLargeFileView(i);
+            if (largeFileView != nullptr && largeFileView->filePath() == filePath) {
                 return i;
             }
         }
@@ -119,11 +133,18 @@ class TabView : public QTabWidget {
     void NewFile();
     void OpenFile();
     void OpenFile(const QString &filePath);
+    // Open the files, or the files in the folders, concurrently if more than one.
+    void OpenFiles(const QStringList &filePaths);
+    void HandleFileDecoded(const BatchFileOpener::Result &result);
     bool LoadFile(EditView *editView, const QString &filePath);
     bool LoadFile(EditView *editView, const QString &filePath, FileEncoding &&fileEncoding,
                   bool forceUseFileEncoding = false);
     void OpenSsh(const QString &ip, int port, const QString &user, const QString &pwd);
 
+    // Use LargeFileView instead of EditView, if the file exceeds the configured size.
+    bool ShouldUseLargeFileView(const QString &filePath);
+    bool OpenLargeFile(const QFileInfo &fileInfo);
+
     void ChangeTabDescription(const QFileInfo &fileInfo, int index = -1);
     void ApplyWrapTextState(int index);
     void ApplySpecialCharsVisible(int index);
@@ -174,6 +195,11 @@ class TabView : public QTabWidget {
     QString formerDiffStr_{""};
 
     bool windowTitleShowFilePath_{false};
+    bool autoLoading_{false};
+    bool autoLoaded_{false};
+
+    BatchFileOpener *batchFileOpener_{nullptr};
+    bool batchFocusPending_{false};  // Focus the first file opened in batch.
 };
 }  // namespace QEditor
 
@@ -24,6 +24,7 @@
 #include "EditView.h"
 #include "FunctionHierarchy.h"
 #include "GotoLineDialog.h"
+#include "LargeFileView.h"
 #include "MainTabView.h"
 #include "OutlineList.h"
 #include "SearchDialog.h"
@@ -78,6 +79,7 @@ class MainWindow : public QMainWindow {
         }
         return diffView;
     }
+    LargeFileView *largeFileView() { return qobject_cast<LargeFileView *>(tabView_->currentWidget()); }
     TabView *tabView() { return tabView_; }
 
     void ShowSearchDockView();
@@ -85,6 +87,7 @@ class MainWindow : public QMainWindow {
 
     bool IsExplorerDockViewShowing();
     void SetExplorerDockViewPosition(const QString &path);
+    QString ExplorerRootPath();
     void ShowExplorerDockView();
     void HideExplorerDockView();
     DockView *CreateExplorerDockView();
@@ -129,6 +132,9 @@ class MainWindow : public QMainWindow {
     void SwitchSpecialCharsVisible();
     bool specialCharsVisible() { return specialCharsVisible_; }
 
+    void SwitchMiniMapVisible();
+    bool miniMapVisible() { return miniMapVisible_; }
+
     void SwitchExplorerWindowVisible();
     void SwitchOutlineWindowVisible();
     void SwitchHierarchyWindowVisible();
@@ -164,6 +170,7 @@ class MainWindow : public QMainWindow {
     bool FindNext();
     bool FindPrevious();
     bool Replace();
+    bool FindInFiles();
 
     bool MarkUnmarkCursorText();
     bool UnmarkAll();
@@ -232,6 +239,7 @@ class MainWindow : public QMainWindow {
     bool toolBarVisible_{true};
     bool shouldWrapText_{true};
     bool specialCharsVisible_{true};
+    bool miniMapVisible_{true};
     bool explorerVisible_{true};
     bool outlineVisible_{true};
     bool hierarchyVisible_{true};
@@ -0,0 +1,70 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MARKSCANNER_H
+#define MARKSCANNER_H
+
+#include "AhoCorasick.h"
+#include <QObject>
+#include <QTextDocument>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace QEditor {
+// Find the blocks of each match of the texts to mark, such as the mark texts or the selected text.
+// All texts are found in one pass of a document snapshot in a worker thread,
+// then only the blocks touched by the changes are scanned again.
+class MarkScanner : public QObject {
+    Q_OBJECT
+   public:
+    explicit MarkScanner(const QTextDocument *document, QObject *parent = nullptr);
+    ~MarkScanner() override;
+
+    // Scan all blocks for 'patterns' in the worker thread, sigScanned() when finished.
+    void Scan(const QVector<QString> &patterns);
+    // Call it on each contentsChange of the document.
+    void HandleContentsChange(int from, int charsAdded);
+
+    // Sorted numbers of the blocks of each match, for each pattern. A block appears once for each match in it.
+    const std::vector<std::vector<int>> &blockNumbers() const { return blockNumbers_; }
+
+   signals:
+    void sigScanned();
+
+   private:
+    void StartScan();
+    void Cancel();
+    void HandleScanFinished(int scanId, std::vector<std::vector<int>> &blockNumbers);
+    // Append the block number of each match in 'text' for each pattern, counting from 'blockNumber'.
+    static bool ScanText(const AhoCorasick &automaton, const QString &text, int blockNumber,
+                         std::vector<std::vector<int>> &blockNumbers, const std::atomic<bool> &canceled);
+
+    const QTextDocument *document_;
+    std::shared_ptr<const AhoCorasick> automaton_;
+    std::vector<std::vector<int>> blockNumbers_;
+    int blockCount_{0};  // Of the document when scanned.
+
+    std::thread thread_;
+    std::atomic<bool> canceled_{false};
+    int scanId_{0};  // To drop the result of the canceled scan.
+    bool scanning_{false};
+    bool stale_{false};  // Changed while scanning.
+};
+}  // namespace QEditor
+
+#endif  // MARKSCANNER_H
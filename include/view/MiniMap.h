@@ -0,0 +1,87 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include <QImage>
+#include <QWidget>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace QEditor {
+class EditView;
+
+// An overview of the document beside the scrollbar, a pixel row for one or more blocks.
+// Drawn from a summary of each block instead of the text layout: the indent, the length and the chars of each class.
+// The summaries of a large change are computed from a document snapshot in a worker thread, the others at once,
+// and only the pixel rows of the changed blocks are drawn again into the cached image.
+class MiniMap : public QWidget {
+    Q_OBJECT
+   public:
+    explicit MiniMap(EditView *editView);
+    ~MiniMap() override;
+
+    // Call it on each contentsChange of the document.
+    void HandleContentsChange(int from, int charsAdded);
+
+   protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+   private:
+    enum CharClass { kWord, kNumber, kSymbol, kComment, kClassCount };
+    struct Summary {
+        quint16 indent{0};
+        quint16 length{0};  // Up to the last non-space char.
+        quint16 counts[kClassCount]{};
+    };
+
+    static Summary SummarizeBlock(const QChar *data, int size);
+    static bool SummarizeText(const QString &text, std::vector<Summary> &summaries, const std::atomic<bool> &canceled);
+
+    // Summarize all blocks in the worker thread, or when shown if hidden.
+    void StartSummarize();
+    void Cancel();
+    void HandleSummarized(int summarizeId, std::vector<Summary> &summaries);
+
+    // Blocks of a pixel row, less than 1 if a block takes rows.
+    qreal BlocksPerRow() const;
+    int RowOfBlock(int blockNumber) const;
+    int BlockOfRow(int row) const;
+    void RebuildImage();
+    void DrawRows(int firstRow, int lastRow);
+    void ScrollTo(int y);
+
+    EditView *editView_;
+    std::vector<Summary> summaries_ = std::vector<Summary>(1);  // An empty document has a block.
+    QImage image_;                                              // A pixel row for the blocks in it.
+    bool imageInvalid_{true};
+
+    std::thread thread_;
+    std::atomic<bool> canceled_{false};
+    int summarizeId_{0};  // To drop the result of the canceled summarizing.
+    bool summarizing_{false};
+    bool stale_{false};     // Changed while summarizing.
+    bool outdated_{false};  // Changed while hidden.
+};
+}  // namespace QEditor
+
+#endif  // MINIMAP_H
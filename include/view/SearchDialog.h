@@ -18,10 +18,18 @@
 #define DIALOG_H
 
 #include "EditView.h"
+#include "FileSearcher.h"
 #include "MainTabView.h"
 #include "SearchResultList.h"
+#include "TextSearch.h"
 #include <QDialog>
+#include <QElapsedTimer>
+#include <QPointer>
 #include <QProgressDialog>
+#include <QRegularExpression>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 namespace Ui {
 class UISearchDialog;
@@ -80,11 +88,26 @@ class SearchDialog : public QDialog {
 
     void on_radioButtonFindExtended_toggled(bool checked);
 
+    void on_pushButtonFilesFindAll_clicked();
+
+    void on_pushButtonFilesCancel_clicked();
+
    private:
     void InitSetting();
     EditView *editView();
     const QString GetSelectedText();
 
+    // Tell Count and Find All don't work in the large file view, instead of doing nothing.
+    void ShowLargeFileUnsupported();
+    // Find all in the worker thread, to list the matches in the session, or to count them if 0.
+    void StartFindAll(const QString &target, int sessionId);
+    void HandleFound(const TextMatches &matches, int progress);
+    void HandleFindAllFinished(bool canceled);
+
+    void HandleFilesFound(const std::vector<FileSearcher::FileMatches> &batch);
+    void HandleFilesProgressChanged(int scannedCount, int skippedCount);
+    void HandleFilesFinished(bool canceled);
+
    private:
     Ui::UISearchDialog *ui_;
     SearchResultList *searchResultList_{nullptr};
@@ -95,30 +118,55 @@ class SearchDialog : public QDialog {
 
     int historyIndex_{-1};
     QString searchInput_;
+
+    QProgressDialog *findAllProgress_{nullptr};
+    QPointer<EditView> findAllView_;
+    int findAllSession_{0};
+    QString findAllTarget_;
+    int findAllRevision_{0};  // The matches are out of date if changed.
+    int findAllCount_{0};
+
+    FileSearcher *fileSearcher_{nullptr};
+    int filesSession_{0};
+    QString filesRootPath_;
+    QString filesTarget_;
+    int filesHitCount_{0};
+    int filesFileCount_{0};
+    QElapsedTimer filesTimer_;
 };
 
 class Searcher : public QObject {
     Q_OBJECT
    public:
     Searcher() = default;
-    ~Searcher() = default;
+    ~Searcher();
 
     QTextCursor FindNext(const QString &text, const QTextCursor &startCursor);
     QTextCursor FindPrevious(const QString &text, const QTextCursor &startCursor);
 
-    std::vector<QTextCursor> FindAll(const QString &target,
-                                     std::function<bool(int)> progressCallback = std::function<bool(int)>());
-    std::vector<int> FindAllLineNum(const QString &target);
+    // Find all in a snapshot of the current document in the worker thread.
+    // The matches are streamed by sigFound() for each chunk of the text, then sigFindAllFinished().
+    void StartFindAll(const QString &target);
+    // sigFindAllFinished() as canceled if finding.
+    void CancelFindAll();
+    bool findingAll() const { return findingAll_; }
+    // Find all at once.
+    TextMatches FindAll(const QString &target);
+    // Find by the current options, to call in any thread.
+    TextFindFunction MakeFindFunction(const QString &target);
 
     void Replace(const QString &target, const QString &text, bool backward);
     int ReplaceAll(const QString &target, const QString &text);
 
+    bool checkBoxFindBackward() const { return checkBoxFindBackward_; }
     void setCheckBoxFindBackward(bool value);
 
     void setCheckBoxFindWholeWord(bool value);
 
+    bool checkBoxFindMatchCase() const { return checkBoxFindMatchCase_; }
     void setCheckBoxFindMatchCase(bool value);
 
+    bool checkBoxFindWrapAround() const { return checkBoxFindWrapAround_; }
     void setCheckBoxFindWrapAround(bool value);
 
     void setRadioButtonFindNormal(bool value);
@@ -130,6 +178,10 @@ class Searcher : public QObject {
     QString info() const;
     void setInfo(const QString &info);
 
+   signals:
+    void sigFound(const TextMatches &matches, int progress);
+    void sigFindAllFinished(bool canceled);
+
    private:
     QTextCursor _FindNext(const QString &text, const QTextCursor &startCursor, bool backward);
     QTextCursor _FindPrevious(const QString &text, const QTextCursor &startCursor, bool backward);
@@ -142,17 +194,36 @@ class Searcher : public QObject {
     EditView *editView();
     TabView *tabView();
 
+    using FindFunction = TextFindFunction;
+    // Compiled once for the same pattern.
+    const QRegularExpression &CachedRegularExpression(const QString &pattern);
+    // A regular expression proven to match in lines, not over them nor at the text ends only, can be split at lines.
+    static bool IsLineLocal(const QString &pattern);
+
+    // Find all in the worker thread, false if canceled.
+    bool FindInSequence(const QString &text, const FindFunction &find, int chunkSize, int findId);
+    bool FindInParallel(const QString &text, const FindFunction &find, int findId);
+    void PostFound(int findId, const std::shared_ptr<TextMatches> &matches, int progress);
+    void HandleFindAllFinished(int findId);
+
    private:
-    bool checkBoxFindBackward_;
-    bool checkBoxFindWholeWord_;
-    bool checkBoxFindMatchCase_;
-    bool checkBoxFindWrapAround_;
+    bool checkBoxFindBackward_{false};
+    bool checkBoxFindWholeWord_{false};
+    bool checkBoxFindMatchCase_{false};
+    bool checkBoxFindWrapAround_{true};
 
-    bool radioButtonFindNormal_;
-    bool radioButtonFindExtended_;
-    bool radioButtonFindRe_;
+    bool radioButtonFindNormal_{true};
+    bool radioButtonFindExtended_{false};
+    bool radioButtonFindRe_{false};
 
     QString info_;
+
+    QRegularExpression regularExpression_;
+
+    std::thread thread_;
+    std::atomic<bool> canceled_{false};
+    int findId_{0};  // To drop the matches of the canceled finding.
+    bool findingAll_{false};
 };
 
 // template<typename ...ARGS>
@@ -1,47 +0,0 @@
-/**
- * Copyright 2022 QEditor QH
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-
-#ifndef SEARCHRESULTITEM_H
-#define SEARCHRESULTITEM_H
-
-#include "EditView.h"
-#include <QTreeWidgetItem>
-
-namespace QEditor {
-class SearchResultItem : public QTreeWidgetItem {
-   public:
-    SearchResultItem(EditView *editView = nullptr);
-
-    int line() { return line_; }
-    void setLine(int line) { line_ = line; }
-
-    int position() { return position_; }
-    void setPosition(int pos) { position_ = pos; }
-
-    int len() { return len_; }
-    void setLen(int len) { len_ = len; }
-
-    EditView *editView() { return editView_; }
-
-   private:
-    EditView *editView_{nullptr};
-    int line_{0};
-    int position_{0};
-    int len_{0};
-};
-}  // namespace QEditor
-
-#endif  // SEARCHRESULTITEM_H
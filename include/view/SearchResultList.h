@@ -18,60 +18,61 @@
 #define SEARCHRESULTLIST_H
 
 #include "EditView.h"
+#include "FileSearcher.h"
 #include "Logger.h"
 #include "MainTabView.h"
+#include "SearchResultModel.h"
 #include <QStyledItemDelegate>
-#include <QTreeWidget>
+#include <QTreeView>
 
 namespace QEditor {
-// https://stackoverflow.com/questions/1956542/how-to-make-item-view-render-rich-html-text-in-qt
-class HtmlDelegate : public QStyledItemDelegate {
+// Paint the text of a result with its colors and the highlighted match, without a rich text document.
+class SearchResultDelegate : public QStyledItemDelegate {
     Q_OBJECT
    public:
-    HtmlDelegate() = default;
-    ~HtmlDelegate() = default;
+    explicit SearchResultDelegate(QObject *parent = nullptr) : QStyledItemDelegate(parent) {}
+    ~SearchResultDelegate() = default;
 
    protected:
-    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const;
-    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const;
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+   private:
+    // The parts of the text with their colors.
+    std::vector<std::pair<QString, QColor>> Parts(const QModelIndex &index) const;
 };
 
-class SearchResultList : public QTreeWidget {
+class SearchResultList : public QTreeView {
     Q_OBJECT
    public:
     SearchResultList(TabView *tabView);
-    ~SearchResultList() {
-        if (topItem_ != nullptr) {
-            delete topItem_;
-            topItem_ = nullptr;
-        }
-    }
+    ~SearchResultList() = default;
 
-    QTreeWidgetItem *StartSearchSession(EditView *editView);
-    void AddSearchResult(QTreeWidgetItem *sessionItem, const int lineNum, const QString &htmlText,
-                         const QString &plainText, const QTextCursor &cursor);
-    void FinishSearchSession(QTreeWidgetItem *sessionItem, const QString &target, int matchCount, bool finished = true);
+    // Return the session id, to add the results into.
+    int StartSearchSession(EditView *editView);
+    void AddSearchResults(int sessionId, const TextMatches &matches);
+    void FinishSearchSession(int sessionId, const QString &target, int matchCount, bool finished = true);
 
-    void HandleItemDoubleClicked(QTreeWidgetItem *item, int column);
-    void HandleItemClicked(QTreeWidgetItem *item, int column);
+    // Find in the files under 'rootPath', a child for each file, then a grandchild for each hit.
+    int StartFilesSearchSession(const QString &rootPath);
+    void AddFileSearchResults(int sessionId, const std::vector<FileSearcher::FileMatches> &batch);
+    void FinishFilesSearchSession(int sessionId, const QString &rootPath, const QString &target, int matchCount,
+                                  int fileCount, bool finished = true);
 
-    QTreeWidgetItem *topItem();
-
-    void setTopItem(QTreeWidgetItem *topItem);
+    void HandleIndexDoubleClicked(const QModelIndex &index);
 
    protected:
-    bool event(QEvent *event) override;
     void contextMenuEvent(QContextMenuEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
 
    private:
     void SetQss();
-
-    // Used for current edit view temporarily.
-    EditView *editView_{nullptr};
+    void ShowSession(int sessionId);
+    // Select by line and column, as the positions may differ by line endings.
+    static void SelectInLine(EditView *editView, int line, int column, int length);
 
     TabView *tabView_{nullptr};
-    QTreeWidgetItem *topItem_{nullptr};
+    SearchResultModel *model_{nullptr};
 
     QMenu *menu_;
 };
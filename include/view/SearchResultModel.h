@@ -0,0 +1,133 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SEARCHRESULTMODEL_H
+#define SEARCHRESULTMODEL_H
+
+#include "EditView.h"
+#include "FileSearcher.h"
+#include "OffsetTracker.h"
+#include "TextSearch.h"
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QPointer>
+#include <memory>
+#include <vector>
+
+namespace QEditor {
+// The search results as a tree: the top item, the sessions under it, the files under a session of finding in files,
+// then the hits. A hit is a compact record instead of an item, and its text is made only when it's shown.
+// The hits of a group are added as rows by fetchMore() in pages.
+// The hits in a document are plain offsets following its edits, made a cursor only when one is opened.
+class SearchResultModel : public QAbstractItemModel {
+    Q_OBJECT
+   public:
+    enum Kind { kTop, kSession, kFile, kHit };
+    enum Role {
+        kKindRole = Qt::UserRole + 1,
+        kLineRole,       // The line number of a hit, from 1.
+        kHighlightRole,  // QPoint(column, length) of the match in the display text of a hit.
+        kSuspendedRole,  // If the session is canceled.
+        kRemovedRole,    // If the text of a hit in the document is removed.
+    };
+
+    class Hit {
+       public:
+        int line_{0};
+        int offset_{0};  // Position in the document when found, or column in the line of a file.
+        int length_{0};
+    };
+
+    class Group {
+       public:
+        ~Group() { QObject::disconnect(connection_); }
+
+        Kind kind_{kTop};
+        Group *parent_{nullptr};
+        int row_{0};  // In the parent.
+        QString title_;
+        bool finished_{true};
+
+        QPointer<EditView> editView_;  // Of the hits in the document.
+        OffsetTracker offsets_;        // The current positions of the hits in the document.
+        QMetaObject::Connection connection_;
+        QString filePath_;  // Of the hits in the file.
+
+        std::vector<std::unique_ptr<Group>> children_;  // The rows before the hits.
+        std::vector<Hit> hits_;
+        // The lines of the hits in the file, as the file may not be opened. The hits in one line share it.
+        std::vector<QString> lineTexts_;
+        std::vector<int> lineTextIndexes_;
+        std::vector<int> lineTextColumns_;
+        int fetchedCount_{0};  // The hits added as rows.
+    };
+
+    explicit SearchResultModel(QObject *parent = nullptr);
+
+    // Return the id of the new session.
+    int StartSession(EditView *editView);
+    int StartFilesSession(const QString &rootPath);
+    // The sessions removed are ignored.
+    void AddHits(int sessionId, const TextMatches &matches);
+    void AddFiles(int sessionId, const std::vector<FileSearcher::FileMatches> &batch);
+    void FinishSession(int sessionId, const QString &title, bool finished);
+
+    QModelIndex topIndex() const;
+    QModelIndex sessionIndex(int sessionId) const;
+    // Null if not a group.
+    const Group *group(const QModelIndex &index) const;
+    // Null if not a hit, or the group of the hit.
+    const Hit *hit(const QModelIndex &index, const Group **group = nullptr) const;
+
+    // The current position of the hit in the document, or -1 if its text is removed.
+    int Position(const QModelIndex &index) const;
+    // The text to copy, for the hit with its line number.
+    QString PlainText(const QModelIndex &index) const;
+    // Of all sessions with all hits, including the ones not fetched.
+    QString AllPlainText() const;
+
+    void Remove(const QModelIndex &index);
+    void Clear();
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+   private:
+    Group *GroupOf(const QModelIndex &index) const;
+    QModelIndex IndexOf(const Group *group) const;
+    int AddSession(std::unique_ptr<Group> session);
+    // Add the hits as rows if the first page is not full, the others by fetchMore().
+    void FetchFirstPage(Group *group);
+    // The current line number of the hit, from 0.
+    int Line(const Group *group, int hitIndex) const;
+    // The line of the hit, cropped around the match if too long, and the column of the match in it.
+    QString LineText(const Group *group, int hitIndex, int *column) const;
+
+    Group root_;
+    Group *top_{nullptr};
+    QHash<int, Group *> sessions_;
+    int lastSessionId_{0};
+};
+}  // namespace QEditor
+
+#endif  // SEARCHRESULTMODEL_H
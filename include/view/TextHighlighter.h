@@ -51,6 +51,9 @@ class TextHighlighter : public QSyntaxHighlighter {
     QVector<QRegularExpression> commentEndExpressions_;
     QTextCharFormat commentMultiLineFormat_;
 
+    qint64 measuredNsecs_{0};
+    qint64 measuredChars_{0};
+
     const QVector<QColor> presetMarkColors_ = {
         QColor(250, 128, 114), QColor(255, 215, 0), QColor(192, 255, 62), QColor(127, 255, 212), QColor(255, 99, 71),
         QColor(200, 0, 100),   QColor(0, 255, 127), QColor(255, 0, 255),  QColor(0, 255, 255),   QColor(132, 112, 255)};
@@ -52,17 +52,14 @@ int main(int argc, char *argv[]) {
     parser.setApplicationDescription(QCoreApplication::applicationName());
     parser.addHelpOption();
     parser.addVersionOption();
-    parser.addPositionalArgument("file", "The file to open.");
+    parser.addPositionalArgument("files", "The files or folders to open.", "[files...]");
     parser.process(app);
-    QString filePath;
-    if (!parser.positionalArguments().isEmpty()) {
-        filePath = parser.positionalArguments().first();
-        qDebug() << "filePath: " << filePath;
-    }
+    auto filePaths = parser.positionalArguments();
+    qDebug() << "filePaths: " << filePaths;
 
     // Single run check.
     QEditor::SingleApp singleApp;
-    if (!singleApp.TryRun(filePath)) {
+    if (!singleApp.TryRun(filePaths)) {
         qDebug() << "Already run.";
         return 0;
     }
@@ -80,8 +77,8 @@ int main(int argc, char *argv[]) {
     }
     qDebug() << "start running";
 
-    if (!filePath.isEmpty() && QFileInfo(filePath).isFile()) {
-        QEditor::MainWindow::Instance().tabView()->OpenFile(filePath);
+    if (!filePaths.isEmpty()) {
+        QEditor::MainWindow::Instance().tabView()->OpenFiles(filePaths);
     }
 
     QEditor::MainWindow::Instance().setWindowIcon(QIcon(":/images/QEditorIcon.webp"));
@@ -0,0 +1,91 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AhoCorasick.h"
+#include <algorithm>
+
+namespace QEditor {
+AhoCorasick::AhoCorasick(const QVector<QString> &patterns) {
+    // Build the trie.
+    for (int i = 0; i < patterns.size(); ++i) {
+        const auto &pattern = patterns[i];
+        patternLengths_.emplace_back(pattern.size());
+        if (pattern.isEmpty()) {
+            continue;
+        }
+        int state = kRoot;
+        for (const auto &ch : pattern) {
+            auto next = Child(state, ch.unicode());
+            if (next == -1) {
+                next = static_cast<int>(nodes_.size());
+                auto &children = nodes_[state].children;
+                auto iter = std::lower_bound(children.begin(), children.end(), ch.unicode(),
+                                             [](const std::pair<char16_t, int> &child, char16_t c) {
+                                                 return child.first < c;
+                                             });
+                children.insert(iter, std::make_pair(ch.unicode(), next));
+                nodes_.emplace_back();
+            }
+            state = next;
+        }
+        nodes_[state].matches.emplace_back(i);
+    }
+
+    // Link the fail states in breadth first order, so the fail state is done before.
+    std::vector<int> queue;
+    for (const auto &child : nodes_[kRoot].children) {
+        queue.emplace_back(child.second);
+    }
+    for (size_t i = 0; i < queue.size(); ++i) {
+        const auto state = queue[i];
+        for (const auto &child : nodes_[state].children) {
+            auto fail = nodes_[state].fail;
+            while (fail != kRoot && Child(fail, child.first) == -1) {
+                fail = nodes_[fail].fail;
+            }
+            auto next = Child(fail, child.first);
+            auto &node = nodes_[child.second];
+            node.fail = (next == -1 || next == child.second) ? kRoot : next;
+            const auto &failMatches = nodes_[node.fail].matches;
+            node.matches.insert(node.matches.end(), failMatches.cbegin(), failMatches.cend());
+            queue.emplace_back(child.second);
+        }
+    }
+}
+
+int AhoCorasick::Next(int state, char16_t ch) const {
+    while (true) {
+        auto next = Child(state, ch);
+        if (next != -1) {
+            return next;
+        }
+        if (state == kRoot) {
+            return kRoot;
+        }
+        state = nodes_[state].fail;
+    }
+}
+
+int AhoCorasick::Child(int state, char16_t ch) const {
+    const auto &children = nodes_[state].children;
+    auto iter = std::lower_bound(children.cbegin(), children.cend(), ch,
+                                 [](const std::pair<char16_t, int> &child, char16_t c) { return child.first < c; });
+    if (iter == children.cend() || iter->first != ch) {
+        return -1;
+    }
+    return iter->second;
+}
+}  // namespace QEditor
@@ -0,0 +1,71 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "OffsetTracker.h"
+#include <algorithm>
+
+namespace QEditor {
+void OffsetTracker::Append(int offset, int length) {
+    gaps_.PushBack(offset - (gaps_.empty() ? 0 : Offset(size() - 1)));
+    lengths_.emplace_back(length);
+    removed_.emplace_back(false);
+}
+
+void OffsetTracker::Remove(int index) {
+    // The next one takes the gap.
+    if (index + 1 < size()) {
+        gaps_.Replace(index, 2, {gaps_.Value(index) + gaps_.Value(index + 1)});
+    } else {
+        gaps_.Replace(index, 1, {});
+    }
+    lengths_.erase(lengths_.begin() + index);
+    removed_.erase(removed_.begin() + index);
+}
+
+void OffsetTracker::Clear() {
+    gaps_.Clear();
+    lengths_.clear();
+    removed_.clear();
+}
+
+void OffsetTracker::HandleContentsChange(int position, int charsRemoved, int charsAdded) {
+    if ((charsRemoved == 0 && charsAdded == 0) || gaps_.empty()) {
+        return;
+    }
+    const int first = LowerBound(position);
+    const int last = LowerBound(position + charsRemoved);
+    const int lastOffset = last < size() ? Offset(last) : 0;
+
+    // Only the one before may go into the changed text, as not overlapping.
+    if (first > 0 && Offset(first - 1) + lengths_[first - 1] > position) {
+        removed_[first - 1] = true;
+    }
+
+    // The ones in the removed text go to its position, to keep the gaps not negative.
+    if (first < last) {
+        gaps_.Set(first, position - (first == 0 ? 0 : Offset(first - 1)));
+        for (int i = first + 1; i < last; ++i) {
+            gaps_.Set(i, 0);
+        }
+        std::fill(removed_.begin() + first, removed_.begin() + last, true);
+    }
+    // The ones after are moved by the gap before them.
+    if (last < size()) {
+        gaps_.Set(last, lastOffset + charsAdded - charsRemoved - (last == 0 ? 0 : Offset(last - 1)));
+    }
+}
+}  // namespace QEditor
@@ -0,0 +1,177 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TextSearch.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+namespace QEditor {
+namespace {
+char16_t Fold(char16_t ch) {
+    if (ch < 0x80) {
+        return (ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch;
+    }
+    return QChar(ch).toCaseFolded().unicode();
+}
+
+// The (folded, char) pairs of all the code units not folded to themselves, sorted, built once.
+const std::vector<std::pair<char16_t, char16_t>> &FoldedPairs() {
+    static const auto pairs = []() {
+        std::vector<std::pair<char16_t, char16_t>> res;
+        for (int ch = 0; ch <= 0xFFFF; ++ch) {
+            const auto folded = Fold(static_cast<char16_t>(ch));
+            if (folded != ch) {
+                res.emplace_back(folded, static_cast<char16_t>(ch));
+            }
+        }
+        std::sort(res.begin(), res.end());
+        return res;
+    }();
+    return pairs;
+}
+
+// All the code units folded to 'ch', e.g. 'k', 'K' and KELVIN SIGN for 'k', the same set as CharAt() matches.
+std::vector<char16_t> CaseVariants(char16_t ch, bool caseSensitive) {
+    if (caseSensitive) {
+        return {ch};
+    }
+    std::vector<char16_t> chars = {ch};
+    const auto &pairs = FoldedPairs();
+    auto iter = std::lower_bound(pairs.cbegin(), pairs.cend(), std::make_pair(ch, char16_t(0)));
+    for (; iter != pairs.cend() && iter->first == ch; ++iter) {
+        chars.emplace_back(iter->second);
+    }
+    return chars;
+}
+}  // namespace
+
+TextSearch::TextSearch(const QString &pattern, bool caseSensitive, bool wholeWord)
+    : caseSensitive_(caseSensitive), wholeWord_(wholeWord) {
+    for (const auto &ch : pattern) {
+        pattern_.emplace_back(caseSensitive ? ch.unicode() : Fold(ch.unicode()));
+    }
+    if (pattern_.empty()) {
+        return;
+    }
+    firstChars_ = CaseVariants(pattern_.front(), caseSensitive);
+    lastChars_ = CaseVariants(pattern_.back(), caseSensitive);
+
+    const int length = static_cast<int>(pattern_.size());
+    shifts_.fill(length);
+    for (int i = 0; i < length - 1; ++i) {
+        shifts_[pattern_[i] & 0xff] = length - 1 - i;
+    }
+}
+
+int TextSearch::FindAll(const QChar *data, int size, int from, int to, TextMatches &matches) const {
+    const int length = static_cast<int>(pattern_.size());
+    if (length == 0 || length > size) {
+        return to;
+    }
+    const auto text = reinterpret_cast<const char16_t *>(data);
+    // The last start of a match.
+    const auto end = std::min(to, size - length + 1);
+    if (length >= kHorspoolMinLength) {
+        return std::max(FindByHorspool(text, size, from, end, matches), to);
+    }
+
+    int next = from;  // Not to overlap the last match.
+    int pos = from;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    // The chars matching both the first and the last chars of the pattern are the candidates.
+    // Too many variants to compare, leave to the scalar loop.
+    const bool vectorized = (firstChars_.size() <= kMaxCaseVariants && lastChars_.size() <= kMaxCaseVariants);
+    __m128i firsts[kMaxCaseVariants];
+    __m128i lasts[kMaxCaseVariants];
+    const int firstCount = vectorized ? static_cast<int>(firstChars_.size()) : 0;
+    const int lastCount = vectorized ? static_cast<int>(lastChars_.size()) : 0;
+    for (int i = 0; i < firstCount; ++i) {
+        firsts[i] = _mm_set1_epi16(static_cast<short>(firstChars_[i]));
+    }
+    for (int i = 0; i < lastCount; ++i) {
+        lasts[i] = _mm_set1_epi16(static_cast<short>(lastChars_[i]));
+    }
+    for (; vectorized && pos < end && pos + length - 1 + 8 <= size; pos += 8) {
+        const auto firstChunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + pos));
+        const auto lastChunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + pos + length - 1));
+        auto firstEqual = _mm_setzero_si128();
+        for (int i = 0; i < firstCount; ++i) {
+            firstEqual = _mm_or_si128(firstEqual, _mm_cmpeq_epi16(firstChunk, firsts[i]));
+        }
+        auto lastEqual = _mm_setzero_si128();
+        for (int i = 0; i < lastCount; ++i) {
+            lastEqual = _mm_or_si128(lastEqual, _mm_cmpeq_epi16(lastChunk, lasts[i]));
+        }
+        // Two bits for each char.
+        auto mask = static_cast<quint32>(_mm_movemask_epi8(_mm_and_si128(firstEqual, lastEqual)));
+        for (; mask != 0; mask &= mask - 1, mask &= mask - 1) {
+            const auto candidate = pos + static_cast<int>(qCountTrailingZeroBits(mask)) / 2;
+            if (candidate >= end) {
+                break;
+            }
+            if (candidate >= next && Verify(text, size, candidate)) {
+                matches.emplace_back(candidate, length);
+                next = candidate + length;
+            }
+        }
+    }
+#endif
+    for (; pos < end; ++pos) {
+        if (pos >= next && CharAt(text, pos) == pattern_.front() && Verify(text, size, pos)) {
+            matches.emplace_back(pos, length);
+            next = pos + length;
+        }
+    }
+    return std::max(next, to);
+}
+
+char16_t TextSearch::CharAt(const char16_t *text, int pos) const {
+    return caseSensitive_ ? text[pos] : Fold(text[pos]);
+}
+
+bool TextSearch::Verify(const char16_t *text, int size, int pos) const {
+    const int length = static_cast<int>(pattern_.size());
+    for (int i = 0; i < length; ++i) {
+        if (CharAt(text, pos + i) != pattern_[i]) {
+            return false;
+        }
+    }
+    if (!wholeWord_) {
+        return true;
+    }
+    // The same as QTextDocument::FindWholeWords.
+    return (pos == 0 || !QChar(text[pos - 1]).isLetterOrNumber()) &&
+           (pos + length == size || !QChar(text[pos + length]).isLetterOrNumber());
+}
+
+int TextSearch::FindByHorspool(const char16_t *text, int size, int from, int to, TextMatches &matches) const {
+    const int length = static_cast<int>(pattern_.size());
+    int pos = from;
+    while (pos < to) {
+        const auto last = CharAt(text, pos + length - 1);
+        if (last == pattern_.back() && Verify(text, size, pos)) {
+            matches.emplace_back(pos, length);
+            pos += length;
+            continue;
+        }
+        pos += shifts_[last & 0xff];
+    }
+    return pos;
+}
+}  // namespace QEditor
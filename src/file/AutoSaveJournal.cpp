@@ -0,0 +1,299 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AutoSaveJournal.h"
+#include "Constants.h"
+#include "FileRecorder.h"
+#include "Utils.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace QEditor {
+AutoSaveJournal &AutoSaveJournal::Instance() {
+    static AutoSaveJournal _autoSaveJournal;
+    return _autoSaveJournal;
+}
+
+AutoSaveJournal::AutoSaveJournal() : nextGeneration_(QDateTime::currentMSecsSinceEpoch()) {
+    // Start after the ids left by the last session.
+    QDir dir(DirPath());
+    for (const auto &fileInfo : dir.entryInfoList(QDir::Files)) {
+        bool ok;
+        int id = fileInfo.baseName().toInt(&ok);
+        if (ok && id >= nextId_) {
+            nextId_ = id + 1;
+        }
+    }
+}
+
+AutoSaveJournal::~AutoSaveJournal() {
+    Stop();
+    delete thread_;
+}
+
+void AutoSaveJournal::Rebase(int id, int mibEnum, const QString &text) {
+    Operation operation;
+    operation.type = Operation::kRebase;
+    operation.id = id;
+    operation.mibEnum = mibEnum;
+    operation.text = text;
+    Enqueue(std::move(operation));
+}
+
+void AutoSaveJournal::Append(int id, int position, int charsRemoved, const QString &insertedText) {
+    {
+        QMutexLocker locker(&mutex_);
+        if (!operations_.empty()) {
+            // Merge the typing or deleting continuously into the last change.
+            auto &last = operations_.back();
+            auto lastEnd = last.position + last.text.size();
+            if (last.type == Operation::kAppend && last.id == id) {
+                if (charsRemoved == 0 && position == lastEnd) {
+                    last.text += insertedText;
+                    return;
+                }
+                if (insertedText.isEmpty() && position + charsRemoved == lastEnd && charsRemoved <= last.text.size()) {
+                    last.text.chop(charsRemoved);
+                    return;
+                }
+            }
+        }
+    }
+    Operation operation;
+    operation.type = Operation::kAppend;
+    operation.id = id;
+    operation.position = position;
+    operation.charsRemoved = charsRemoved;
+    operation.text = insertedText;
+    Enqueue(std::move(operation));
+}
+
+void AutoSaveJournal::Retain(const QSet<int> &ids) {
+    Operation operation;
+    operation.type = Operation::kRetain;
+    operation.ids = ids;
+    Enqueue(std::move(operation));
+}
+
+void AutoSaveJournal::Enqueue(Operation &&operation) {
+    {
+        QMutexLocker locker(&mutex_);
+        if (stopped_) {
+            return;
+        }
+        operations_.emplace_back(std::move(operation));
+    }
+    if (thread_ == nullptr) {
+        thread_ = new QThread();
+        moveToThread(thread_);
+        connect(thread_, &QThread::started, this, &AutoSaveJournal::HandleStartInThread);
+        thread_->start();
+    }
+}
+
+void AutoSaveJournal::Stop() {
+    {
+        QMutexLocker locker(&mutex_);
+        if (stopped_) {
+            return;
+        }
+        stopped_ = true;
+    }
+    if (thread_ != nullptr) {
+        QMetaObject::invokeMethod(this, &AutoSaveJournal::HandleStopInThread, Qt::QueuedConnection);
+        thread_->wait();
+    }
+    // The thread finished, write the rest here.
+    Flush();
+}
+
+void AutoSaveJournal::HandleStartInThread() {
+    timer_ = new QTimer(this);
+    connect(timer_, &QTimer::timeout, this, &AutoSaveJournal::HandleTimeout);
+    timer_->start(Constants::kAutoSaveFlushInterval);
+}
+
+void AutoSaveJournal::HandleStopInThread() {
+    delete timer_;
+    timer_ = nullptr;
+    QThread::currentThread()->quit();
+}
+
+void AutoSaveJournal::HandleTimeout() { Flush(); }
+
+void AutoSaveJournal::Flush() {
+    std::vector<Operation> operations;
+    {
+        QMutexLocker locker(&mutex_);
+        operations.swap(operations_);
+    }
+    if (operations.empty()) {
+        return;
+    }
+    (void)Utils::mkdir(DirPath());
+
+    QSet<int> appendedIds;
+    for (const auto &operation : operations) {
+        switch (operation.type) {
+            case Operation::kRebase:
+                if (!WriteBase(operation.id, operation.mibEnum, operation.text)) {
+                    // The changes after can't apply on the old base.
+                    generations_.remove(operation.id);
+                }
+                break;
+            case Operation::kAppend: {
+                const auto generation = generations_.constFind(operation.id);
+                if (generation == generations_.cend()) {
+                    qCritical() << "No base for the journal " << operation.id;
+                    break;
+                }
+                QFile file(JournalPath(operation.id));
+                if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+                    qCritical() << "Open failed, " << file.errorString() << ", file: " << file.fileName();
+                    break;
+                }
+                QDataStream stream(&file);
+                if (file.size() == 0) {
+                    stream << generation.value();
+                }
+                stream << static_cast<qint32>(operation.position) << static_cast<qint32>(operation.charsRemoved)
+                       << operation.text;
+                ++recordCounts_[operation.id];
+                appendedIds.insert(operation.id);
+                break;
+            }
+            case Operation::kRetain:
+                RemoveOthers(operation.ids);
+                break;
+        }
+    }
+
+    // Keep the journal small to replay.
+    for (auto id : appendedIds) {
+        if (recordCounts_.value(id) > Constants::kAutoSaveJournalMaxRecordNum ||
+            QFileInfo(JournalPath(id)).size() > Constants::kAutoSaveJournalMaxSize) {
+            Compact(id);
+        }
+    }
+}
+
+bool AutoSaveJournal::WriteBase(int id, int mibEnum, const QString &text) {
+    QSaveFile file(BasePath(id));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCritical() << "Open failed, " << file.errorString() << ", file: " << file.fileName();
+        return false;
+    }
+    const auto generation = nextGeneration_++;
+    QDataStream stream(&file);
+    stream << generation << FileRecorder::FileData(mibEnum, text);
+    // Keep the old base and journal if failed.
+    if (!file.commit()) {
+        qCritical() << "Write failed, " << file.errorString() << ", file: " << file.fileName();
+        return false;
+    }
+    // The journal was on the old base. Ignored by the generation if not removed.
+    (void)QFile::remove(JournalPath(id));
+    recordCounts_.remove(id);
+    generations_.insert(id, generation);
+    return true;
+}
+
+void AutoSaveJournal::Compact(int id) {
+    int mibEnum;
+    QString text;
+    if (!Load(id, &mibEnum, &text)) {
+        return;
+    }
+    qDebug() << "Compact journal " << id << ", records: " << recordCounts_.value(id);
+    (void)WriteBase(id, mibEnum, text);
+}
+
+void AutoSaveJournal::RemoveOthers(const QSet<int> &ids) {
+    QDir dir(DirPath());
+    for (const auto &fileInfo : dir.entryInfoList(QDir::Files)) {
+        // Both "<id>" and "<id>.journal".
+        bool ok;
+        int id = fileInfo.baseName().toInt(&ok);
+        if (!ok || ids.contains(id)) {
+            continue;
+        }
+        (void)QFile::remove(fileInfo.absoluteFilePath());
+        recordCounts_.remove(id);
+        generations_.remove(id);
+    }
+}
+
+bool AutoSaveJournal::Load(int id, int *mibEnum, QString *text) {
+    QFile baseFile(BasePath(id));
+    if (!baseFile.open(QIODevice::ReadOnly)) {
+        qDebug() << "Not exists, " << baseFile.fileName();
+        return false;
+    }
+    qint64 baseGeneration;
+    FileRecorder::FileData fileData;
+    QDataStream baseStream(&baseFile);
+    baseStream >> baseGeneration >> fileData;
+    if (baseStream.status() != QDataStream::Ok) {
+        qCritical() << "Read failed, file: " << baseFile.fileName();
+        return false;
+    }
+    *mibEnum = fileData.mibEnum_;
+    *text = std::move(fileData.text_);
+
+    // No change since rebased.
+    QFile journalFile(JournalPath(id));
+    if (!journalFile.open(QIODevice::ReadOnly)) {
+        return true;
+    }
+    QDataStream stream(&journalFile);
+    qint64 generation;
+    stream >> generation;
+    if (stream.status() != QDataStream::Ok || generation != baseGeneration) {
+        qCritical() << "Drop the journal of another base, file: " << journalFile.fileName();
+        return true;
+    }
+    while (!stream.atEnd()) {
+        qint32 position;
+        qint32 charsRemoved;
+        QString insertedText;
+        stream >> position >> charsRemoved >> insertedText;
+        // Interrupted while writing the last record.
+        if (stream.status() != QDataStream::Ok) {
+            qCritical() << "Drop the incomplete record, file: " << journalFile.fileName();
+            break;
+        }
+        if (position < 0 || charsRemoved < 0 || position + charsRemoved > text->size()) {
+            qCritical() << "Wrong record @" << position << ", -" << charsRemoved
+                        << ", file: " << journalFile.fileName();
+            break;
+        }
+        text->replace(position, charsRemoved, insertedText);
+    }
+    return true;
+}
+
+QString AutoSaveJournal::DirPath() {
+    return Constants::kAppInternalPath + Constants::kAppInternalAutoSaveDirName + "/";
+}
+
+QString AutoSaveJournal::BasePath(int id) { return DirPath() + QString::number(id); }
+
+QString AutoSaveJournal::JournalPath(int id) { return DirPath() + QString::number(id) + ".journal"; }
+}  // namespace QEditor
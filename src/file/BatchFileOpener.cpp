@@ -0,0 +1,114 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BatchFileOpener.h"
+#include "Constants.h"
+#include "FileEncoding.h"
+#include "FileLoader.h"
+#include <QElapsedTimer>
+#include <QFile>
+
+namespace QEditor {
+BatchFileOpener::BatchFileOpener(QObject *parent) : QObject(parent) {
+    pool_.setMaxThreadCount(QThread::idealThreadCount());
+    timer_.setInterval(Constants::kBatchOpenFrameInterval);
+    connect(&timer_, &QTimer::timeout, this, &BatchFileOpener::HandleTimeout);
+}
+
+BatchFileOpener::~BatchFileOpener() {
+    canceled_ = true;
+    pool_.waitForDone();
+}
+
+void BatchFileOpener::Open(const QStringList &filePaths) {
+    for (const auto &filePath : filePaths) {
+        int index = totalCount_++;
+        pool_.start([this, index, filePath]() { Decode(index, filePath); });
+    }
+    if (!timer_.isActive()) {
+        timer_.start();
+    }
+}
+
+void BatchFileOpener::Decode(int index, const QString &filePath) {
+    if (canceled_) {
+        return;
+    }
+    Result result;
+    result.filePath_ = filePath;
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+        result.errorString_ = file.errorString();
+    } else {
+        // The same as TabView::LoadFile(), but decode to the end here.
+        FileEncoding fileEncoding(file);
+        file.close();
+        FileLoader loader(filePath, fileEncoding.codec(), fileEncoding.hasBom(), false);
+        connect(&loader, &FileLoader::sigEncodingDetected, [&result](int mibEnum, bool hasBom) {
+            result.mibEnum_ = mibEnum;
+            result.hasBom_ = hasBom;
+        });
+        connect(&loader, &FileLoader::sigRestarted, [&result]() { result.text_.clear(); });
+        connect(&loader, &FileLoader::sigChunkLoaded, [this, &loader, &result](const QString &text) {
+            result.text_ += text;
+            if (canceled_) {
+                loader.Cancel();
+            }
+        });
+        connect(&loader, &FileLoader::sigFinished, [&result](bool success, const QString &errorString) {
+            result.success_ = success;
+            result.errorString_ = errorString;
+        });
+        loader.Load();
+        result.loadedSize_ = loader.loadedSize();
+        result.compressed_ = loader.compressed();
+    }
+    if (canceled_) {
+        return;
+    }
+    QMutexLocker locker(&mutex_);
+    results_.insert(index, std::move(result));
+}
+
+void BatchFileOpener::HandleTimeout() {
+    // Not to block UI too long in one frame, but pass one at least.
+    QElapsedTimer elapsedTimer;
+    elapsedTimer.start();
+    int passedCount = 0;
+    while (passedCount == 0 || elapsedTimer.elapsed() < Constants::kBatchOpenFrameBudget) {
+        Result result;
+        {
+            QMutexLocker locker(&mutex_);
+            auto iter = results_.find(nextIndex_);
+            if (iter == results_.end()) {
+                break;
+            }
+            result = std::move(iter.value());
+            results_.erase(iter);
+        }
+        ++nextIndex_;
+        ++passedCount;
+        emit sigFileDecoded(result);
+    }
+    if (passedCount != 0) {
+        emit sigProgressChanged(nextIndex_, totalCount_);
+    }
+    if (nextIndex_ == totalCount_) {
+        timer_.stop();
+        emit sigFinished();
+    }
+}
+}  // namespace QEditor
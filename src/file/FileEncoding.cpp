@@ -16,6 +16,12 @@
 
 #include "FileEncoding.h"
 #include <QList>
+#include <QtAlgorithms>
+#include <thread>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
 
 namespace QEditor {
 QStringList FileEncoding::encodingNameList_ = {
@@ -266,64 +272,193 @@ QMap<QString, int> FileEncoding::encodingNameToMib_ = {
 QStringList FileEncoding::encodingNames() { return encodingNameList_; }
 
 QString FileEncoding::ProcessAnsi(QFile &file) {
-    // If no BOM, we try to decode by UTF8 firstly,
-    // then decode by other codeces if failed.
+    // If no BOM, we validate UTF-8 firstly, then rank other codecs on samples if failed,
+    // so the whole data is decoded only once.
     const QByteArray &data = file.readAll();
-    QTextCodec::ConverterState state;
-    // FileEncoding.codec is UTF8 in default.
-    QTextCodec *utf8Codec = QTextCodec::codecForMib(106);
-    QString ansiText = utf8Codec->toUnicode(data.constData(), data.size(), &state);
-    qDebug() << "codec: " << utf8Codec->name() << ", invalidChars: " << state.invalidChars
-             << ", text: " << ansiText.mid(0, 15) << "..., bytearry: " << data.mid(0, 15).data() << "...";
-    if (state.invalidChars == 0) {
-        setCodec(utf8Codec);
-        return ansiText;
+    QTextCodec *codec = QTextCodec::codecForMib(106);
+    if (!ValidateUtf8(data.constData(), data.size())) {
+        codec = DetectAnsiCodec(data.constData(), data.size());
     }
+    qDebug() << "codec: " << codec->name() << ", bytearry: " << data.mid(0, 15).data() << "...";
+    setCodec(codec);
+    return codec->toUnicode(data.constData(), data.size());
+}
 
-    // Use System.
-    auto systemCodec = QTextCodec::codecForLocale();                // QTextCodec::codecForName("System"); //
-                                                                    // QTextCodec::codecForMib(0); // Use system codec.
-    if (systemCodec != nullptr && systemCodec->mibEnum() != 106) {  // Not UTF-8.
-        qDebug() << "systemCodec: " << systemCodec << ", " << systemCodec->name() << ", " << systemCodec->mibEnum();
-        setCodec(systemCodec);
-        const auto &ansiText = systemCodec->toUnicode(data.constData());
-        return ansiText;
+namespace {
+// Length of the leading ASCII bytes.
+qint64 AsciiLength(const uchar *data, qint64 size) {
+    qint64 pos = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    // Check 16 bytes at once, the high bit of any non-ASCII byte is set.
+    for (; pos + 16 <= size; pos += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+        auto mask = static_cast<quint32>(_mm_movemask_epi8(chunk));
+        if (mask != 0) {
+            return pos + qCountTrailingZeroBits(mask);
+        }
     }
+#endif
+    while (pos < size && data[pos] < 0x80) {
+        ++pos;
+    }
+    return pos;
+}
 
-    // Use GBK.
-    auto gbkCodec = QTextCodec::codecForMib(113);  // GBK
-    if (gbkCodec != nullptr) {
-        qDebug() << "gbkCodec: " << gbkCodec << ", " << gbkCodec->name() << ", " << gbkCodec->mibEnum();
-        setCodec(gbkCodec);
-        const auto &ansiText = gbkCodec->toUnicode(data.constData());
-        return ansiText;
+// Return the offset of the first invalid sequence, or 'size' if all valid.
+// The sequence truncated by the end is taken as valid if 'allowTruncated'.
+qint64 FindInvalidUtf8(const uchar *data, qint64 size, bool allowTruncated) {
+    qint64 pos = 0;
+    while (pos < size) {
+        pos += AsciiLength(data + pos, size - pos);
+        if (pos >= size) {
+            break;
+        }
+        // Well-formed sequences, see table 3-7 of the Unicode standard.
+        uchar lead = data[pos];
+        int length = 0;
+        uchar low = 0x80;
+        uchar high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            if (lead == 0xE0) {
+                low = 0xA0;
+            } else if (lead == 0xED) {  // No surrogates.
+                high = 0x9F;
+            }
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            if (lead == 0xF0) {
+                low = 0x90;
+            } else if (lead == 0xF4) {  // Not beyond U+10FFFF.
+                high = 0x8F;
+            }
+        } else {
+            return pos;
+        }
+        for (int i = 1; i < length; ++i) {
+            if (pos + i >= size) {
+                return allowTruncated ? size : pos;
+            }
+            uchar byte = data[pos + i];
+            if (byte < (i == 1 ? low : 0x80) || byte > (i == 1 ? high : 0xBF)) {
+                return pos;
+            }
+        }
+        pos += length;
+    }
+    return size;
+}
+
+// The windows [start, end) to sample, or the whole buffer if small.
+std::vector<std::pair<qint64, qint64>> SampleWindows(qint64 size) {
+    std::vector<std::pair<qint64, qint64>> windows;
+    const qint64 count = Constants::kEncodingSampleWindowCount;
+    const qint64 windowSize = Constants::kEncodingSampleWindowSize;
+    if (size <= count * windowSize) {
+        windows.emplace_back(0, size);
+        return windows;
+    }
+    for (qint64 i = 0; i < count; ++i) {
+        auto start = i * (size - windowSize) / (count - 1);
+        windows.emplace_back(start, start + windowSize);
     }
+    return windows;
+}
+
+// The candidates in order of preference, the former wins if same score.
+QVector<QTextCodec *> AnsiCandidates() {
+    QVector<QTextCodec *> candidates{FileEncoding::AnsiCodec()};
+    // GB18030, Big5, Shift_JIS, EUC-JP, EUC-KR, windows-1251, windows-1252, ISO-8859-1.
+    for (int mibEnum : {113, 114, 2026, 17, 18, 38, 2251, 2252, 4}) {
+        auto codec = QTextCodec::codecForMib(mibEnum);
+        if (codec != nullptr && !candidates.contains(codec)) {
+            candidates.append(codec);
+        }
+    }
+    return candidates;
+}
 
-    // If no BOM, and not UTF-8..., we try to find proper codec.
-    QTextCodec *bestCodec;
-    int minInvalidCharsNum = data.size();
-    for (const auto &name : encodingNames()) {
-        auto codec = QTextCodec::codecForName(name.toLocal8Bit().data());
-        if (codec == nullptr) {
-            continue;
+// Less is better. Count the invalid chars, and the private use or C1 control chars
+// which a wrong codec tends to produce.
+int ScoreCodec(QTextCodec *codec, const char *data, const std::vector<std::pair<qint64, qint64>> &windows) {
+    int score = 0;
+    for (const auto &window : windows) {
+        QTextCodec::ConverterState state;
+        const auto &text = codec->toUnicode(data + window.first, window.second - window.first, &state);
+        score += state.invalidChars;
+        for (const auto &ch : text) {
+            auto unicode = ch.unicode();
+            if ((unicode >= 0xE000 && unicode <= 0xF8FF) || (unicode >= 0x80 && unicode <= 0x9F)) {
+                ++score;
+            }
         }
-        QTextCodec::ConverterState check_state;
-        ansiText = codec->toUnicode(data.constData(), data.size(), &check_state);
-        qDebug() << "codec: " << codec->name() << ", invalidChars: " << check_state.invalidChars
-                 << ", minInvalidCharsNum: " << minInvalidCharsNum << ", text: " << ansiText.mid(0, 15)
-                 << "..., bytearry: " << data.mid(0, 15).data() << "...";
-        if (check_state.invalidChars == 0) {
-            bestCodec = codec;
+    }
+    return score;
+}
+}  // namespace
+
+bool FileEncoding::ValidateUtf8(const char *data, qint64 size) {
+    return FindInvalidUtf8(reinterpret_cast<const uchar *>(data), size, false) == size;
+}
+
+QTextCodec *FileEncoding::DetectCodec(const char *data, qint64 size) {
+    auto bytes = reinterpret_cast<const uchar *>(data);
+    bool isUtf8 = true;
+    for (const auto &window : SampleWindows(size)) {
+        auto start = window.first;
+        // Skip the continuation bytes of the sequence split by window start.
+        for (int i = 0; i < 3 && start > 0 && start < window.second && (bytes[start] & 0xC0) == 0x80; ++i) {
+            ++start;
+        }
+        auto length = window.second - start;
+        if (FindInvalidUtf8(bytes + start, length, window.second != size) != length) {
+            isUtf8 = false;
             break;
         }
+    }
+    if (isUtf8) {
+        return QTextCodec::codecForMib(106);
+    }
+    return DetectAnsiCodec(data, size);
+}
 
-        if (check_state.invalidChars < minInvalidCharsNum) {
-            bestCodec = codec;
-            minInvalidCharsNum = check_state.invalidChars;
+QTextCodec *FileEncoding::DetectAnsiCodec(const char *data, qint64 size) {
+    const auto &windows = SampleWindows(size);
+    const auto &candidates = AnsiCandidates();
+    std::vector<int> scores(candidates.size(), 0);
+    // Score each candidate in its own thread.
+    std::vector<std::thread> threads;
+    threads.reserve(candidates.size());
+    for (int i = 0; i < candidates.size(); ++i) {
+        threads.emplace_back([&, i]() { scores[i] = ScoreCodec(candidates[i], data, windows); });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    int best = 0;
+    for (int i = 1; i < candidates.size(); ++i) {
+        if (scores[i] < scores[best]) {
+            best = i;
         }
     }
-    setCodec(bestCodec);
-    return ansiText;
+    qDebug() << "best codec: " << candidates[best]->name() << ", score: " << scores[best];
+    return candidates[best];
+}
+
+QTextCodec *FileEncoding::AnsiCodec() {
+    auto systemCodec = QTextCodec::codecForLocale();
+    if (systemCodec != nullptr && systemCodec->mibEnum() != 106) {  // Not UTF-8.
+        return systemCodec;
+    }
+    auto gbkCodec = QTextCodec::codecForMib(113);  // GBK
+    if (gbkCodec != nullptr) {
+        return gbkCodec;
+    }
+    // ISO-8859-1 decodes any byte, the first one without invalid chars in encodingNames().
+    return QTextCodec::codecForMib(4);
 }
 
 int FileEncoding::GetMibByName(const QString &name) {
@@ -0,0 +1,121 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FileFollower.h"
+#include "Constants.h"
+#include <QFile>
+#include <QFileInfo>
+
+namespace QEditor {
+FileFollower::FileFollower(const QString &filePath, QTextCodec *codec, qint64 offset)
+    : filePath_(filePath), codec_(codec), decoder_(codec->makeDecoder()), offset_(offset) {}
+
+FileFollower::~FileFollower() {
+    Stop();
+    delete thread_;
+}
+
+void FileFollower::Start() {
+    thread_ = new QThread();
+    moveToThread(thread_);
+    connect(thread_, &QThread::started, this, &FileFollower::HandleStartInThread);
+    thread_->start();
+}
+
+void FileFollower::Stop() {
+    if (thread_ == nullptr || !thread_->isRunning()) {
+        return;
+    }
+    // The watcher and the timer are deleted in their thread.
+    QMetaObject::invokeMethod(this, &FileFollower::HandleStopInThread, Qt::QueuedConnection);
+    thread_->wait();
+}
+
+void FileFollower::HandleStartInThread() {
+    // QFileSystemWatcher works on inotify in Linux.
+    watcher_ = new QFileSystemWatcher(this);
+    connect(watcher_, &QFileSystemWatcher::fileChanged, this, &FileFollower::HandleFileChanged);
+    (void)watcher_->addPath(filePath_);
+
+    // To watch again after the file is rotated, and poll in case no notification, e.g. on network file system.
+    timer_ = new QTimer(this);
+    connect(timer_, &QTimer::timeout, this, &FileFollower::HandleTimeout);
+    timer_->start(Constants::kFileFollowPollInterval);
+
+    // The file may grow after loaded.
+    ReadAppended();
+}
+
+void FileFollower::HandleStopInThread() {
+    delete timer_;
+    timer_ = nullptr;
+    delete watcher_;
+    watcher_ = nullptr;
+    QThread::currentThread()->quit();
+}
+
+void FileFollower::HandleFileChanged() {
+    // Removed or renamed, wait for the new one.
+    if (!watcher_->files().contains(filePath_)) {
+        qDebug() << "File removed or renamed, " << filePath_;
+        return;
+    }
+    ReadAppended();
+}
+
+void FileFollower::HandleTimeout() {
+    if (!watcher_->files().contains(filePath_)) {
+        if (!QFileInfo::exists(filePath_) || !watcher_->addPath(filePath_)) {
+            return;
+        }
+        qDebug() << "File rotated, " << filePath_;
+        Reset();
+    }
+    ReadAppended();
+}
+
+void FileFollower::Reset() {
+    offset_ = 0;
+    decoder_.reset(codec_->makeDecoder());
+    emit sigReset();
+}
+
+void FileFollower::ReadAppended() {
+    QFile file(filePath_);
+    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+        return;
+    }
+    if (file.size() < offset_) {
+        qDebug() << "File truncated, " << filePath_;
+        Reset();
+    }
+    if (file.size() == offset_ || !file.seek(offset_)) {
+        return;
+    }
+    while (!file.atEnd()) {
+        const auto &data = file.read(Constants::kFileLoadChunkSize);
+        if (data.isEmpty()) {
+            break;
+        }
+        // The decoder keeps the state, for the multi-byte char split by writer.
+        const auto &text = decoder_->toUnicode(data);
+        if (!text.isEmpty()) {
+            emit sigTextAppended(text);
+        }
+    }
+    offset_ = file.pos();
+}
+}  // namespace QEditor
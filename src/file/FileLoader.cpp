@@ -0,0 +1,271 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FileLoader.h"
+#include "Constants.h"
+#include "FileEncoding.h"
+#include <QFileInfo>
+#include <algorithm>
+#include <memory>
+
+namespace QEditor {
+FileLoader::FileLoader(const QString &filePath, QTextCodec *codec, bool hasBom, bool forceUseCodec)
+    : filePath_(filePath), codec_(codec), hasBom_(hasBom), forceUseCodec_(forceUseCodec) {}
+
+FileLoader::FileLoader(const QString &filePath, std::shared_ptr<const RawBytes> rawBytes, QTextCodec *codec,
+                       bool hasBom)
+    : filePath_(filePath), codec_(codec), hasBom_(hasBom), forceUseCodec_(true), rawBytes_(std::move(rawBytes)) {}
+
+FileLoader::~FileLoader() {
+    Cancel();
+    delete thread_;
+}
+
+void FileLoader::Start() {
+    thread_ = new QThread();
+    moveToThread(thread_);
+    connect(thread_, &QThread::started, this, &FileLoader::HandleLoadInThread);
+    thread_->start();
+}
+
+void FileLoader::Cancel() {
+    canceled_ = true;
+    if (thread_ == nullptr) {
+        return;
+    }
+    thread_->quit();
+    thread_->wait();
+}
+
+void FileLoader::HandleLoadInThread() {
+    Load();
+    QThread::currentThread()->quit();
+}
+
+void FileLoader::Load() {
+    QFile file(filePath_);
+    if (rawBytes_ != nullptr) {
+        format_ = rawBytes_->format_;
+        fileSize_ = rawBytes_->size_;
+        emit sigEncodingDetected(codec_->mibEnum(), hasBom_);
+        bool success = Decode(file, codec_, false);
+        loadedSize_ = rawBytes_->loadedSize_;
+        if (!canceled_) {
+            emit sigFinished(success, errorString_);
+        }
+        return;
+    }
+
+    // Open in binary firstly, the compressed data must not be changed by text mode.
+    if (!file.open(QFile::ReadOnly)) {
+        emit sigFinished(false, file.errorString());
+        return;
+    }
+    auto lastModified = QFileInfo(file).lastModified();
+    fileSize_ = file.size();
+    format_ = StreamDecompressor::DetectFormat(file.peek(6));
+    if (format_ == StreamDecompressor::kNone) {
+        file.setTextModeEnabled(true);
+    } else if (StreamDecompressor::Create(format_) == nullptr) {
+        emit sigFinished(false, tr("Not supported compression format: ") + StreamDecompressor::FormatName(format_));
+        return;
+    }
+
+    // If no BOM, detect the codec on samples. If UTF-8 is chosen but an invalid sequence
+    // out of the samples is met, restart by ANSI codec.
+    auto codec = codec_;
+    auto hasBom = hasBom_;
+    bool tryUtf8 = false;
+    if (!hasBom_ && !forceUseCodec_) {
+        codec = DetectCodec(file, false, &hasBom);
+        tryUtf8 = (codec->mibEnum() == 106 && !hasBom);
+    }
+    emit sigEncodingDetected(codec->mibEnum(), hasBom);
+    bool success = Decode(file, codec, tryUtf8);
+    if (!success && tryUtf8 && !canceled_ && errorString_.isEmpty()) {
+        auto ansiCodec = DetectCodec(file, true, nullptr);
+        qDebug() << "Not UTF-8, restart with " << ansiCodec->name() << ", file: " << filePath_;
+        emit sigRestarted();
+        emit sigEncodingDetected(ansiCodec->mibEnum(), false);
+        success = Decode(file, ansiCodec, false);
+    }
+    if (success && !canceled_ && newRawBytes_ != nullptr) {
+        newRawBytes_->loadedSize_ = loadedSize_;
+        newRawBytes_->format_ = format_;
+        newRawBytes_->lastModified_ = lastModified;
+        RawByteCache::Instance().Put(filePath_, std::move(newRawBytes_));
+    }
+    newRawBytes_.reset();
+    if (!canceled_) {
+        emit sigFinished(success, errorString_);
+    }
+}
+
+QTextCodec *FileLoader::DetectCodec(QFile &file, bool ansiOnly, bool *hasBom) {
+    if (format_ != StreamDecompressor::kNone) {
+        // Only the head of the decompressed data.
+        QByteArray head;
+        (void)Read(file, [&head](const char *data, qint64 size) {
+            head.append(data, static_cast<int>(size));
+            return head.size() < Constants::kEncodingHeadSampleSize;
+        });
+        errorString_.clear();
+        auto bomCodec = QTextCodec::codecForUtfText(head.left(4), nullptr);
+        if (!ansiOnly && bomCodec != nullptr) {
+            *hasBom = true;
+            return bomCodec;
+        }
+        return ansiOnly ? FileEncoding::DetectAnsiCodec(head.constData(), head.size())
+                        : FileEncoding::DetectCodec(head.constData(), head.size());
+    }
+
+    // Only the sampled pages of the map are read.
+    auto size = file.size();
+    auto map = file.map(0, size);
+    auto data = reinterpret_cast<const char *>(map);
+    QByteArray head;
+    if (map == nullptr) {
+        head = file.peek(Constants::kEncodingHeadSampleSize);
+        data = head.constData();
+        size = head.size();
+    }
+    auto codec = ansiOnly ? FileEncoding::DetectAnsiCodec(data, size) : FileEncoding::DetectCodec(data, size);
+    if (map != nullptr) {
+        file.unmap(map);
+    }
+    return codec;
+}
+
+bool FileLoader::ReadRawBytes(const StreamDecompressor::Consumer &consumer) {
+    for (const auto &chunk : rawBytes_->chunks_) {
+        if (canceled_) {
+            return false;
+        }
+        const auto &data = qUncompress(chunk);
+        readSize_ += chunk.size();
+        if (!consumer(data.constData(), data.size())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FileLoader::Read(QFile &file, const StreamDecompressor::Consumer &consumer) {
+    readSize_ = 0;
+    if (rawBytes_ != nullptr) {
+        return ReadRawBytes(consumer);
+    }
+    (void)file.seek(0);
+    std::unique_ptr<StreamDecompressor> decompressor;
+    if (format_ != StreamDecompressor::kNone) {
+        decompressor = StreamDecompressor::Create(format_);
+    }
+    // As text mode does, drop all '\r' of the decompressed data.
+    auto textConsumer = [&consumer](const char *data, qint64 size) {
+        QByteArray text(data, static_cast<int>(size));
+        text.resize(static_cast<int>(std::remove(text.begin(), text.end(), '\r') - text.begin()));
+        return consumer(text.constData(), text.size());
+    };
+
+    qint64 chunkSize = Constants::kFileLoadFirstChunkSize;
+    while (!file.atEnd()) {
+        if (canceled_) {
+            return false;
+        }
+        const auto &data = file.read(chunkSize);
+        if (data.isEmpty()) {
+            break;
+        }
+        readSize_ = file.pos();
+        if (decompressor == nullptr) {
+            if (!consumer(data.constData(), data.size())) {
+                return false;
+            }
+        } else if (!decompressor->Decompress(data.constData(), data.size(), textConsumer)) {
+            errorString_ = decompressor->errorString();
+            return false;
+        }
+        chunkSize = Constants::kFileLoadChunkSize;
+    }
+    if (file.error() != QFile::NoError) {
+        qCritical() << "Read failed, " << file.errorString() << ", file: " << filePath_;
+        errorString_ = file.errorString();
+        return false;
+    }
+    if (decompressor != nullptr && !decompressor->Finish(textConsumer)) {
+        errorString_ = decompressor->errorString();
+        return false;
+    }
+    return true;
+}
+
+bool FileLoader::Decode(QFile &file, QTextCodec *codec, bool stopIfFailure) {
+    std::unique_ptr<QTextDecoder> decoder(codec->makeDecoder());
+    QString pendingText;
+    percent_ = -1;
+    // Keep the raw bytes compressed fast, to decode by other codec later.
+    if (rawBytes_ == nullptr) {
+        newRawBytes_ = std::make_shared<RawBytes>();
+    }
+    bool success = Read(file, [&](const char *data, qint64 size) {
+        if (canceled_) {
+            return false;
+        }
+        if (newRawBytes_ != nullptr) {
+            const auto &chunk = qCompress(reinterpret_cast<const uchar *>(data), static_cast<int>(size), 1);
+            newRawBytes_->chunks_.emplace_back(chunk);
+            newRawBytes_->size_ += chunk.size();
+            // Too large for the cache to keep, not to compress the rest for nothing.
+            if (newRawBytes_->size_ > Constants::kRawByteCacheMaxSize / 2) {
+                qDebug() << "Too large to cache the raw bytes, file: " << filePath_;
+                newRawBytes_.reset();
+            }
+        }
+        // The decoder keeps the state, for the multi-byte char split by chunks.
+        pendingText += decoder->toUnicode(data, static_cast<int>(size));
+        if (stopIfFailure && decoder->hasFailure()) {
+            return false;
+        }
+
+        // Emit the complete lines only, unless a single line is too long.
+        auto lineEnd = pendingText.lastIndexOf(QLatin1Char('\n'));
+        if (lineEnd != -1) {
+            emit sigChunkLoaded(pendingText.left(lineEnd + 1));
+            pendingText.remove(0, lineEnd + 1);
+        } else if (pendingText.size() >= Constants::kFileLoadChunkSize) {
+            emit sigChunkLoaded(pendingText);
+            pendingText.clear();
+        }
+
+        if (fileSize_ > 0) {
+            int percent = static_cast<int>(readSize_ * 100 / fileSize_);
+            if (percent != percent_) {
+                percent_ = percent;
+                emit sigProgressChanged(percent);
+            }
+        }
+        return true;
+    });
+    if (!success) {
+        return false;
+    }
+    if (!pendingText.isEmpty()) {
+        emit sigChunkLoaded(pendingText);
+    }
+    loadedSize_ = readSize_;
+    return true;
+}
+}  // namespace QEditor
@@ -15,6 +15,7 @@
  */
 
 #include "FileRecorder.h"
+#include "AutoSaveJournal.h"
 #include "Logger.h"
 #ifdef OPEN_TERM
 #include "TerminalView.h"
@@ -22,33 +23,41 @@
 #include "Utils.h"
 #include <QDir>
 #include <QFile>
+#include <QSaveFile>
 
 namespace QEditor {
 FileRecorder::FileRecorder(QObject *parent) : QObject(parent) {}
 
 void FileRecorder::StoreFiles() {
-    qDebug() << "kAppInternalPath_: " << kAppInternalPath_;
-    (void)QDir(kAppInternalPath_).remove(kAppInternalAutoSaveDirName_);
     QString autoSavePath = kAppInternalPath_ + kAppInternalAutoSaveDirName_ + "/";
     qDebug() << "autoSavePath: " << autoSavePath;
     (void)Utils::mkdir(autoSavePath);
 
-    // Store files information firstly.
-    QFile filesInfoFile(autoSavePath + kAppInternalFilesInfoFileName_);
-    filesInfoFile.open(QIODevice::WriteOnly);
+    // Only the files information is written here, the text is written by the journal of each edit view.
+    QSaveFile filesInfoFile(autoSavePath + kAppInternalFilesInfoFileName_);
+    if (!filesInfoFile.open(QIODevice::WriteOnly)) {
+        qCritical() << "Open failed, " << filesInfoFile.errorString() << ", file: " << filesInfoFile.fileName();
+        return;
+    }
     QDataStream filesInfoStream(&filesInfoFile);
     FileList fileList;
     fileList.pos_ = pos_;
+    QSet<int> journalIds;
     for (int i = 0; i < editViews_.size(); ++i) {
         auto const &editView = editViews_[i];
 #ifdef OPEN_TERM
         auto terminalView = qobject_cast<TerminalView *>(editView);
         if (terminalView == nullptr) {
 #endif
-            int pos = i;
-            // Open file edit, not change, or empty new file edit.
-            if (!editView->ShouldSave()) {
-                pos = -1;
+            int pos = -1;
+            // New file edit, or open file edit, has change.
+            // Otherwise, open file edit, not change, or empty new file edit.
+            if (editView->ShouldSave()) {
+                pos = editView->journalId();
+                if (pos == -1) {
+                    pos = editView->StartJournal();
+                }
+                journalIds.insert(pos);
             }
             FileInfo fileInfo(pos, editView->newFileNum(), editView->filePath());
             fileList.fileInfos_.push_back(fileInfo);
@@ -59,25 +68,18 @@ void FileRecorder::StoreFiles() {
         }
 #endif
     }
+    for (const auto &largeFileView : largeFileViews_) {
+        FileInfo fileInfo(-1, 0, largeFileView->filePath());
+        fileList.fileInfos_.push_back(fileInfo);
+    }
     filesInfoStream << fileList;
-
-    // Store each file.
-    for (int i = 0; i < editViews_.size(); ++i) {
-        auto const &editView = editViews_[i];
-        // Open file edit, not change, or empty new file edit.
-        if (!editView->ShouldSave()) {
-            continue;
-        }
-        // New file edit, or open file edit, has change.
-        qDebug() << "store plain text: " << editView->toPlainText()
-                 << ", mibEnum: " << editView->fileEncoding().mibEnum() << ", for tab " << i;
-        FileData fileData(editView->fileEncoding().mibEnum(), editView->toPlainText());
-
-        QFile fileDataFile(autoSavePath + QString::number(i));
-        fileDataFile.open(QIODevice::WriteOnly);
-        QDataStream fileDataStream(&fileDataFile);
-        fileDataStream << fileData;
+    if (!filesInfoFile.commit()) {
+        qCritical() << "Write failed, " << filesInfoFile.errorString() << ", file: " << filesInfoFile.fileName();
+        return;
     }
+
+    // Remove the journals of the tabs closed or saved.
+    AutoSaveJournal::Instance().Retain(journalIds);
 }
 
 void FileRecorder::LoadFiles() {
@@ -106,30 +108,24 @@ void FileRecorder::LoadFiles() {
     // Load each file.
     qDebug() << ", loadedFileInfos_.size: " << loadedFileInfos_.size();
     for (size_t i = 0; i < loadedFileInfos_.size(); ++i) {
-        auto const &fileInfo = loadedFileInfos_[i];
-        // Terminal view.
-        if (fileInfo.IsTerminal()) {
-            continue;
-        }
-        // Open file edit, not change, or empty new file edit.
-        if (fileInfo.IsNewFileOrOriginalOpenFile()) {
+        auto &fileInfo = loadedFileInfos_[i];
+        // Terminal view, open file edit, not change, or empty new file edit.
+        // Still take a place, as the text is got by the tab index.
+        if (fileInfo.IsTerminal() || fileInfo.IsNewFileOrOriginalOpenFile()) {
             texts_.emplace_back(QString(""));
             mibEnums_.emplace_back(106);  // UTF-8 in default.
             continue;
         }
         // New file edit, or open file edit, has change.
-        QFile fileDataFile(autoSavePath + QString::number(fileInfo.index_));
-        if (!fileDataFile.exists()) {
-            qDebug() << ", not exists, " << fileDataFile.fileName();
-            return;
+        int mibEnum = 106;
+        QString text;
+        if (!AutoSaveJournal::Load(fileInfo.index_, &mibEnum, &text)) {
+            // Lost, reopen the file or leave the new file empty.
+            fileInfo.index_ = -1;
         }
-        fileDataFile.open(QIODevice::ReadOnly);
-        FileData fileData;
-        QDataStream fileDataStream(&fileDataFile);
-        fileDataStream >> fileData;
-        qDebug() << " load plain text: " << fileData.text_ << ", mibEnum: " << fileData.mibEnum_ << ", for tab " << i;
-        texts_.emplace_back(std::move(fileData.text_));
-        mibEnums_.emplace_back(fileData.mibEnum_);
+        qDebug() << " load plain text, size: " << text.size() << ", mibEnum: " << mibEnum << ", for tab " << i;
+        texts_.emplace_back(std::move(text));
+        mibEnums_.emplace_back(mibEnum);
     }
 }
 }  // namespace QEditor
@@ -0,0 +1,112 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FileSaver.h"
+#include "Constants.h"
+#include <QDir>
+#include <QSaveFile>
+#include <QSet>
+#include <algorithm>
+#include <thread>
+
+namespace QEditor {
+FileSaver::FileSaver(const QString &filePath, const QString &text, QTextCodec *codec, bool hasBom)
+    : filePath_(filePath), text_(text), codec_(codec), hasBom_(hasBom) {}
+
+FileSaver::~FileSaver() {
+    Wait();
+    delete thread_;
+}
+
+void FileSaver::Start() {
+    thread_ = new QThread();
+    moveToThread(thread_);
+    connect(thread_, &QThread::started, this, &FileSaver::HandleSaveInThread);
+    thread_->start();
+}
+
+void FileSaver::Wait() {
+    if (thread_ != nullptr) {
+        thread_->wait();
+    }
+}
+
+std::vector<QByteArray> FileSaver::Encode(const QString &text, QTextCodec *codec) {
+    // The codecs keeping state between chars can't encode from the middle.
+    // UTF-7, SCSU, BOCU-1, ISO-2022 serials and HZ-GB-2312.
+    static const QSet<int> statefulMibs = {1012, 1011, 1020, 16, 37, 39, 40, 104, 105, 2085};
+    qint64 chunkNum = 1;
+    if (!statefulMibs.contains(codec->mibEnum())) {
+        qint64 threadNum = std::max(1U, std::thread::hardware_concurrency());
+        auto maxChunkNum = (text.size() + Constants::kSaveEncodeChunkSize - 1) / Constants::kSaveEncodeChunkSize;
+        chunkNum = std::max<qint64>(1, std::min(threadNum, maxChunkNum));
+    }
+
+    std::vector<qint64> bounds;
+    for (qint64 i = 0; i < chunkNum; ++i) {
+        qint64 pos = text.size() * i / chunkNum;
+        // Not split the surrogate pair.
+        if (pos > 0 && pos < text.size() && text[static_cast<int>(pos)].isLowSurrogate()) {
+            ++pos;
+        }
+        bounds.emplace_back(pos);
+    }
+    bounds.emplace_back(text.size());
+
+    std::vector<QByteArray> chunks(chunkNum);
+    auto encode = [&](qint64 i) {
+        // Each state has its own converter, so the codec can be shared by threads.
+        QTextCodec::ConverterState state(QTextCodec::IgnoreHeader);
+        chunks[i] = codec->fromUnicode(text.constData() + bounds[i], static_cast<int>(bounds[i + 1] - bounds[i]),
+                                       &state);
+    };
+    std::vector<std::thread> threads;
+    for (qint64 i = 1; i < chunkNum; ++i) {
+        threads.emplace_back(encode, i);
+    }
+    encode(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return chunks;
+}
+
+void FileSaver::HandleSaveInThread() {
+    const auto &chunks = Encode(text_, codec_);
+    QSaveFile file(filePath_);
+    if (file.open(QFile::WriteOnly | QFile::Text)) {
+        if (hasBom_) {
+            QTextCodec::ConverterState state(QTextCodec::IgnoreHeader);
+            const QChar bom(QChar::ByteOrderMark);
+            (void)file.write(codec_->fromUnicode(&bom, 1, &state));
+        }
+        for (const auto &chunk : chunks) {
+            if (file.write(chunk) != chunk.size()) {
+                break;
+            }
+        }
+        if (!file.commit()) {
+            errorString_ = tr("Cannot write file %1:\n%2.").arg(QDir::toNativeSeparators(filePath_), file.errorString());
+        }
+    } else {
+        errorString_ =
+            tr("Cannot open file %1 for writing:\n%2.").arg(QDir::toNativeSeparators(filePath_), file.errorString());
+    }
+    qDebug() << "Saved " << filePath_ << ", chunks: " << chunks.size() << ", error: " << errorString_;
+    emit sigFinished(errorString_.isEmpty(), errorString_);
+    QThread::currentThread()->quit();
+}
+}  // namespace QEditor
@@ -0,0 +1,287 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "FileSearcher.h"
+#include "Constants.h"
+#include "FileEncoding.h"
+#include "Logger.h"
+#include <QDirIterator>
+#include <QFile>
+#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace QEditor {
+FileSearcher::FileSearcher(QObject *parent) : QObject(parent) {
+    timer_.setInterval(Constants::kFindInFilesFrameInterval);
+    connect(&timer_, &QTimer::timeout, this, &FileSearcher::HandleTimeout);
+}
+
+FileSearcher::~FileSearcher() {
+    canceled_ = true;
+    Join();
+}
+
+void FileSearcher::Start(const QString &rootPath, const Filter &filter, const TextFindFunction &find) {
+    Cancel();
+    find_ = find;
+    maxFileSize_ = filter.maxFileSize_;
+    includes_.clear();
+    excludes_.clear();
+    for (const auto &glob : filter.globs_) {
+        const bool exclude = glob.startsWith('!');
+        const auto &pattern = QRegularExpression::wildcardToRegularExpression(exclude ? glob.mid(1) : glob);
+        (exclude ? excludes_ : includes_)
+            .emplace_back(QRegularExpression(pattern, QRegularExpression::CaseInsensitiveOption));
+    }
+    scannedCount_ = 0;
+    skippedCount_ = 0;
+    found_.clear();
+
+    const auto workerCount = std::max(QThread::idealThreadCount(), 1);
+    queues_.clear();
+    for (int i = 0; i < workerCount; ++i) {
+        queues_.emplace_back(std::make_unique<TaskQueue>());
+    }
+    // The others steal from the first one at the beginning.
+    PushTask(0, Task{rootPath, true});
+    searching_ = true;
+    for (int i = 0; i < workerCount; ++i) {
+        workers_.emplace_back([this, i]() { Work(i); });
+    }
+    timer_.start();
+}
+
+void FileSearcher::Cancel() {
+    if (!searching_) {
+        return;
+    }
+    canceled_ = true;
+    Join();
+    emit sigFinished(true);
+}
+
+void FileSearcher::Join() {
+    timer_.stop();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    queues_.clear();
+    pendingCount_ = 0;
+    canceled_ = false;
+    searching_ = false;
+}
+
+void FileSearcher::HandleTimeout() {
+    // All tasks done if none is queued or running.
+    const bool finished = (pendingCount_ == 0);
+    std::vector<FileMatches> batch;
+    {
+        QMutexLocker locker(&mutex_);
+        batch.swap(found_);
+    }
+    if (!batch.empty()) {
+        emit sigFound(batch);
+    }
+    emit sigProgressChanged(scannedCount_, skippedCount_);
+    if (finished) {
+        Join();
+        qDebug() << "Found in files, scanned: " << scannedCount_ << ", skipped: " << skippedCount_;
+        emit sigFinished(false);
+    }
+}
+
+void FileSearcher::Work(int index) {
+    Task task;
+    while (!canceled_ && pendingCount_ != 0) {
+        if (!PopTask(index, task) && !StealTask(index, task)) {
+            // The others are walking the directories.
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (task.directory_) {
+            Walk(index, task.path_);
+        } else {
+            Scan(task.path_);
+        }
+        // After the tasks of the directory pushed.
+        --pendingCount_;
+    }
+}
+
+void FileSearcher::PushTask(int index, Task &&task) {
+    ++pendingCount_;
+    auto &queue = *queues_[index];
+    QMutexLocker locker(&queue.mutex_);
+    queue.tasks_.emplace_back(std::move(task));
+}
+
+bool FileSearcher::PopTask(int index, Task &task) {
+    auto &queue = *queues_[index];
+    QMutexLocker locker(&queue.mutex_);
+    if (queue.tasks_.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks_.back());
+    queue.tasks_.pop_back();
+    return true;
+}
+
+bool FileSearcher::StealTask(int index, Task &task) {
+    // The front ones are near the root, likely to have more to do.
+    const int count = static_cast<int>(queues_.size());
+    for (int i = 1; i < count; ++i) {
+        auto &queue = *queues_[(index + i) % count];
+        QMutexLocker locker(&queue.mutex_);
+        if (queue.tasks_.empty()) {
+            continue;
+        }
+        task = std::move(queue.tasks_.front());
+        queue.tasks_.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void FileSearcher::Walk(int index, const QString &dirPath) {
+    // The hidden ones like '.git' are skipped, and the links not to walk in a cycle.
+    QDirIterator iter(dirPath, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+    while (iter.hasNext() && !canceled_) {
+        iter.next();
+        const auto &fileInfo = iter.fileInfo();
+        if (fileInfo.isDir()) {
+            PushTask(index, Task{fileInfo.filePath(), true});
+        } else if (Accept(fileInfo.fileName(), fileInfo.size())) {
+            PushTask(index, Task{fileInfo.filePath(), false});
+        }
+    }
+}
+
+bool FileSearcher::Accept(const QString &fileName, qint64 size) const {
+    // Decoded at once, so not too large.
+    if (size == 0 || size > maxFileSize_ || size > std::numeric_limits<int>::max()) {
+        return false;
+    }
+    auto matched = [&fileName](const QRegularExpression &re) { return re.match(fileName).hasMatch(); };
+    if (std::any_of(excludes_.cbegin(), excludes_.cend(), matched)) {
+        return false;
+    }
+    return includes_.empty() || std::any_of(includes_.cbegin(), includes_.cend(), matched);
+}
+
+void FileSearcher::Scan(const QString &filePath) {
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly)) {
+        ++skippedCount_;
+        return;
+    }
+    // Read by the map, or at once if not mappable.
+    const auto size = file.size();
+    auto map = file.map(0, size);
+    auto data = reinterpret_cast<const char *>(map);
+    QByteArray bytes;
+    if (map == nullptr) {
+        bytes = file.readAll();
+        data = bytes.constData();
+    }
+    const qint64 dataSize = (map == nullptr ? bytes.size() : size);
+
+    // The same as FileLoader, the BOM first, then the sampled windows.
+    auto codec = QTextCodec::codecForUtfText(
+        QByteArray::fromRawData(data, static_cast<int>(std::min<qint64>(dataSize, 4))), nullptr);
+    if (codec == nullptr) {
+        if (IsBinary(data, dataSize)) {
+            ++skippedCount_;
+            if (map != nullptr) {
+                file.unmap(map);
+            }
+            return;
+        }
+        codec = FileEncoding::DetectCodec(data, dataSize);
+    }
+    auto text = codec->toUnicode(data, static_cast<int>(dataSize));
+    if (map != nullptr) {
+        file.unmap(map);
+    }
+    // The lines as the editor loads in text mode, so '$' matches before CRLF too.
+    if (text.contains('\r')) {
+        text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+    }
+    ++scannedCount_;
+
+    TextMatches matches;
+    (void)find_(text, 0, text.size(), matches);
+    if (matches.empty() || canceled_) {
+        return;
+    }
+    FileMatches fileMatches;
+    fileMatches.filePath_ = filePath;
+    fileMatches.codecName_ = codec->name();
+    MakeHits(text, matches, fileMatches);
+    QMutexLocker locker(&mutex_);
+    found_.emplace_back(std::move(fileMatches));
+}
+
+bool FileSearcher::IsBinary(const char *data, qint64 size) {
+    const auto head = std::min<qint64>(size, Constants::kFindInFilesBinaryCheckSize);
+    return std::find(data, data + head, '\0') != data + head;
+}
+
+void FileSearcher::MakeHits(const QString &text, const TextMatches &matches, FileMatches &fileMatches) {
+    auto &hits = fileMatches.hits_;
+    auto &lineTexts = fileMatches.lineTexts_;
+    hits.reserve(matches.size());
+    int line = 0;
+    int lineStart = 0;
+    int pos = 0;
+    // The range of the last line text, shared by the next hits in it.
+    int lastTextStart = -1;
+    int lastTextEnd = -1;
+    for (const auto &match : matches) {
+        // The matches are in order, count the lines from the last one.
+        for (; pos < match.first; ++pos) {
+            if (text[pos] == '\n') {
+                ++line;
+                lineStart = pos + 1;
+            }
+        }
+        if (lastTextStart < lineStart || match.first + match.second > lastTextEnd) {
+            auto lineEnd = text.indexOf('\n', match.first);
+            if (lineEnd == -1) {
+                lineEnd = text.size();
+            }
+            lastTextStart = lineStart;
+            lastTextEnd = lineEnd;
+            if (lastTextEnd - lastTextStart > Constants::kMaxSearchResultLineLength) {
+                // A part around the match.
+                lastTextStart = std::max(lineStart, match.first - Constants::kMaxSearchResultLineLength / 4);
+                lastTextEnd = std::min(lineEnd, lastTextStart + Constants::kMaxSearchResultLineLength);
+            }
+            lineTexts.emplace_back(text.mid(lastTextStart, lastTextEnd - lastTextStart));
+        }
+        Hit hit;
+        hit.line_ = line;
+        hit.column_ = match.first - lineStart;
+        hit.length_ = match.second;
+        hit.lineTextIndex_ = static_cast<int>(lineTexts.size()) - 1;
+        hit.lineTextColumn_ = match.first - lastTextStart;
+        hits.emplace_back(std::move(hit));
+    }
+}
+}  // namespace QEditor
@@ -0,0 +1,259 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LineIndex.h"
+#include "Constants.h"
+#include "Logger.h"
+#include "Utils.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+namespace QEditor {
+bool LineIndex::Build(const char *data, qint64 size, const std::atomic<bool> &canceled) {
+    Clear();
+    checkpoints_.emplace_back(0);
+    qint64 line = 0;
+    qint64 pos = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    // Find the '\n' of 16 bytes at once.
+    const auto newLines = _mm_set1_epi8('\n');
+    for (; pos + 16 <= size; pos += 16) {
+        // Check cancellation every 64M bytes.
+        if ((pos & 0x3FFFFFF) == 0 && canceled.load()) {
+            Clear();
+            return false;
+        }
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+        auto mask = static_cast<quint32>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newLines)));
+        if (mask == 0) {
+            continue;
+        }
+        // No checkpoint in this block.
+        auto count = qPopulationCount(mask);
+        if (line % kStride + count < kStride) {
+            line += count;
+            continue;
+        }
+        for (; mask != 0; mask &= mask - 1) {
+            ++line;
+            if (line % kStride == 0) {
+                checkpoints_.emplace_back(pos + qCountTrailingZeroBits(mask) + 1);
+            }
+        }
+    }
+#endif
+    while (pos < size) {
+        auto found = static_cast<const char *>(std::memchr(data + pos, '\n', size - pos));
+        if (found == nullptr) {
+            break;
+        }
+        pos = found - data + 1;
+        ++line;
+        if (line % kStride == 0) {
+            checkpoints_.emplace_back(pos);
+            // Check cancellation every 4M lines or so.
+            if ((line & 0x3FFFFF) == 0 && canceled.load()) {
+                Clear();
+                return false;
+            }
+        }
+    }
+    // As QTextDocument does, a trailing '\n' starts a new empty line.
+    lineCount_ = line + 1;
+    built_ = true;
+    qDebug() << "lineCount_: " << lineCount_ << ", checkpoints: " << checkpoints_.size();
+    return true;
+}
+
+void LineIndex::Extend(const char *data, qint64 from, qint64 size) {
+    if (!built_) {
+        return;
+    }
+    // The last line is still open, continue counting from it.
+    qint64 line = lineCount_ - 1;
+    qint64 pos = from;
+    while (pos < size) {
+        auto found = static_cast<const char *>(std::memchr(data + pos, '\n', size - pos));
+        if (found == nullptr) {
+            break;
+        }
+        pos = found - data + 1;
+        ++line;
+        if (line % kStride == 0) {
+            checkpoints_.emplace_back(pos);
+        }
+    }
+    lineCount_ = line + 1;
+}
+
+void LineIndex::Clear() {
+    checkpoints_.clear();
+    lineCount_ = 0;
+    built_ = false;
+}
+
+qint64 LineIndex::LineStart(qint64 line, const char *data, qint64 size) const {
+    if (line <= 0) {
+        return 0;
+    }
+    qint64 offset = 0;
+    qint64 current = 0;
+    if (!checkpoints_.empty()) {
+        auto index = std::min<qint64>(line / kStride, checkpoints_.size() - 1);
+        offset = checkpoints_[index];
+        current = index * kStride;
+    }
+    while (current < line) {
+        auto found = static_cast<const char *>(std::memchr(data + offset, '\n', size - offset));
+        if (found == nullptr) {
+            return size;
+        }
+        offset = found - data + 1;
+        ++current;
+    }
+    return offset;
+}
+
+qint64 LineIndex::LineEnd(qint64 start, const char *data, qint64 size) {
+    if (start >= size) {
+        return size;
+    }
+    auto found = static_cast<const char *>(std::memchr(data + start, '\n', size - start));
+    qint64 end = (found == nullptr ? size : found - data);
+    if (end > start && data[end - 1] == '\r') {
+        --end;
+    }
+    return end;
+}
+
+qint64 LineIndex::LineOf(qint64 offset, const char *data, qint64 size) const {
+    offset = std::min(offset, size);
+    qint64 pos = 0;
+    qint64 line = 0;
+    if (!checkpoints_.empty()) {
+        auto iter = std::upper_bound(checkpoints_.cbegin(), checkpoints_.cend(), offset);
+        auto index = std::distance(checkpoints_.cbegin(), iter) - 1;
+        pos = checkpoints_[index];
+        line = index * kStride;
+    }
+    while (pos < offset) {
+        auto found = static_cast<const char *>(std::memchr(data + pos, '\n', offset - pos));
+        if (found == nullptr) {
+            break;
+        }
+        pos = found - data + 1;
+        ++line;
+    }
+    return line;
+}
+
+namespace {
+constexpr quint32 kCacheMagic = 0x51494458;  // "QIDX"
+constexpr qint32 kCacheVersion = 1;
+
+QString CacheDirPath() {
+    return Constants::kAppInternalPath + Constants::kAppInternalLineIndexDirName + "/";
+}
+
+// One cache file for one path, the old one is overwritten.
+QString CacheFilePath(const QFileInfo &fileInfo) {
+    const auto &hash = QCryptographicHash::hash(fileInfo.canonicalFilePath().toUtf8(), QCryptographicHash::Sha1);
+    return CacheDirPath() + QString::fromLatin1(hash.toHex());
+}
+}  // namespace
+
+bool LineIndex::StoreCache(const QFileInfo &fileInfo) const {
+    if (!built_ || Constants::kAppInternalPath.isEmpty()) {
+        return false;
+    }
+    (void)Utils::mkdir(CacheDirPath());
+    QSaveFile file(CacheFilePath(fileInfo));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCritical() << "Can not write line index cache, " << file.errorString();
+        return false;
+    }
+    QDataStream stream(&file);
+    stream << kCacheMagic << kCacheVersion << fileInfo.canonicalFilePath() << fileInfo.size()
+           << fileInfo.lastModified().toMSecsSinceEpoch() << lineCount_ << static_cast<quint64>(checkpoints_.size());
+    // Only read back on the same machine, so write in native byte order.
+    stream.writeRawData(reinterpret_cast<const char *>(checkpoints_.data()), checkpoints_.size() * sizeof(qint64));
+    if (!file.commit()) {
+        qCritical() << "Can not write line index cache, " << file.errorString();
+        return false;
+    }
+
+    // Keep the recent ones only.
+    QDir dir(CacheDirPath());
+    const auto &entries = dir.entryInfoList(QDir::Files, QDir::Time);
+    for (int i = Constants::kMaxLineIndexCacheNum; i < entries.size(); ++i) {
+        (void)dir.remove(entries[i].fileName());
+    }
+    return true;
+}
+
+bool LineIndex::LoadCache(const QFileInfo &fileInfo) {
+    QFile file(CacheFilePath(fileInfo));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    quint32 magic;
+    qint32 version;
+    QString path;
+    qint64 size;
+    qint64 modified;
+    qint64 lineCount;
+    quint64 checkpointCount;
+    stream >> magic >> version >> path >> size >> modified >> lineCount >> checkpointCount;
+    // Outdated if the file changed.
+    if (stream.status() != QDataStream::Ok || magic != kCacheMagic || version != kCacheVersion ||
+        path != fileInfo.canonicalFilePath() || size != fileInfo.size() ||
+        modified != fileInfo.lastModified().toMSecsSinceEpoch() || checkpointCount == 0 ||
+        checkpointCount * sizeof(qint64) != static_cast<quint64>(file.bytesAvailable())) {
+        qDebug() << "Line index cache is outdated, " << fileInfo.canonicalFilePath();
+        return false;
+    }
+    std::vector<qint64> checkpoints(checkpointCount);
+    auto bytes = static_cast<int>(checkpointCount * sizeof(qint64));
+    if (stream.readRawData(reinterpret_cast<char *>(checkpoints.data()), bytes) != bytes) {
+        return false;
+    }
+    // Not to read out of the map by a broken cache. Each stride has 'kStride' newlines.
+    bool valid = lineCount > 0 && checkpointCount == static_cast<quint64>((lineCount - 1) / kStride + 1) &&
+                 checkpoints.front() == 0 && checkpoints.back() <= size;
+    for (size_t i = 1; valid && i < checkpoints.size(); ++i) {
+        valid = checkpoints[i] - checkpoints[i - 1] >= kStride;
+    }
+    if (!valid) {
+        qCritical() << "Line index cache is broken, " << fileInfo.canonicalFilePath();
+        return false;
+    }
+    checkpoints_ = std::move(checkpoints);
+    lineCount_ = lineCount;
+    built_ = true;
+    qDebug() << "Line index cache loaded, lineCount_: " << lineCount_ << ", file: " << fileInfo.canonicalFilePath();
+    return true;
+}
+}  // namespace QEditor
@@ -0,0 +1,438 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PieceTable.h"
+#include "Logger.h"
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cstring>
+
+namespace QEditor {
+namespace {
+template <typename T>
+qint64 TotalLength(const T *node) {
+    return node == nullptr ? 0 : node->totalLength;
+}
+
+template <typename T>
+qint64 TotalNewlines(const T *node) {
+    return node == nullptr ? 0 : node->totalNewlines;
+}
+}  // namespace
+
+PieceTable::~PieceTable() { Clear(); }
+
+void PieceTable::Reset(const char *data, qint64 size, const LineIndex *lineIndex) {
+    Clear();
+    data_ = data;
+    size_ = size;
+    lineIndex_ = lineIndex;
+    if (data_ != nullptr && size_ > 0) {
+        // The newlines are counted after indexed, no edit before that.
+        root_ = NewNode(false, 0, size_, editable() ? lineIndex_->lineCount() - 1 : 0);
+    }
+}
+
+void PieceTable::Clear() {
+    Delete(root_);
+    root_ = nullptr;
+    for (const auto &edit : undoStack_) {
+        Delete(edit.detached);
+    }
+    undoStack_.clear();
+    for (const auto &edit : redoStack_) {
+        Delete(edit.detached);
+    }
+    redoStack_.clear();
+    add_.clear();
+    savePoint_ = 0;
+}
+
+void PieceTable::ClearRedo() {
+    for (const auto &edit : redoStack_) {
+        Delete(edit.detached);
+    }
+    redoStack_.clear();
+    if (savePoint_ > static_cast<qint64>(undoStack_.size())) {
+        savePoint_ = -1;
+    }
+}
+
+qint64 PieceTable::size() const { return TotalLength(root_); }
+
+qint64 PieceTable::lineCount() const {
+    if (!editable()) {
+        return lineIndex_ == nullptr ? 0 : lineIndex_->lineCount();
+    }
+    return TotalNewlines(root_) + 1;
+}
+
+qint64 PieceTable::CountNewlines(bool added, qint64 start, qint64 end) const {
+    if (end <= start) {
+        return 0;
+    }
+    if (added) {
+        return std::count(add_.constData() + start, add_.constData() + end, '\n');
+    }
+    return lineIndex_->LineOf(end, data_, size_) - lineIndex_->LineOf(start, data_, size_);
+}
+
+qint64 PieceTable::NthNewline(const Node *node, qint64 n) const {
+    if (!node->added) {
+        auto line = lineIndex_->LineOf(node->start, data_, size_) + n;
+        return lineIndex_->LineStart(line, data_, size_) - 1 - node->start;
+    }
+    const char *begin = add_.constData() + node->start;
+    const char *end = begin + node->length;
+    const char *pos = begin;
+    for (;;) {
+        pos = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+        if (pos == nullptr || --n == 0) {
+            break;
+        }
+        ++pos;
+    }
+    return pos == nullptr ? node->length : pos - begin;
+}
+
+qint64 PieceTable::LineStart(qint64 line) const {
+    if (!editable()) {
+        return lineIndex_ == nullptr ? 0 : lineIndex_->LineStart(line, data_, size_);
+    }
+    if (line <= 0) {
+        return 0;
+    }
+    // Find the piece of the line-th newline.
+    qint64 offset = 0;
+    const Node *node = root_;
+    while (node != nullptr) {
+        auto leftNewlines = TotalNewlines(node->left);
+        if (line <= leftNewlines) {
+            node = node->left;
+            continue;
+        }
+        line -= leftNewlines;
+        offset += TotalLength(node->left);
+        if (line <= node->newlines) {
+            return offset + NthNewline(node, line) + 1;
+        }
+        line -= node->newlines;
+        offset += node->length;
+        node = node->right;
+    }
+    return size();
+}
+
+qint64 PieceTable::LineEnd(qint64 start) const {
+    const auto size = this->size();
+    if (start >= size) {
+        return size;
+    }
+    qint64 end = size;
+    qint64 offset = start;
+    ForEachSpan(start, size, [&end, &offset](const char *data, qint64 length) {
+        auto found = static_cast<const char *>(std::memchr(data, '\n', length));
+        if (found != nullptr) {
+            end = offset + (found - data);
+            return false;
+        }
+        offset += length;
+        return true;
+    });
+    if (end > start && At(end - 1) == '\r') {
+        --end;
+    }
+    return end;
+}
+
+qint64 PieceTable::LineOf(qint64 offset) const {
+    if (!editable()) {
+        return lineIndex_ == nullptr ? 0 : lineIndex_->LineOf(offset, data_, size_);
+    }
+    qint64 line = 0;
+    const Node *node = root_;
+    while (node != nullptr) {
+        auto leftLength = TotalLength(node->left);
+        if (offset < leftLength) {
+            node = node->left;
+            continue;
+        }
+        line += TotalNewlines(node->left);
+        offset -= leftLength;
+        if (offset < node->length) {
+            return line + CountNewlines(node->added, node->start, node->start + offset);
+        }
+        line += node->newlines;
+        offset -= node->length;
+        node = node->right;
+    }
+    return line;
+}
+
+char PieceTable::At(qint64 offset) const {
+    const Node *node = root_;
+    while (node != nullptr) {
+        auto leftLength = TotalLength(node->left);
+        if (offset < leftLength) {
+            node = node->left;
+            continue;
+        }
+        offset -= leftLength;
+        if (offset < node->length) {
+            return Buffer(node->added)[node->start + offset];
+        }
+        offset -= node->length;
+        node = node->right;
+    }
+    return '\0';
+}
+
+QByteArray PieceTable::Read(qint64 start, qint64 end) const {
+    start = std::max<qint64>(0, start);
+    end = std::min(end, size());
+    if (end <= start) {
+        return QByteArray();
+    }
+    QByteArray bytes;
+    const char *original = nullptr;
+    VisitSpans(root_, 0, start, end, [&bytes, &original, start, end](bool added, const char *data, qint64 length) {
+        if (!added && length == end - start) {
+            original = data;
+            return false;
+        }
+        bytes.append(data, length);
+        return true;
+    });
+    if (original != nullptr) {
+        return QByteArray::fromRawData(original, end - start);
+    }
+    return bytes;
+}
+
+void PieceTable::ForEachSpan(qint64 start, qint64 end,
+                             const std::function<bool(const char *, qint64)> &visitor) const {
+    (void)VisitSpans(root_, 0, std::max<qint64>(0, start), std::min(end, size()),
+                     [&visitor](bool, const char *data, qint64 length) { return visitor(data, length); });
+}
+
+bool PieceTable::VisitSpans(const Node *node, qint64 nodeOffset, qint64 start, qint64 end,
+                            const std::function<bool(bool, const char *, qint64)> &visitor) const {
+    if (node == nullptr || start >= end) {
+        return true;
+    }
+    // Only the subtrees across [start, end) are visited.
+    auto pieceBegin = nodeOffset + TotalLength(node->left);
+    auto pieceEnd = pieceBegin + node->length;
+    if (start < pieceBegin && !VisitSpans(node->left, nodeOffset, start, end, visitor)) {
+        return false;
+    }
+    if (start < pieceEnd && end > pieceBegin) {
+        auto from = std::max(start, pieceBegin);
+        auto to = std::min(end, pieceEnd);
+        if (!visitor(node->added, Buffer(node->added) + node->start + (from - pieceBegin), to - from)) {
+            return false;
+        }
+    }
+    if (end > pieceEnd) {
+        return VisitSpans(node->right, pieceEnd, start, end, visitor);
+    }
+    return true;
+}
+
+bool PieceTable::WriteTo(QIODevice *device) const {
+    bool success = true;
+    ForEachSpan(0, size(), [device, &success](const char *data, qint64 length) {
+        success = (device->write(data, length) == length);
+        return success;
+    });
+    return success;
+}
+
+void PieceTable::Insert(qint64 offset, const QByteArray &bytes) {
+    if (bytes.isEmpty() || offset < 0 || offset > size()) {
+        return;
+    }
+    ClearRedo();
+    const qint64 start = add_.size();
+    const qint64 newlines = bytes.count('\n');
+    Node *left;
+    Node *right;
+    Split(root_, offset, &left, &right);
+
+    // Grow the last inserted piece if typing continuously, not to add a piece for each key.
+    auto last = left;
+    while (last != nullptr && last->right != nullptr) {
+        last = last->right;
+    }
+    bool grown = false;
+    if (newlines == 0 && !undoStack_.empty() && savePoint_ != static_cast<qint64>(undoStack_.size())) {
+        auto &edit = undoStack_.back();
+        if (edit.insert && edit.offset + edit.length == offset && last != nullptr && last->added &&
+            last->start + last->length == start) {
+            for (auto node = left; node != nullptr; node = node->right) {
+                node->totalLength += bytes.size();
+            }
+            last->length += bytes.size();
+            edit.length += bytes.size();
+            grown = true;
+        }
+    }
+    add_.append(bytes);
+    if (!grown) {
+        left = Merge(left, NewNode(true, start, bytes.size(), newlines));
+        undoStack_.push_back({true, offset, bytes.size(), nullptr});
+    }
+    root_ = Merge(left, right);
+}
+
+void PieceTable::Remove(qint64 start, qint64 end) {
+    start = std::max<qint64>(0, start);
+    end = std::min(end, size());
+    if (end <= start) {
+        return;
+    }
+    ClearRedo();
+    undoStack_.push_back({false, start, end - start, Extract(start, end - start)});
+}
+
+qint64 PieceTable::Undo() {
+    if (undoStack_.empty()) {
+        return -1;
+    }
+    auto edit = undoStack_.back();
+    undoStack_.pop_back();
+    qint64 cursor;
+    if (edit.insert) {
+        edit.detached = Extract(edit.offset, edit.length);
+        cursor = edit.offset;
+    } else {
+        Attach(edit.offset, edit.detached);
+        edit.detached = nullptr;
+        cursor = edit.offset + edit.length;
+    }
+    redoStack_.push_back(edit);
+    return cursor;
+}
+
+qint64 PieceTable::Redo() {
+    if (redoStack_.empty()) {
+        return -1;
+    }
+    auto edit = redoStack_.back();
+    redoStack_.pop_back();
+    qint64 cursor;
+    if (edit.insert) {
+        Attach(edit.offset, edit.detached);
+        edit.detached = nullptr;
+        cursor = edit.offset + edit.length;
+    } else {
+        edit.detached = Extract(edit.offset, edit.length);
+        cursor = edit.offset;
+    }
+    undoStack_.push_back(edit);
+    return cursor;
+}
+
+PieceTable::Node *PieceTable::NewNode(bool added, qint64 start, qint64 length, qint64 newlines) {
+    auto node = new Node{added, start, length, newlines, QRandomGenerator::global()->generate()};
+    Update(node);
+    return node;
+}
+
+void PieceTable::Update(Node *node) {
+    node->totalLength = TotalLength(node->left) + node->length + TotalLength(node->right);
+    node->totalNewlines = TotalNewlines(node->left) + node->newlines + TotalNewlines(node->right);
+}
+
+void PieceTable::Delete(Node *node) {
+    if (node == nullptr) {
+        return;
+    }
+    Delete(node->left);
+    Delete(node->right);
+    delete node;
+}
+
+PieceTable::Node *PieceTable::Merge(Node *left, Node *right) {
+    if (left == nullptr) {
+        return right;
+    }
+    if (right == nullptr) {
+        return left;
+    }
+    if (left->priority > right->priority) {
+        left->right = Merge(left->right, right);
+        Update(left);
+        return left;
+    }
+    right->left = Merge(left, right->left);
+    Update(right);
+    return right;
+}
+
+void PieceTable::Split(Node *node, qint64 offset, Node **left, Node **right) {
+    if (node == nullptr) {
+        *left = nullptr;
+        *right = nullptr;
+        return;
+    }
+    auto leftLength = TotalLength(node->left);
+    if (offset <= leftLength) {
+        Split(node->left, offset, left, &node->left);
+        Update(node);
+        *right = node;
+        return;
+    }
+    if (offset >= leftLength + node->length) {
+        Split(node->right, offset - leftLength - node->length, &node->right, right);
+        Update(node);
+        *left = node;
+        return;
+    }
+
+    // Cut the piece, the rest takes the right subtree with the same priority to keep the heap order.
+    auto cut = offset - leftLength;
+    auto headNewlines = CountNewlines(node->added, node->start, node->start + cut);
+    auto rest = NewNode(node->added, node->start + cut, node->length - cut, node->newlines - headNewlines);
+    rest->priority = node->priority;
+    rest->right = node->right;
+    Update(rest);
+    node->length = cut;
+    node->newlines = headNewlines;
+    node->right = nullptr;
+    Update(node);
+    *left = node;
+    *right = rest;
+}
+
+PieceTable::Node *PieceTable::Extract(qint64 offset, qint64 length) {
+    Node *left;
+    Node *rest;
+    Node *middle;
+    Node *right;
+    Split(root_, offset, &left, &rest);
+    Split(rest, length, &middle, &right);
+    root_ = Merge(left, right);
+    return middle;
+}
+
+void PieceTable::Attach(qint64 offset, Node *node) {
+    Node *left;
+    Node *right;
+    Split(root_, offset, &left, &right);
+    root_ = Merge(Merge(left, node), right);
+}
+}  // namespace QEditor
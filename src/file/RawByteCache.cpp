@@ -0,0 +1,74 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RawByteCache.h"
+#include "Constants.h"
+#include "Logger.h"
+#include <QFileInfo>
+#include <algorithm>
+
+namespace QEditor {
+RawByteCache &RawByteCache::Instance() {
+    static RawByteCache _rawByteCache;
+    return _rawByteCache;
+}
+
+void RawByteCache::Put(const QString &filePath, std::shared_ptr<const RawBytes> rawBytes) {
+    Remove(filePath);
+    // Not to release all others for a huge one.
+    if (rawBytes->size_ > Constants::kRawByteCacheMaxSize / 2) {
+        qDebug() << "Too large to cache, " << rawBytes->size_ << ", file: " << filePath;
+        return;
+    }
+    QMutexLocker locker(&mutex_);
+    totalSize_ += rawBytes->size_;
+    entries_.emplace_front(filePath, std::move(rawBytes));
+    while (totalSize_ > Constants::kRawByteCacheMaxSize) {
+        qDebug() << "Release the raw bytes of " << entries_.back().first;
+        totalSize_ -= entries_.back().second->size_;
+        entries_.pop_back();
+    }
+}
+
+std::shared_ptr<const RawBytes> RawByteCache::Get(const QString &filePath) {
+    QMutexLocker locker(&mutex_);
+    auto iter = std::find_if(entries_.begin(), entries_.end(),
+                             [&filePath](const auto &entry) { return entry.first == filePath; });
+    if (iter == entries_.end()) {
+        return nullptr;
+    }
+    auto rawBytes = iter->second;
+    if (QFileInfo(filePath).lastModified() != rawBytes->lastModified_) {
+        qDebug() << "File changed after loaded, " << filePath;
+        totalSize_ -= rawBytes->size_;
+        entries_.erase(iter);
+        return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, iter);
+    return rawBytes;
+}
+
+void RawByteCache::Remove(const QString &filePath) {
+    QMutexLocker locker(&mutex_);
+    auto iter = std::find_if(entries_.begin(), entries_.end(),
+                             [&filePath](const auto &entry) { return entry.first == filePath; });
+    if (iter == entries_.end()) {
+        return;
+    }
+    totalSize_ -= iter->second->size_;
+    entries_.erase(iter);
+}
+}  // namespace QEditor
@@ -0,0 +1,237 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StreamDecompressor.h"
+#include "Constants.h"
+#include "Logger.h"
+#include <cstring>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+namespace QEditor {
+namespace {
+#ifdef HAVE_ZLIB
+class GzipDecompressor : public StreamDecompressor {
+   public:
+    GzipDecompressor() : buffer_(Constants::kFileLoadChunkSize, Qt::Uninitialized) {
+        std::memset(&stream_, 0, sizeof(stream_));
+        // 15 window bits, +32 to accept both zlib and gzip header.
+        initialized_ = (inflateInit2(&stream_, 15 + 32) == Z_OK);
+    }
+    ~GzipDecompressor() override { (void)inflateEnd(&stream_); }
+
+    bool Decompress(const char *data, qint64 size, const Consumer &consumer) override {
+        if (!initialized_) {
+            errorString_ = QStringLiteral("Initialize zlib failed");
+            return false;
+        }
+        stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        stream_.avail_in = static_cast<uInt>(size);
+        for (;;) {
+            if (ended_) {
+                if (stream_.avail_in == 0) {
+                    return true;
+                }
+                // The gzip file may contain multiple members.
+                (void)inflateReset(&stream_);
+                ended_ = false;
+            }
+            stream_.next_out = reinterpret_cast<Bytef *>(buffer_.data());
+            stream_.avail_out = static_cast<uInt>(buffer_.size());
+            auto ret = inflate(&stream_, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                ended_ = true;
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                errorString_ = QString::fromLatin1(stream_.msg != nullptr ? stream_.msg : "inflate failed");
+                return false;
+            }
+            auto produced = buffer_.size() - static_cast<qint64>(stream_.avail_out);
+            if (produced > 0 && !consumer(buffer_.constData(), produced)) {
+                return false;
+            }
+            // Need more input if the output buffer is not full.
+            if (!ended_ && stream_.avail_out != 0) {
+                return true;
+            }
+        }
+    }
+
+    bool Finish(const Consumer &) override {
+        if (!ended_) {
+            errorString_ = QStringLiteral("Unexpected end of gzip data");
+        }
+        return ended_;
+    }
+
+   private:
+    z_stream stream_;
+    QByteArray buffer_;
+    bool initialized_{false};
+    bool ended_{false};
+};
+#endif
+
+#ifdef HAVE_ZSTD
+class ZstdDecompressor : public StreamDecompressor {
+   public:
+    ZstdDecompressor() : stream_(ZSTD_createDStream()), buffer_(Constants::kFileLoadChunkSize, Qt::Uninitialized) {
+        (void)ZSTD_initDStream(stream_);
+    }
+    ~ZstdDecompressor() override { (void)ZSTD_freeDStream(stream_); }
+
+    bool Decompress(const char *data, qint64 size, const Consumer &consumer) override {
+        // The concatenated frames are decoded one by one by the stream.
+        ZSTD_inBuffer input = {data, static_cast<size_t>(size), 0};
+        for (;;) {
+            ZSTD_outBuffer output = {buffer_.data(), static_cast<size_t>(buffer_.size()), 0};
+            auto ret = ZSTD_decompressStream(stream_, &output, &input);
+            if (ZSTD_isError(ret)) {
+                errorString_ = QString::fromLatin1(ZSTD_getErrorName(ret));
+                return false;
+            }
+            frameEnded_ = (ret == 0);
+            if (output.pos > 0 && !consumer(buffer_.constData(), static_cast<qint64>(output.pos))) {
+                return false;
+            }
+            if (input.pos == input.size && output.pos < output.size) {
+                return true;
+            }
+        }
+    }
+
+    bool Finish(const Consumer &) override {
+        if (!frameEnded_) {
+            errorString_ = QStringLiteral("Unexpected end of zstd data");
+        }
+        return frameEnded_;
+    }
+
+   private:
+    ZSTD_DStream *stream_;
+    QByteArray buffer_;
+    bool frameEnded_{false};
+};
+#endif
+
+#ifdef HAVE_LZMA
+class XzDecompressor : public StreamDecompressor {
+   public:
+    XzDecompressor() : buffer_(Constants::kFileLoadChunkSize, Qt::Uninitialized) {
+        initialized_ = (lzma_stream_decoder(&stream_, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK);
+    }
+    ~XzDecompressor() override { lzma_end(&stream_); }
+
+    bool Decompress(const char *data, qint64 size, const Consumer &consumer) override {
+        stream_.next_in = reinterpret_cast<const uint8_t *>(data);
+        stream_.avail_in = static_cast<size_t>(size);
+        return Code(LZMA_RUN, consumer);
+    }
+
+    bool Finish(const Consumer &consumer) override {
+        stream_.next_in = nullptr;
+        stream_.avail_in = 0;
+        return Code(LZMA_FINISH, consumer);
+    }
+
+   private:
+    bool Code(lzma_action action, const Consumer &consumer) {
+        if (!initialized_) {
+            errorString_ = QStringLiteral("Initialize liblzma failed");
+            return false;
+        }
+        for (;;) {
+            stream_.next_out = reinterpret_cast<uint8_t *>(buffer_.data());
+            stream_.avail_out = static_cast<size_t>(buffer_.size());
+            auto ret = lzma_code(&stream_, action);
+            if (ret != LZMA_OK && ret != LZMA_STREAM_END) {
+                errorString_ = (ret == LZMA_BUF_ERROR ? QStringLiteral("Unexpected end of xz data")
+                                                      : QStringLiteral("xz data is corrupted, error ") +
+                                                            QString::number(static_cast<int>(ret)));
+                return false;
+            }
+            auto produced = buffer_.size() - static_cast<qint64>(stream_.avail_out);
+            if (produced > 0 && !consumer(buffer_.constData(), produced)) {
+                return false;
+            }
+            if (ret == LZMA_STREAM_END) {
+                return true;
+            }
+            if (action == LZMA_RUN && stream_.avail_in == 0 && stream_.avail_out != 0) {
+                return true;
+            }
+        }
+    }
+
+    lzma_stream stream_ = LZMA_STREAM_INIT;
+    QByteArray buffer_;
+    bool initialized_{false};
+};
+#endif
+}  // namespace
+
+StreamDecompressor::Format StreamDecompressor::DetectFormat(const QByteArray &head) {
+    if (head.startsWith("\x1F\x8B")) {
+        return kGzip;
+    }
+    if (head.startsWith("\x28\xB5\x2F\xFD")) {
+        return kZstd;
+    }
+    if (head.startsWith(QByteArray("\xFD" "7zXZ\x00", 6))) {
+        return kXz;
+    }
+    return kNone;
+}
+
+QString StreamDecompressor::FormatName(Format format) {
+    switch (format) {
+        case kGzip:
+            return "gzip";
+        case kZstd:
+            return "zstd";
+        case kXz:
+            return "xz";
+        default:
+            return "";
+    }
+}
+
+std::unique_ptr<StreamDecompressor> StreamDecompressor::Create(Format format) {
+    switch (format) {
+#ifdef HAVE_ZLIB
+        case kGzip:
+            return std::make_unique<GzipDecompressor>();
+#endif
+#ifdef HAVE_ZSTD
+        case kZstd:
+            return std::make_unique<ZstdDecompressor>();
+#endif
+#ifdef HAVE_LZMA
+        case kXz:
+            return std::make_unique<XzDecompressor>();
+#endif
+        default:
+            qCritical() << "Not supported format: " << FormatName(format);
+            return nullptr;
+    }
+}
+}  // namespace QEditor
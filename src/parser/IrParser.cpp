@@ -420,9 +420,7 @@ const QMap<QString, NodeInfo> &IrParser::ParseNodes(const QString &funcName) {
             auto pairingCursor = res.first;
             auto success = res.second;
             if (success) {
-                while (cursor.position() < pairingCursor.position()) {
-                    cursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor);
-                }
+                cursor.setPosition(pairingCursor.position(), QTextCursor::KeepAnchor);
                 auto argumentsStr = cursor.selectedText();
                 argumentsStr = argumentsStr.mid(1, argumentsStr.length() - 2);  // Remove start '(' and end ')'.
                 qDebug() << "argumentsStr: " << argumentsStr;
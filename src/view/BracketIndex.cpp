@@ -0,0 +1,324 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BracketIndex.h"
+#include "Logger.h"
+#include <QTextBlock>
+#include <algorithm>
+
+namespace QEditor {
+namespace {
+constexpr char16_t kOpenBrackets[] = u"([{<";
+constexpr char16_t kCloseBrackets[] = u")]}>";
+}  // namespace
+
+void BracketIndex::HandleContentsChange(int from, int charsAdded) {
+    if (!built_) {
+        return;  // Not queried yet.
+    }
+    // The blocks from 'first' to 'last' replace the changed ones, the same as EditView::UpdateVisualLines().
+    auto first = document_->findBlock(from);
+    auto last = document_->findBlock(from + charsAdded);
+    if (!last.isValid()) {
+        last = document_->lastBlock();
+    }
+    const int blockCount = static_cast<int>(blocks_.size());
+    const int newCount = last.blockNumber() - first.blockNumber() + 1;
+    const int oldCount = newCount - (document_->blockCount() - blockCount);
+    if (!first.isValid() || oldCount <= 0 || first.blockNumber() + oldCount > blockCount) {
+        Invalidate();
+        return;
+    }
+
+    std::vector<Balance> balances;
+    balances.reserve(newCount);
+    for (auto block = first; block.isValid(); block = block.next()) {
+        balances.emplace_back(Measure(block.text()));
+        if (block == last) {
+            break;
+        }
+    }
+    const auto begin = blocks_.begin() + first.blockNumber();
+    if (oldCount == newCount) {
+        std::copy(balances.cbegin(), balances.cend(), begin);
+        for (int group = first.blockNumber() / kGroupSize; group <= last.blockNumber() / kGroupSize; ++group) {
+            UpdateGroup(group);
+        }
+        return;
+    }
+    // The blocks after are moved to other groups.
+    blocks_.erase(begin, begin + oldCount);
+    blocks_.insert(blocks_.begin() + first.blockNumber(), balances.cbegin(), balances.cend());
+    BuildTree();
+}
+
+void BracketIndex::Invalidate() {
+    built_ = false;
+    blocks_.clear();
+    tree_.clear();
+    groupCount_ = 0;
+}
+
+int BracketIndex::FindClose(int position, QChar open, QChar close) const {
+    const auto type = TypeOf(open, close);
+    if (type == -1) {
+        return -1;
+    }
+    EnsureBuilt();
+    const auto block = document_->findBlock(position);
+    if (!block.isValid()) {
+        return -1;
+    }
+
+    // In the same block.
+    int depth = 1;
+    auto text = block.text();
+    for (int i = position - block.position() + 1; i < text.size(); ++i) {
+        if (text[i] == open) {
+            ++depth;
+        } else if (text[i] == close && --depth == 0) {
+            return block.position() + i;
+        }
+    }
+
+    // Skip the groups not closing all, then the blocks in the group found.
+    const int blockCount = static_cast<int>(blocks_.size());
+    int blockNumber = block.blockNumber() + 1;
+    while (blockNumber < blockCount) {
+        if (blockNumber % kGroupSize == 0) {
+            const auto group = FindGroupForward(1, 0, groupCount_, blockNumber / kGroupSize, type, depth);
+            if (group == -1) {
+                return -1;
+            }
+            blockNumber = group * kGroupSize;
+        }
+        const auto &balance = blocks_[blockNumber];
+        if (balance.close[type] >= depth) {
+            break;
+        }
+        depth += balance.open[type] - balance.close[type];
+        ++blockNumber;
+    }
+    if (blockNumber >= blockCount) {
+        return -1;
+    }
+
+    // The 'depth'-th unmatched close bracket of the block.
+    const auto target = document_->findBlockByNumber(blockNumber);
+    text = target.text();
+    for (int i = 0; i < text.size(); ++i) {
+        if (text[i] == open) {
+            ++depth;
+        } else if (text[i] == close && --depth == 0) {
+            return target.position() + i;
+        }
+    }
+    qCritical() << "Bracket index is out of date, block: " << blockNumber;
+    return -1;
+}
+
+int BracketIndex::FindOpen(int position, QChar open, QChar close) const {
+    const auto type = TypeOf(open, close);
+    if (type == -1) {
+        return -1;
+    }
+    EnsureBuilt();
+    const auto block = document_->findBlock(position);
+    if (!block.isValid()) {
+        return -1;
+    }
+
+    // In the same block.
+    int depth = 1;
+    auto text = block.text();
+    for (int i = position - block.position() - 1; i >= 0; --i) {
+        if (text[i] == close) {
+            ++depth;
+        } else if (text[i] == open && --depth == 0) {
+            return block.position() + i;
+        }
+    }
+
+    // Skip the groups not opening all, then the blocks in the group found.
+    const int blockCount = static_cast<int>(blocks_.size());
+    int blockNumber = block.blockNumber() - 1;
+    while (blockNumber >= 0) {
+        if ((blockNumber + 1) % kGroupSize == 0) {
+            const auto group = FindGroupBackward(1, 0, groupCount_, (blockNumber + 1) / kGroupSize, type, depth);
+            if (group == -1) {
+                return -1;
+            }
+            blockNumber = std::min((group + 1) * kGroupSize, blockCount) - 1;
+        }
+        const auto &balance = blocks_[blockNumber];
+        if (balance.open[type] >= depth) {
+            break;
+        }
+        depth += balance.close[type] - balance.open[type];
+        --blockNumber;
+    }
+    if (blockNumber < 0) {
+        return -1;
+    }
+
+    // The 'depth'-th unmatched open bracket of the block from the end.
+    const auto target = document_->findBlockByNumber(blockNumber);
+    text = target.text();
+    for (int i = text.size() - 1; i >= 0; --i) {
+        if (text[i] == close) {
+            ++depth;
+        } else if (text[i] == open && --depth == 0) {
+            return target.position() + i;
+        }
+    }
+    qCritical() << "Bracket index is out of date, block: " << blockNumber;
+    return -1;
+}
+
+int BracketIndex::TypeOf(QChar open, QChar close) {
+    for (int type = 0; type < kTypeCount; ++type) {
+        if (open == kOpenBrackets[type] && close == kCloseBrackets[type]) {
+            return type;
+        }
+    }
+    return -1;
+}
+
+BracketIndex::Balance BracketIndex::Measure(const QString &text) {
+    Balance balance;
+    for (const auto &ch : text) {
+        for (int type = 0; type < kTypeCount; ++type) {
+            if (ch == kOpenBrackets[type]) {
+                ++balance.open[type];
+                break;
+            }
+            if (ch == kCloseBrackets[type]) {
+                if (balance.open[type] > 0) {
+                    --balance.open[type];
+                } else {
+                    ++balance.close[type];
+                }
+                break;
+            }
+        }
+    }
+    return balance;
+}
+
+BracketIndex::Balance BracketIndex::Combine(const Balance &lhs, const Balance &rhs) {
+    Balance balance;
+    for (int type = 0; type < kTypeCount; ++type) {
+        const auto matched = std::min(lhs.open[type], rhs.close[type]);
+        balance.close[type] = lhs.close[type] + rhs.close[type] - matched;
+        balance.open[type] = lhs.open[type] - matched + rhs.open[type];
+    }
+    return balance;
+}
+
+void BracketIndex::EnsureBuilt() const {
+    if (built_) {
+        return;
+    }
+    blocks_.clear();
+    blocks_.reserve(document_->blockCount());
+    for (auto block = document_->begin(); block != document_->end(); block = block.next()) {
+        blocks_.emplace_back(Measure(block.text()));
+    }
+    BuildTree();
+    built_ = true;
+    qDebug() << "Bracket index built, blocks: " << blocks_.size();
+}
+
+void BracketIndex::BuildTree() const {
+    groupCount_ = std::max((static_cast<int>(blocks_.size()) + kGroupSize - 1) / kGroupSize, 1);
+    tree_.assign(groupCount_ * 4, Balance());
+    for (int group = 0; group < groupCount_; ++group) {
+        UpdateGroup(group);
+    }
+}
+
+void BracketIndex::UpdateGroup(int group) const {
+    // Walk down to the leaf, then combine the nodes on the path from bottom.
+    std::vector<int> path;
+    int node = 1;
+    int lo = 0;
+    int hi = groupCount_;
+    while (hi - lo > 1) {
+        path.emplace_back(node);
+        const auto mid = (lo + hi) / 2;
+        if (group < mid) {
+            node = node * 2;
+            hi = mid;
+        } else {
+            node = node * 2 + 1;
+            lo = mid;
+        }
+    }
+    tree_[node] = GroupBalance(group);
+    for (auto iter = path.crbegin(); iter != path.crend(); ++iter) {
+        tree_[*iter] = Combine(tree_[*iter * 2], tree_[*iter * 2 + 1]);
+    }
+}
+
+BracketIndex::Balance BracketIndex::GroupBalance(int group) const {
+    Balance balance;
+    const auto end = std::min((group + 1) * kGroupSize, static_cast<int>(blocks_.size()));
+    for (int i = group * kGroupSize; i < end; ++i) {
+        balance = Combine(balance, blocks_[i]);
+    }
+    return balance;
+}
+
+int BracketIndex::FindGroupForward(int node, int lo, int hi, int from, int type, int &depth) const {
+    if (hi <= from) {
+        return -1;
+    }
+    const auto &balance = tree_[node];
+    if (lo >= from && balance.close[type] < depth) {
+        depth += balance.open[type] - balance.close[type];
+        return -1;
+    }
+    if (hi - lo == 1) {
+        return lo;
+    }
+    const auto mid = (lo + hi) / 2;
+    const auto group = FindGroupForward(node * 2, lo, mid, from, type, depth);
+    if (group != -1) {
+        return group;
+    }
+    return FindGroupForward(node * 2 + 1, mid, hi, from, type, depth);
+}
+
+int BracketIndex::FindGroupBackward(int node, int lo, int hi, int to, int type, int &depth) const {
+    if (lo >= to) {
+        return -1;
+    }
+    const auto &balance = tree_[node];
+    if (hi <= to && balance.open[type] < depth) {
+        depth += balance.close[type] - balance.open[type];
+        return -1;
+    }
+    if (hi - lo == 1) {
+        return lo;
+    }
+    const auto mid = (lo + hi) / 2;
+    const auto group = FindGroupBackward(node * 2 + 1, mid, hi, to, type, depth);
+    if (group != -1) {
+        return group;
+    }
+    return FindGroupBackward(node * 2, lo, mid, to, type, depth);
+}
+}  // namespace QEditor
@@ -0,0 +1,83 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CapabilityManager.h"
+#include "Constants.h"
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+
+namespace QEditor {
+namespace {
+constexpr double kNewSampleWeight = 0.3;
+
+const char *const kFeatureNames[] = {"parsing", "highlighting", "scrollbar scan"};
+
+// Nanoseconds per char of each feature, shared by all documents.
+struct CostModel {
+    CostModel() {
+        constexpr double budgetNsecs = Constants::kCapabilityBackgroundBudget * 1000000.0;
+        nsecsPerChar[CapabilityManager::kParsing] = budgetNsecs / Constants::kMaxParseCharNum;
+        nsecsPerChar[CapabilityManager::kHighlighting] = budgetNsecs / Constants::kMaxParseCharNum;
+        nsecsPerChar[CapabilityManager::kScrollbarScan] = budgetNsecs / Constants::kMaxHighlightScrollbarCharNum;
+    }
+
+    std::atomic<double> nsecsPerChar[CapabilityManager::kFeatureCount];
+    std::atomic<bool> measured[CapabilityManager::kFeatureCount]{};
+};
+
+CostModel &Model() {
+    static CostModel model;
+    return model;
+}
+}  // namespace
+
+CapabilityManager::Tier CapabilityManager::tier(Feature feature) const {
+    // The document is not complete while loading, so take the file size if larger.
+    const auto chars = std::max(static_cast<qint64>(document_->characterCount()), fileSize_);
+    const auto cost = EstimateCost(feature, chars);
+    if (cost <= Constants::kCapabilityFullBudget) {
+        return kFull;
+    }
+    if (cost <= Constants::kCapabilityBackgroundBudget) {
+        return kBackground;
+    }
+    return kOff;
+}
+
+void CapabilityManager::Record(Feature feature, qint64 chars, qint64 nsecs) {
+    // Too short to measure.
+    if (chars < Constants::kCapabilityMinSampleChars) {
+        return;
+    }
+    auto &model = Model();
+    const auto sample = static_cast<double>(nsecs) / chars;
+    auto &cost = model.nsecsPerChar[feature];
+    if (!model.measured[feature].exchange(true)) {
+        cost = sample;
+    } else {
+        // Smooth the samples, a single slow run doesn't turn the feature off.
+        auto old = cost.load();
+        while (!cost.compare_exchange_weak(old, old * (1 - kNewSampleWeight) + sample * kNewSampleWeight)) {
+        }
+    }
+    qDebug() << "Cost of " << kFeatureNames[feature] << ": " << sample << "ns/char, estimated: " << cost.load();
+}
+
+qreal CapabilityManager::EstimateCost(Feature feature, qint64 chars) {
+    return Model().nsecsPerChar[feature].load() * chars / 1000000;
+}
+}  // namespace QEditor
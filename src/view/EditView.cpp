@@ -15,20 +15,27 @@
  */
 
 #include "EditView.h"
+#include "AutoSaveJournal.h"
 #include "Constants.h"
+#include "FileFollower.h"
+#include "FileLoader.h"
+#include "FileSaver.h"
 #include "FunctionHierarchy.h"
 #include "IrParser.h"
 #include "Logger.h"
 #include "MainTabView.h"
 #include "MainWindow.h"
+#include "MarkScanner.h"
+#include "MiniMap.h"
 #include "OutlineList.h"
+#include "RawByteCache.h"
 #include "SearchDialog.h"
 #include "Toast.h"
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QPainter>
-#include <QSaveFile>
 #include <QStatusBar>
 #include <QTextBlock>
 #include <QTextLayout>
@@ -44,7 +51,9 @@ EditView::EditView(const QFileInfo &fileInfo, QWidget *parent)
       filePath_(fileInfo.canonicalFilePath()),
       fileType_(filePath_),
       menu_(new QMenu(parent)) {
-    if (!fileType_.IsUnknown() && AllowRichParsing()) {
+    // The highlighting of the loaded text is spread over the chunks.
+    capabilities_.SetFileSize(fileInfo.size());
+    if (!fileType_.IsUnknown() && capabilities_.Allow(CapabilityManager::kHighlighting)) {
         highlighter_ = new TextHighlighter(fileType_, document(), "");
     }
 
@@ -63,6 +72,15 @@ EditView::EditView(QWidget *parent)
     Init();
 }
 
+EditView::~EditView() {
+    StopFollowing();
+    CancelLoading();
+    delete fileSaver_;  // Wait for the saving.
+    if (!filePath_.isEmpty()) {
+        RawByteCache::Instance().Remove(filePath_);
+    }
+}
+
 void EditView::Init() {
     setBackgroundVisible(false);
     // setCenterOnScroll(true);
@@ -92,6 +110,7 @@ void EditView::Init() {
     currentFontSize_ = font().pointSize();
 
     lineNumberArea_ = new LineNumberArea(this);
+    miniMap_ = new MiniMap(this);
 
     connect(this, &QPlainTextEdit::blockCountChanged, this, &EditView::HandleBlockCountChanged);
     connect(this, &QPlainTextEdit::updateRequest, this, &EditView::HandleUpdateRequest);
@@ -101,6 +120,30 @@ void EditView::Init() {
     connect(this->document(), &QTextDocument::contentsChanged, this, &EditView::HandleContentsChanged);
     connect(this->document(), &QTextDocument::contentsChange, this, &EditView::HandleContentsChange);
 
+    markScanner_ = new MarkScanner(document(), this);
+    connect(markScanner_, &MarkScanner::sigScanned, this, &EditView::HandleMarksScanned);
+
+    // Count the selected text after the selection settles.
+    selectionScanner_ = new MarkScanner(document(), this);
+    connect(selectionScanner_, &MarkScanner::sigScanned, this, &EditView::HandleSelectionScanned);
+    selectionCountTimer_ = new QTimer(this);
+    selectionCountTimer_->setSingleShot(true);
+    selectionCountTimer_->setInterval(Constants::kSelectionCountDelay);
+    connect(selectionCountTimer_, &QTimer::timeout, this, [this]() { selectionScanner_->Scan({selectedText_}); });
+
+    searchScanner_ = new MarkScanner(document(), this);
+    connect(searchScanner_, &MarkScanner::sigScanned, this, &EditView::HandleSearchScanned);
+
+    parseTimer_ = new QTimer(this);
+    parseTimer_->setSingleShot(true);
+    parseTimer_->setInterval(Constants::kParseDelay);
+    connect(parseTimer_, &QTimer::timeout, this, [this]() {
+        // Parse for the current tab only, the others parse when activated.
+        if (tabView()->currentWidget() == this) {
+            Parse();
+        }
+    });
+
     connect(this, &QPlainTextEdit::copyAvailable, this, &EditView::HandleCopyAvailable);
     connect(this, &QPlainTextEdit::undoAvailable, this, &EditView::HandleUndoAvailable);
     connect(this, &QPlainTextEdit::redoAvailable, this, &EditView::HandleRedoAvailable);
@@ -152,6 +195,14 @@ void EditView::ApplySpecialCharsVisible() {
     document()->setDefaultTextOption(textOption);
 }
 
+void EditView::ApplyMiniMapVisible() {
+    const auto visible = MainWindow::Instance().miniMapVisible();
+    if (miniMap_->isHidden() == visible) {
+        miniMap_->setVisible(visible);
+        HandleBlockCountChanged(0);
+    }
+}
+
 void EditView::ApplyTabCharNum() {
     int num = MainWindow::Instance().tabCharNum();
     qreal monoSingleSpace = QFontMetricsF(font()).horizontalAdvance(QLatin1Char('9'));
@@ -165,6 +216,224 @@ void EditView::setFileEncoding(FileEncoding &&fileEncoding) {
     MainWindow::Instance().UpdateStatusBarRareInfo("Unix", fileEncoding_.name(), 0);
 }
 
+void EditView::LoadFile(const QString &filePath, FileEncoding &&fileEncoding, bool forceUseFileEncoding) {
+    StopFollowing();
+    CancelLoading();
+    setFileLoaded(false);
+    setReadOnly(true);
+    document()->setUndoRedoEnabled(false);
+    clear();
+
+    // If to change the codec only, decode the raw bytes kept in memory instead of reading the file again.
+    auto rawBytes = (forceUseFileEncoding ? RawByteCache::Instance().Get(filePath) : nullptr);
+    if (rawBytes != nullptr) {
+        qDebug() << "Decode the raw bytes again, " << filePath;
+        fileLoader_ = new FileLoader(filePath, std::move(rawBytes), fileEncoding.codec(), fileEncoding.hasBom());
+    } else {
+        fileLoader_ = new FileLoader(filePath, fileEncoding.codec(), fileEncoding.hasBom(), forceUseFileEncoding);
+    }
+    setFileEncoding(std::move(fileEncoding));
+    auto loadId = ++loadId_;
+    connect(fileLoader_, &FileLoader::sigEncodingDetected, this, [this, loadId](int mibEnum, bool hasBom) {
+        if (loadId != loadId_) {
+            return;
+        }
+        fileEncoding_ = FileEncoding(QTextCodec::codecForMib(mibEnum), hasBom);
+        if (tabView()->currentWidget() == this) {
+            MainWindow::Instance().UpdateStatusBarRareInfo("Unix", fileEncoding_.name(), 0);
+        }
+    });
+    connect(fileLoader_, &FileLoader::sigRestarted, this, [this, loadId]() {
+        if (loadId != loadId_) {
+            return;
+        }
+        clear();
+    });
+    connect(fileLoader_, &FileLoader::sigChunkLoaded, this, [this, loadId](const QString &text) {
+        if (loadId != loadId_) {
+            return;
+        }
+        // Append at the end, not to move the view cursor.
+        QTextCursor cursor(document());
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(text);
+    });
+    connect(fileLoader_, &FileLoader::sigProgressChanged, this, [this, loadId](int percent) {
+        if (loadId != loadId_ || tabView()->currentWidget() != this) {
+            return;
+        }
+        MainWindow::Instance().statusBar()->showMessage(tr("Loading... %1%").arg(percent));
+    });
+    connect(fileLoader_, &FileLoader::sigFinished, this, [this, loadId](bool success, const QString &errorString) {
+        if (loadId != loadId_) {
+            return;
+        }
+        loadedFileSize_ = fileLoader_->loadedSize();
+        capabilities_.SetFileSize(loadedFileSize_);
+        compressed_ = fileLoader_->compressed();
+        delete fileLoader_;
+        fileLoader_ = nullptr;
+
+        document()->setUndoRedoEnabled(true);
+        setReadOnly(false);
+        setFileLoaded(true);
+        SetModified(false);
+        TrigerParser();
+        if (!success) {
+            QMessageBox::warning(
+                this, tr(Constants::kAppName),
+                tr("Cannot read file %1:\n%2.").arg(QDir::toNativeSeparators(filePath_), errorString));
+            return;
+        }
+        if (tabView()->currentWidget() == this) {
+            MainWindow::Instance().statusBar()->showMessage(tr("File loaded"), 2000);
+        }
+        qDebug() << "File loaded, " << fileName();
+    });
+    fileLoader_->Start();
+}
+
+void EditView::SetLoadedText(const QString &text, FileEncoding &&fileEncoding, qint64 loadedSize, bool compressed) {
+    fileEncoding_ = std::move(fileEncoding);
+    setPlainText(text);
+    loadedFileSize_ = loadedSize;
+    compressed_ = compressed;
+    setFileLoaded(true);
+}
+
+void EditView::SetPendingRestore(bool fromFile, const QString &text) {
+    pendingRestore_ = true;
+    restoreFromFile_ = fromFile;
+    pendingText_ = text;
+}
+
+void EditView::Restore() {
+    if (!pendingRestore_) {
+        return;
+    }
+    pendingRestore_ = false;
+    if (restoreFromFile_) {
+        (void)tabView()->LoadFile(this, filePath_);
+        return;
+    }
+    // Keep the modified state restored, not changed by setting text.
+    bool modified = ShouldSave();
+    setPlainText(pendingText_);
+    journalLength_ = pendingText_.size();
+    pendingText_.clear();
+    setFileLoaded(true);
+    SetModified(modified);
+    qDebug() << "Restored, " << fileName();
+}
+
+int EditView::StartJournal() {
+    auto &journal = AutoSaveJournal::Instance();
+    if (journalId_ == -1) {
+        journalId_ = journal.NewId();
+    }
+    const auto &text = pendingRestore_ ? pendingText_ : toPlainText();
+    journal.Rebase(journalId_, fileEncoding_.mibEnum(), text);
+    journalLength_ = text.size();
+    return journalId_;
+}
+
+void EditView::JournalChange(int from, int charsRemoved, int charsAdded) {
+    if (journalId_ == -1) {
+        (void)StartJournal();
+        // Record the journal id in files information.
+        tabView()->AutoStore();
+        return;
+    }
+    // Rebase if not consistent with the text journaled, e.g. the whole document is reported as changed.
+    int length = document()->characterCount() - 1;
+    if (from + charsRemoved > journalLength_ || journalLength_ - charsRemoved + charsAdded != length) {
+        (void)StartJournal();
+        return;
+    }
+    // As toPlainText() converts.
+    QString text;
+    text.reserve(charsAdded);
+    for (int i = from; i < from + charsAdded; ++i) {
+        auto ch = document()->characterAt(i);
+        if (ch == QChar::ParagraphSeparator || ch == QChar::LineSeparator) {
+            ch = QLatin1Char('\n');
+        } else if (ch == QChar::Nbsp) {
+            ch = QLatin1Char(' ');
+        }
+        text.append(ch);
+    }
+    AutoSaveJournal::Instance().Append(journalId_, from, charsRemoved, text);
+    journalLength_ = length;
+}
+
+void EditView::CancelLoading() {
+    if (fileLoader_ == nullptr) {
+        return;
+    }
+    ++loadId_;
+    delete fileLoader_;  // Wait for the loading thread.
+    fileLoader_ = nullptr;
+}
+
+void EditView::StartFollowing() {
+    if (following() || filePath_.isEmpty()) {
+        return;
+    }
+    if (loading()) {
+        Toast::Instance().Show(Toast::kWarning, tr("File is still loading, can't follow."));
+        return;
+    }
+    if (ShouldSave()) {
+        Toast::Instance().Show(Toast::kWarning, tr("Save the changes before following the file."));
+        return;
+    }
+    if (compressed_) {
+        Toast::Instance().Show(Toast::kWarning, tr("Can't follow compressed file."));
+        return;
+    }
+    setReadOnly(true);
+    document()->setUndoRedoEnabled(false);
+
+    fileFollower_ = new FileFollower(filePath_, fileEncoding_.codec(), loadedFileSize_);
+    auto followId = ++followId_;
+    connect(fileFollower_, &FileFollower::sigReset, this, [this, followId]() {
+        if (followId != followId_) {
+            return;
+        }
+        clear();
+    });
+    connect(fileFollower_, &FileFollower::sigTextAppended, this, [this, followId](const QString &text) {
+        if (followId != followId_) {
+            return;
+        }
+        // Keep scrolling if at the bottom, otherwise not disturb the reading.
+        auto scrollBar = verticalScrollBar();
+        bool atBottom = (scrollBar->value() == scrollBar->maximum());
+        QTextCursor cursor(document());
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(text);
+        if (atBottom) {
+            scrollBar->setValue(scrollBar->maximum());
+        }
+    });
+    fileFollower_->Start();
+    MainWindow::Instance().statusBar()->showMessage(tr("Following ") + fileName_, 2000);
+}
+
+void EditView::StopFollowing() {
+    if (fileFollower_ == nullptr) {
+        return;
+    }
+    ++followId_;
+    fileFollower_->Stop();  // Wait for the following thread.
+    loadedFileSize_ = fileFollower_->offset();
+    delete fileFollower_;
+    fileFollower_ = nullptr;
+
+    document()->setUndoRedoEnabled(true);
+    setReadOnly(false);
+}
+
 void EditView::ChangeFileEncoding(FileEncoding &&fileEncoding) {
     if (fileEncoding.hasBom() == fileEncoding_.hasBom() && fileEncoding.mibEnum() == fileEncoding_.mibEnum()) {
         return;
@@ -282,12 +551,9 @@ void EditView::AddMarkText(const QString &str) {
     }
     markTexts_.push_back(str);
 
-    // Search new added text's position for highlight scrollbar.
+    // Search all mark texts' positions in one pass for highlight scrollbar.
     if (AllowHighlightScrollbar()) {
-        const auto &lineNums = MainWindow::Instance().GetSearcher()->FindAllLineNum(str);
-        const auto &color = GetMarkTextBackground(markTexts_.size() - 1);
-        scrollbarLineInfos()[ScrollBarHighlightCategory::kCategoryMark].emplace_back(std::make_pair(lineNums, color));
-        setHightlightScrollbarInvalid(true);
+        markScanner_->Scan(markTexts_);
     }
 }
 
@@ -298,17 +564,9 @@ bool EditView::RemoveMarkText(const QString &str) {
     } else {
         res = markTexts_.removeOne(str);
     }
+    // The colors follow the indexes, so search all again.
     if (res && AllowHighlightScrollbar()) {
-        scrollbarLineInfos()[ScrollBarHighlightCategory::kCategoryMark].clear();
-        // Search all positions for highlight scrollbar.
-        for (int i = 0; i < markTexts_.size(); ++i) {
-            const auto &text = markTexts_[i];
-            const auto &color = GetMarkTextBackground(i);
-            const auto &lineNums = MainWindow::Instance().GetSearcher()->FindAllLineNum(text);
-            scrollbarLineInfos()[ScrollBarHighlightCategory::kCategoryMark].emplace_back(
-                std::make_pair(lineNums, color));
-        }
-        setHightlightScrollbarInvalid(true);
+        markScanner_->Scan(markTexts_);
     }
     return res;
 }
@@ -316,9 +574,64 @@ bool EditView::RemoveMarkText(const QString &str) {
 void EditView::ClearMarkTexts() {
     markTexts_.clear();
     if (AllowHighlightScrollbar()) {
-        scrollbarLineInfos()[ScrollBarHighlightCategory::kCategoryMark].clear();
+        markScanner_->Scan(markTexts_);
+    }
+}
+
+void EditView::HandleSelectionScanned() {
+    const auto &blockNumbers = selectionScanner_->blockNumbers();
+    selectedTextMatchCount_ = blockNumbers.empty() ? 0 : static_cast<int>(blockNumbers.front().size());
+
+    auto &scrollbarInfos = scrollbarLineInfos()[ScrollBarHighlightCategory::kCategoryFocus];
+    bool needInvalidate = !scrollbarInfos.empty();
+    scrollbarInfos.clear();
+    if (selectedTextMatchCount_ > 0 && AllowHighlightScrollbar()) {
+        scrollbarInfos.emplace_back(std::make_pair(LineNumbersOfBlocks(blockNumbers.front()), QColor(0xff00c0c0)));
+        needInvalidate = true;
+    }
+    if (needInvalidate) {
         setHightlightScrollbarInvalid(true);
     }
+    if (tabView()->currentWidget() == this) {
+        UpdateStatusBarWithCursor();
+    }
+}
+
+void EditView::HandleMarksScanned() {
+    auto &scrollbarInfos = scrollbarLineInfos()[ScrollBarHighlightCategory::kCategoryMark];
+    scrollbarInfos.clear();
+    const auto &blockNumbers = markScanner_->blockNumbers();
+    for (int i = 0; i < static_cast<int>(blockNumbers.size()); ++i) {
+        scrollbarInfos.emplace_back(std::make_pair(LineNumbersOfBlocks(blockNumbers[i]), GetMarkTextBackground(i)));
+    }
+    setHightlightScrollbarInvalid(true);
+}
+
+void EditView::ScanSearchText(const QString &text) {
+    if (!AllowHighlightScrollbar()) {
+        searchScanner_->Scan({});
+        return;
+    }
+    searchScanner_->Scan({text});
+}
+
+void EditView::HandleSearchScanned() {
+    auto &scrollbarInfos = scrollbarLineInfos()[ScrollBarHighlightCategory::kCategorySearch];
+    scrollbarInfos.clear();
+    const auto &blockNumbers = searchScanner_->blockNumbers();
+    if (!blockNumbers.empty()) {
+        scrollbarInfos.emplace_back(std::make_pair(LineNumbersOfBlocks(blockNumbers.front()), QColor(0xff00c000)));
+    }
+    setHightlightScrollbarInvalid(true);
+}
+
+std::vector<int> EditView::LineNumbersOfBlocks(const std::vector<int> &blockNumbers) const {
+    std::vector<int> lineNums;
+    lineNums.reserve(blockNumbers.size());
+    for (auto blockNumber : blockNumbers) {
+        lineNums.emplace_back(LineNumberOfBlock(blockNumber));
+    }
+    return lineNums;
 }
 
 QColor EditView::GetMarkTextBackground(int i) {
@@ -343,7 +656,7 @@ void EditView::HighlightMarkTexts() {
     for (int i = 0; i < markTexts_.size(); ++i) {
         const auto &text = markTexts_[i];
         const auto &color = GetMarkTextBackground(i);
-        HighlightVisibleChars(text, QColor(Qt::white), color);
+        HighlightVisibleChars(text, HighlightOverlay::kLayerMark + i, color);
     }
 }
 
@@ -385,7 +698,15 @@ void EditView::setFilePath(const QString &filePath) {
 
 void EditView::HandleBlockCountChanged(int newBlockCount) {
     qDebug() << "newBlockCount: " << newBlockCount;
-    setViewportMargins(GetLineNumberAreaWidth(), 0, 0, 0);
+    setViewportMargins(GetLineNumberAreaWidth(), 0, miniMap_->isHidden() ? 0 : Constants::kMiniMapWidth, 0);
+    UpdateMiniMapGeometry();
+}
+
+void EditView::UpdateMiniMapGeometry() {
+    // Beside the scrollbar.
+    const auto viewportRect = viewport()->geometry();
+    miniMap_->setGeometry(QRect(viewportRect.right() + 1, viewportRect.top(), Constants::kMiniMapWidth,
+                                viewportRect.height()));
 }
 
 void EditView::HandleUpdateRequest(const QRect &rect, int dy) {
@@ -418,47 +739,75 @@ void EditView::SetCurrentFile(const QString &filePath) {
 }
 
 bool EditView::SaveFile(const QString &filePath) {
-    QString errorMessage;
-
-    QGuiApplication::setOverrideCursor(Qt::WaitCursor);
-    QSaveFile file(filePath);
-    if (file.open(QFile::WriteOnly | QFile::Text)) {
-        QTextStream out(&file);
-        if (fileEncoding().hasBom()) {
-            out.setGenerateByteOrderMark(true);
-        }
-
-#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-        out.setCodec(fileEncoding().codec());
-#else
-        out.setEncoding(QStringConverter::Utf8);
-        qCritical() << "Force to use UTF8!!!";
-#endif
+    Restore();
+    if (loading()) {
+        Toast::Instance().Show(Toast::kWarning, tr("File is still loading, can't save."));
+        return false;
+    }
+    if (compressed_ && filePath == filePath_) {
+        Toast::Instance().Show(Toast::kWarning,
+                               tr("Can't save compressed file in place, please save as another file."));
+        return false;
+    }
+    if (saving()) {
+        Toast::Instance().Show(Toast::kWarning, tr("File is still saving, please retry later."));
+        return false;
+    }
 
-        out << toPlainText();
-        if (!file.commit()) {
-            errorMessage = tr("Cannot write file %1:\n%2.").arg(QDir::toNativeSeparators(filePath), file.errorString());
+    // Encode and write a snapshot of the text in background, the editing goes on.
+    fileSaver_ = new FileSaver(filePath, toPlainText(), fileEncoding().codec(), fileEncoding().hasBom());
+    saveRevision_ = document()->revision();
+    const auto saveId = ++saveId_;
+    connect(fileSaver_, &FileSaver::sigFinished, this, [this, saveId](bool success, const QString &errorString) {
+        if (saveId != saveId_ || !saving()) {
+            return;
         }
-    } else {
-        errorMessage =
-            tr("Cannot open file %1 for writing:\n%2.").arg(QDir::toNativeSeparators(filePath), file.errorString());
+        (void)HandleSaveFinished(success, errorString);
+    });
+    saveFilePath_ = filePath;
+    fileSaver_->Start();
+    MainWindow::Instance().statusBar()->showMessage(tr("Saving..."));
+    return true;
+}
+
+bool EditView::WaitForSaving() {
+    if (!saving()) {
+        return true;
     }
-    QGuiApplication::restoreOverrideCursor();
+    fileSaver_->Wait();
+    const auto errorString = fileSaver_->errorString();
+    return HandleSaveFinished(errorString.isEmpty(), errorString);
+}
 
-    if (!errorMessage.isEmpty()) {
-        QMessageBox::warning(this, tr(Constants::kAppName), errorMessage);
+bool EditView::HandleSaveFinished(bool success, const QString &errorString) {
+    delete fileSaver_;
+    fileSaver_ = nullptr;
+    const auto filePath = std::move(saveFilePath_);
+    saveFilePath_.clear();
+    if (!success) {
+        // Still the old path, not to point at the file not written.
+        QMessageBox::warning(this, tr(Constants::kAppName), errorString);
         return false;
     }
-
-    SetModified(false);
-    setFilePath(filePath);
-    QFileInfo fileInfo = QFileInfo(filePath);
-    auto fileName = fileInfo.fileName();
-    setFileName(fileName);
-    auto index = tabView()->indexOf(this);
-    tabView()->ChangeTabDescription(fileInfo, index);
+    // Still modified if edited during the saving.
+    if (document()->revision() == saveRevision_) {
+        SetModified(false);
+    }
+    const auto oldFilePath = filePath_;
+    if (filePath != oldFilePath) {
+        setFilePath(filePath);
+        compressed_ = false;
+        setFileName(QFileInfo(filePath).fileName());
+    }
+    QFileInfo fileInfo = QFileInfo(filePath_);
+    loadedFileSize_ = fileInfo.size();
+    capabilities_.SetFileSize(loadedFileSize_);
+    // The canonical path is valid only after the new file is written.
+    tabView()->ChangeTabDescription(fileInfo, tabView()->indexOf(this));
     tabView()->UpdateWindowTitle();
-
+    if (filePath_ != oldFilePath) {
+        tabView()->HandleFileSavedAs(this, oldFilePath);
+    }
     MainWindow::Instance().statusBar()->showMessage(tr("File saved"), 2000);
     return true;
 }
@@ -486,6 +835,8 @@ bool EditView::SaveAs() {
 
 // Return true if save or discard, otherwise false.
 bool EditView::MaybeSave() {
+    // Still modified if the last saving failed, then asked below.
+    (void)WaitForSaving();
     if (!ShouldSave()) {  // Not use document()->isModified() any more.
         return true;
     }
@@ -500,7 +851,8 @@ bool EditView::MaybeSave() {
     int res = warningBox.exec();
     switch (res) {
         case QMessageBox::Save:
-            return SaveFile(filePath_);
+            // Closing goes on only if written.
+            return SaveFile(filePath_) && WaitForSaving();
         case QMessageBox::Discard:
             return true;
         case QMessageBox::Cancel:
@@ -528,15 +880,22 @@ void EditView::SetModified(bool modified) {
     SetModifiedIcon(modified);
     setWindowModified(modified);
     tabView()->UpdateWindowTitle();
+
+    // Saved or undone, the journal is not needed any more.
+    if (!modified && fileLoaded_ && journalId_ != -1) {
+        journalId_ = -1;
+        tabView()->AutoStore();
+    }
 }
 
-void EditView::HighlightFocusChars() { HighlightVisibleChars(selectedText_); }
+void EditView::HighlightFocusChars() { HighlightVisibleChars(selectedText_, HighlightOverlay::kLayerFocus); }
 
 // Hightlight the 'text' only in the visible region.
-void EditView::HighlightVisibleChars(const QString &text, const QColor &foreground, const QColor &background) {
+void EditView::HighlightVisibleChars(const QString &text, int layer, const QColor &background) {
     if (text.isEmpty()) {
         return;
     }
+    overlay_.SetLayer(layer, background);
 
     QPoint bottomRight(viewport()->width() - 1, viewport()->height() - 1);
     QTextCursor visibleBottomCursor = cursorForPosition(bottomRight);
@@ -588,13 +947,7 @@ void EditView::HighlightVisibleChars(const QString &text, const QColor &foregrou
             qDebug() << "Touch the bottom, " << posInText << " >= " << visibleBottomPos;
             return;
         }
-        if (!HighlightChars(posInText, text.size(), foreground, background)) {
-            auto error = QString("Hightlight selected text failed. The texts count to mark exceed %1")
-                             .arg(Constants::kMaxExtraSelectionsMarkCount);
-            qCritical() << error;
-            Toast::Instance().Show(Toast::kError, error);
-            return;
-        }
+        overlay_.AddRange(layer, posInText, posInText + text.size());
     }
 #else  // BLOCK_POS_SEARCH
     int start = 0;
@@ -620,13 +973,7 @@ void EditView::HighlightVisibleChars(const QString &text, const QColor &foregrou
                 qDebug() << "Touch the bottom, " << posInText << " >= " << visibleBottomPos;
                 return;
             }
-            if (!HighlightChars(posInText, text.size(), foreground, background)) {
-                auto error = QString(tr("Hightlight selected text failed. The texts count to mark exceed %1"))
-                                 .arg(Constants::kMaxExtraSelectionsMarkCount);
-                qCritical() << error;
-                Toast::Instance().Show(Toast::kError, error);
-                return;
-            }
+            overlay_.AddRange(layer, posInText, posInText + text.size());
             start += text.size();
             start = block.text().indexOf(text, start);
         }
@@ -664,20 +1011,15 @@ void EditView::HandleCursorPositionChanged() {
     if (text != selectedText_) {
         selectedText_ = std::move(text);
 
-        selectedTextMatchCount_ = 0;
-        if (AllowHighlightScrollbar()) {
-            auto &scrollbarInfos = scrollbarLineInfos()[ScrollBarHighlightCategory::kCategoryFocus];
-            bool needInvalidate = !scrollbarInfos.empty();
-            scrollbarInfos.clear();
-            if (!selectedText_.isEmpty()) {
-                const auto &lineNums = MainWindow::Instance().GetSearcher()->FindAllLineNum(selectedText_);
-                scrollbarInfos.emplace_back(std::make_pair(lineNums, QColor(0xff00c0c0)));
-                selectedTextMatchCount_ = lineNums.size();
-                needInvalidate = true;
-            }
-            if (needInvalidate) {
-                setHightlightScrollbarInvalid(true);
-            }
+        // Cancel the last counting, and clear its result.
+        selectionScanner_->Scan({});
+        // The text across blocks never matches in a block. Counting on each selection needs the full tier.
+        if (!selectedText_.isEmpty() && selectedText_.size() <= Constants::kMaxSelectionCountLength &&
+            !selectedText_.contains(QChar::ParagraphSeparator) &&
+            capabilities_.tier(CapabilityManager::kScrollbarScan) == CapabilityManager::kFull) {
+            selectionCountTimer_->start();
+        } else {
+            selectionCountTimer_->stop();
         }
     }
     highlighterInvalid_ = true;
@@ -707,15 +1049,23 @@ void EditView::HandleContentsChanged() { qDebug(); }
 
 void EditView::HandleContentsChange(int from, int charsRemoved, int charsAdded) {
     qDebug() << "@" << from << ", +" << charsAdded << ", -" << charsRemoved;
-    if (charsAdded > 50 || charsRemoved > 50) {
+    bracketIndex_.HandleContentsChange(from, charsAdded);
+    // Parse once after the loading finished.
+    if (!loading() && !following() && (charsAdded > 50 || charsRemoved > 50)) {
         TrigerParser();
     }
-    // Ignore the event before load finish.
-    if (!fileLoaded_) {
+    UpdateVisualLines(from, charsAdded);
+    markScanner_->HandleContentsChange(from, charsAdded);
+    selectionScanner_->HandleContentsChange(from, charsAdded);
+    searchScanner_->HandleContentsChange(from, charsAdded);
+    miniMap_->HandleContentsChange(from, charsAdded);
+    // Ignore the event before load finish, or the text appended by following.
+    if (!fileLoaded_ || following()) {
         return;
     }
     SetModified(true);
     highlighterInvalid_ = true;
+    JournalChange(from, charsRemoved, charsAdded);
 }
 
 void EditView::HandleCopyAvailable(bool avail) {
@@ -740,7 +1090,8 @@ void EditView::HandleRedoAvailable(bool avail) {
 
 void EditView::TrigerParser() {
     // TODO: Add more lang.
-    if (!fileType_.IsIr() || !AllowRichParsing()) {
+    const auto tier = capabilities_.tier(CapabilityManager::kParsing);
+    if (!fileType_.IsIr() || tier == CapabilityManager::kOff) {
         // if (parser_ == nullptr) {
         //     parser_ = new DummyParser(this);
         //     outlineList_ = new OutlineList(parser_);
@@ -749,13 +1100,25 @@ void EditView::TrigerParser() {
         MainWindow::Instance().HideHierarchyDockView();
         return;
     }
+    if (tier == CapabilityManager::kBackground) {
+        // Too slow to parse on each change or switch, parse once settled.
+        parseTimer_->start();
+        return;
+    }
+    Parse();
+}
 
+void EditView::Parse() {
+    parseTimer_->stop();
     // If change.
     if (MainWindow::Instance().outlineVisible() || MainWindow::Instance().hierarchyVisible()) {
         if (parser_ != nullptr) {
             delete parser_;
         }
+        QElapsedTimer timer;
+        timer.start();
         parser_ = new IrParser(this, this);
+        CapabilityManager::Record(CapabilityManager::kParsing, document()->characterCount(), timer.nsecsElapsed());
 
         if (MainWindow::Instance().outlineVisible()) {
             if (outlineList_ != nullptr) {
@@ -856,55 +1219,30 @@ void EditView::Jump() {
 std::pair<QTextCursor, bool> EditView::FindPairingBracketCursor(QTextCursor cursor, QTextCursor::MoveOperation direct,
                                                                 const QChar &startBracketChar,
                                                                 const QChar &endBracketChar) {
-    // Always start at outside of bracket, so jump one firstly.
-    if (direct == QTextCursor::Left) {
-        cursor.movePosition(direct, QTextCursor::MoveAnchor);
-    }
-
-    int moveCount = 0;
-    int recursiveDepth = 0;
-    while (cursor.movePosition(direct, QTextCursor::MoveAnchor)) {
-        // Exceed the max recursive depth or max charactors.
-        if (recursiveDepth > Constants::kMaxRecursiveDepthToPairBracket) {
-            qCritical() << "Too much recursive depth, recursiveDepth: " << recursiveDepth;
+    // Always start at outside of bracket.
+    if (direct == QTextCursor::Right) {
+        // Before the start bracket, and return the cursor after the end bracket.
+        auto position = bracketIndex_.FindClose(cursor.position(), startBracketChar, endBracketChar);
+        if (position == -1) {
             return std::make_pair(cursor, false);
         }
-        ++moveCount;
-        if (moveCount > Constants::kMaxCharsNumToPairBracket) {
-            qCritical() << "Too much distance to pairing, moveCount: " << moveCount;
-            return std::make_pair(cursor, false);
-        }
-
-        const auto &doc = document();
-        const auto charactor = doc->characterAt(cursor.position());  // Get the char on the right hand of position.
-        qDebug() << "current char: " << charactor;
-        if (charactor == startBracketChar) {
-            qDebug() << "Match more start bracket char: " << startBracketChar;
-            ++recursiveDepth;
-        }
-        if (charactor == endBracketChar) {
-            if (recursiveDepth == 0) {
-                qDebug() << "Finally match end bracket char: " << endBracketChar << " for " << startBracketChar;
-                if (direct == QTextCursor::Right) {
-                    cursor.movePosition(direct, QTextCursor::MoveAnchor);
-                }
-                return std::make_pair(cursor, true);
-            }
-            --recursiveDepth;
-        }
+        cursor.setPosition(position + 1, QTextCursor::MoveAnchor);
+        return std::make_pair(cursor, true);
     }
-    return std::make_pair(cursor, false);
+    // After the start bracket, and return the cursor before the end bracket.
+    auto position = bracketIndex_.FindOpen(cursor.position() - 1, endBracketChar, startBracketChar);
+    if (position == -1) {
+        return std::make_pair(cursor, false);
+    }
+    cursor.setPosition(position, QTextCursor::MoveAnchor);
+    return std::make_pair(cursor, true);
 }
 
-bool EditView::HighlightChars(int startPos, int count, const QColor &foreground, const QColor &background,
+void EditView::HighlightChars(int startPos, int count, const QColor &foreground, const QColor &background,
                               bool underline) {
     QList<QTextEdit::ExtraSelection> markExtraSelections = extraSelections();
     qDebug() << ", startPos: " << startPos << ", count: " << count << ", char: " << document()->characterAt(startPos)
-             << ", extras: " << markExtraSelections.size() << ", "
-             << (markExtraSelections.size() > Constants::kMaxExtraSelectionsMarkCount);
-    if (markExtraSelections.size() > Constants::kMaxExtraSelectionsMarkCount) {
-        return false;
-    }
+             << ", extras: " << markExtraSelections.size();
 
     QTextCursor startCursor = textCursor();
     startCursor.setPosition(startPos, QTextCursor::MoveAnchor);
@@ -923,15 +1261,12 @@ bool EditView::HighlightChars(int startPos, int count, const QColor &foreground,
     markExtraSelections.append(selection);
 
     setExtraSelections(markExtraSelections);
-    return true;
 }
 
 int EditView::lastPos() const { return lastPos_; }
 
 void EditView::setLastPos(int lastPos) { lastPos_ = lastPos; }
 
-std::vector<int> EditView::lineOffset() const { return lineOffset_; }
-
 void EditView::setHightlightScrollbarInvalid(bool hightlightScrollbarInvalid) {
     hightlightScrollbarInvalid_ = hightlightScrollbarInvalid;
     if (hightlightScrollbarInvalid_) {
@@ -949,39 +1284,14 @@ void EditView::HighlightBrackets(const QTextCursor &leftCursor, const QTextCurso
     qDebug() << "left char: " << document()->characterAt(leftCursor.position());
     qDebug() << "right char: " << document()->characterAt(rightCursor.position());
 
-    QList<QTextEdit::ExtraSelection> markExtraSelections = this->extraSelections();
-    if (markExtraSelections.size() > Constants::kMaxExtraSelectionsMarkCount) {
-        Toast::Instance().Show(Toast::kError,
-                               QString(tr("Highlight brackets failed. The texts count to mark exceed %1"))
-                                   .arg(Constants::kMaxExtraSelectionsMarkCount));
-        return;
-    }
-
-    // Mark all chars excluding brackets.
-    auto startCursor = leftCursor;
-    while (true) {
-        bool res = startCursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor);
-        if (!res) {
-            break;
-        }
-        qDebug() << "next char: " << document()->characterAt(startCursor.position());
-        if (startCursor == rightCursor) {
-            break;
-        }
-    }
-    QTextEdit::ExtraSelection selection;
+    // Mark all chars between the brackets.
     QColor markColor = QColor(52, 58, 78);  // (52, 58, 64);  // QColor(60, 60, 90);
-    selection.format.setBackground(markColor);
-    // TODO: Why setFontItalic() not work, but setFontUnderline works ok?
-    // selection.format.setFontItalic(true);
-    // selection.format.setFontUnderline(true);
-    selection.cursor = startCursor;
-    markExtraSelections.append(selection);
-
-    qDebug() << "markExtraSelections.size: " << markExtraSelections.size();
+    overlay_.SetLayer(HighlightOverlay::kLayerBracket, markColor);
+    overlay_.AddRange(HighlightOverlay::kLayerBracket, leftCursor.position(), rightCursor.position());
 
     // Mark brackets separately.
-    startCursor = leftCursor;
+    QList<QTextEdit::ExtraSelection> markExtraSelections = this->extraSelections();
+    auto startCursor = leftCursor;
     bool res = startCursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor);
     if (res) {
         QTextEdit::ExtraSelection selection;
@@ -1005,12 +1315,15 @@ void EditView::HighlightBrackets(const QTextCursor &leftCursor, const QTextCurso
 }
 
 void EditView::HighlightFocus() {
+    // Setting ExtraSelections also updates the viewport for the overlay.
+    overlay_.Clear();
     // Must call UnderpaintCurrentBlock() before other operations,
     // since the former clears ExtraSelections, and the latters reuses ExtraSelections.
     UnderpaintCurrentBlock();
     HighlightFocusNearBracket();
     HighlightMarkTexts();
-    HighlightVisibleChars("�", QColor(Qt::lightGray), QColor(255, 54, 54));  // Mark the unrecognized char.
+    // Mark the unrecognized char.
+    HighlightVisibleChars("�", HighlightOverlay::kLayerUnrecognizedChar, QColor(255, 54, 54));
     HighlightFocusChars();  // Focused highlight is high priority, so put it at last.
 }
 
@@ -1101,41 +1414,63 @@ void EditView::HighlightFocusNearBracket() {
 }
 
 void EditView::UnderpaintCurrentBlock() {
-    QPoint bottomRight(viewport()->width() - 1, viewport()->height() - 1);
-    QTextCursor visibleBottomCursor = cursorForPosition(bottomRight);
-    int visibleBottomPos = visibleBottomCursor.position();
+    // Clear all previous selections.
+    setExtraSelections(QList<QTextEdit::ExtraSelection>());
 
-    QTextCursor cursor = textCursor();
-    auto block = cursor.block();
-    cursor.movePosition(QTextCursor::StartOfBlock, QTextCursor::MoveAnchor);
-    QList<QTextEdit::ExtraSelection> extraSelections;
+    // Underpaint all visual lines of the block, only the visible ones are painted.
+    auto block = textCursor().block();
+    overlay_.SetLayer(HighlightOverlay::kLayerCurrentBlock, QColor(40, 40, 50), true);
+    overlay_.AddRange(HighlightOverlay::kLayerCurrentBlock, block.position(), block.position() + block.length());
+}
 
-    int startLine = 0;
-    // Suppose all lines have the same height.
-    auto lineHeight = block.layout()->lineAt(0).height();
-    auto offset = contentOffset();
-    if (offset.ry() < 0) {
-        auto offsetLine = (-offset.ry()) / lineHeight;
-        startLine = offsetLine;
+void EditView::PaintOverlay(QPaintEvent *event) {
+    if (overlay_.empty()) {
+        return;
     }
-    // Underline all visible lines in the block.
-    qDebug() << "startLine: " << startLine;
-    for (int i = startLine; i < block.lineCount(); ++i) {
-        auto posInText = block.position() + block.layout()->lineAt(i).textStart();
-        if (!block.isValid() || !block.isVisible() || posInText >= visibleBottomPos) {
+    QPainter painter(viewport());
+    painter.setClipRect(event->rect());
+    auto offset = contentOffset();
+    auto block = firstVisibleBlock();
+    while (block.isValid()) {
+        auto blockRect = blockBoundingGeometry(block).translated(offset);
+        if (blockRect.top() > event->rect().bottom()) {
             break;
         }
-        QTextEdit::ExtraSelection selection;
-        QColor lineColor = QColor(40, 40, 50);
-        selection.format.setBackground(lineColor);
-        selection.format.setProperty(QTextFormat::FullWidthSelection, true);
-        selection.cursor = cursor;
-        selection.cursor.clearSelection();
-        extraSelections.append(selection);
-
-        cursor.movePosition(QTextCursor::Down, QTextCursor::MoveAnchor);
+        auto layout = block.layout();
+        if (!block.isVisible() || layout == nullptr || blockRect.bottom() < event->rect().top()) {
+            block = block.next();
+            continue;
+        }
+        auto position = blockRect.topLeft() + layout->position();
+        auto blockStart = block.position();
+        overlay_.ForEachRange(
+            blockStart, blockStart + block.length(),
+            [&](const QColor &background, bool fullWidth, const HighlightOverlay::Range &range) {
+                for (int i = 0; i < layout->lineCount(); ++i) {
+                    auto line = layout->lineAt(i);
+                    auto lineStart = blockStart + line.textStart();
+                    auto lineEnd = lineStart + line.textLength();
+                    if (fullWidth) {
+                        // The empty line also counts.
+                        if (lineStart < range.end && std::max(lineEnd, lineStart + 1) > range.start) {
+                            painter.fillRect(QRectF(0, position.y() + line.y(), viewport()->width(), line.height()),
+                                             background);
+                        }
+                        continue;
+                    }
+                    auto start = std::max(lineStart, range.start);
+                    auto end = std::min(lineEnd, range.end);
+                    if (start >= end) {
+                        continue;
+                    }
+                    auto left = line.cursorToX(start - blockStart);
+                    auto right = line.cursorToX(end - blockStart);
+                    painter.fillRect(QRectF(position.x() + left, position.y() + line.y(), right - left, line.height()),
+                                     background);
+                }
+            });
+        block = block.next();
     }
-    setExtraSelections(extraSelections);
 }
 
 // Get line number from coordinate y.
@@ -1212,11 +1547,13 @@ void EditView::HandleLineNumberAreaPaintEvent(QPaintEvent *event) {
 
 void EditView::paintEvent(QPaintEvent *event) {
     qDebug() << event->type();
-    QPlainTextEdit::paintEvent(event);
     if (highlighterInvalid()) {
         HighlightFocus();
         highlighterInvalid_ = false;
     }
+    // Under the text.
+    PaintOverlay(event);
+    QPlainTextEdit::paintEvent(event);
 }
 
 void EditView::showEvent(QShowEvent *event) {
@@ -1227,6 +1564,7 @@ void EditView::showEvent(QShowEvent *event) {
 
     ApplyWrapTextState();
     ApplySpecialCharsVisible();
+    ApplyMiniMapVisible();
     ApplyTabCharNum();
 
     QPlainTextEdit::showEvent(event);
@@ -1238,11 +1576,10 @@ void EditView::resizeEvent(QResizeEvent *event) {
 
     QRect cr = contentsRect();
     lineNumberArea_->setGeometry(QRect(cr.left(), cr.top(), GetLineNumberAreaWidth(), cr.height()));
+    UpdateMiniMapGeometry();
 
     qDebug() << "contentOffset: " << contentOffset();
     qDebug() << "firstVisibleBlock.rect: " << blockBoundingRect(firstVisibleBlock());
-
-    resized_ = true;
 }
 
 void EditView::wheelEvent(QWheelEvent *event) {
@@ -1482,70 +1819,87 @@ void EditView::contextMenuEvent(QContextMenuEvent *event) {
     selectAllAction->setStatusTip(tr("Select all"));
     connect(selectAllAction, &QAction::triggered, this, [this]() { selectAll(); });
     menu_->addAction(selectAllAction);
+    if (!filePath_.isEmpty()) {
+        menu_->addSeparator();
+        auto followAction = new QAction(tr("Follow File Changes"), this);
+        followAction->setStatusTip(tr("Append the text written to the file, like 'tail -f'"));
+        followAction->setCheckable(true);
+        followAction->setChecked(following());
+        connect(followAction, &QAction::triggered, this, [this](bool checked) {
+            if (checked) {
+                StartFollowing();
+            } else {
+                StopFollowing();
+            }
+        });
+        menu_->addAction(followAction);
+    }
 
     menu_->exec(event->globalPos());
 }
 
 bool EditView::eventFilter(QObject *obj, QEvent *event) {
     qDebug() << "event: " << event->type() << ", obj: " << obj;
-    if (event->type() == QEvent::LayoutRequest) {
-        layoutRequested_ = true;
-    }
     return QObject::eventFilter(obj, event);
 }
 
-void EditView::HandleLineOffset() {
-    qCritical() << ">>>>>" << fileName();
-    if (!MainWindow::Instance().shouldWrapText()) {
+void EditView::EnsureVisualLines() const {
+    const auto width = VisualLineWidth();
+    if (!visualLines_.empty() && visualLines_.size() == blockCount() && width == visualLinesWidth_ &&
+        font() == visualLinesFont_) {
         return;
     }
-    lineOffset_.clear();
+    std::vector<int> counts;
+    counts.reserve(blockCount());
+    for (auto block = document()->begin(); block != document()->end(); block = block.next()) {
+        counts.emplace_back(VisualLineCount(block, width));
+    }
+    visualLines_.Assign(std::move(counts));
+    visualLinesWidth_ = width;
+    visualLinesFont_ = font();
+    qDebug() << fileName() << "visual lines measured, blocks: " << visualLines_.size()
+             << ", lines: " << visualLines_.Sum() << ", width: " << width;
+}
 
-#if 0
-    auto documentLayout = qobject_cast<QPlainTextDocumentLayout *>(document()->documentLayout());
-    if (documentLayout == nullptr) {
+void EditView::UpdateVisualLines(int from, int charsAdded) {
+    if (visualLines_.empty()) {
+        return;  // Not measured yet.
+    }
+    // The blocks from 'first' to 'last' replace the changed ones, the others are not changed.
+    auto first = document()->findBlock(from);
+    auto last = document()->findBlock(from + charsAdded);
+    if (!last.isValid()) {
+        last = document()->lastBlock();
+    }
+    const int newCount = last.blockNumber() - first.blockNumber() + 1;
+    const int oldCount = newCount - (blockCount() - visualLines_.size());
+    if (!first.isValid() || oldCount <= 0 || first.blockNumber() + oldCount > visualLines_.size()) {
+        InvalidateVisualLines();
         return;
     }
-    for (auto block = document()->begin(); block != document()->end(); block = block.next()) {
-        documentLayout->ensureBlockLayout(block);
+    std::vector<int> counts;
+    counts.reserve(newCount);
+    for (auto block = first; block.isValid(); block = block.next()) {
+        counts.emplace_back(VisualLineCount(block, visualLinesWidth_));
+        if (block == last) {
+            break;
+        }
     }
-#endif
+    visualLines_.Replace(first.blockNumber(), oldCount, counts);
+}
 
-    int offset = 0;
-    int blockHeight = 0;
-    for (auto block = document()->begin(); block != document()->end(); block = block.next()) {
-#if 0
-        if (block.layout() == nullptr) {
-            qDebug() << fileName() << "block layout is null";
-            continue;
-        }
-#endif
-        offset += blockHeight;
-        lineOffset_.emplace_back(offset);
+qreal EditView::VisualLineWidth() const {
+    constexpr int margin = 10;
+    return rect().width() - verticalScrollBar()->rect().width() - lineNumberArea_->rect().width() - margin;
+}
 
-#if 0
-        blockHeight = block.layout()->lineCount();
-        qCritical() << fileName() << "offset: " << offset << ", blockHeight: " << blockHeight << block.text()
-                    << block.layout()->position();
-#else
-        // Calculate the line count of block by self.
-        constexpr int margin = 10;
-        const auto width = QFontMetricsF(font()).horizontalAdvance(block.text(), -1);
-        const auto widgetWidth =
-            rect().width() - verticalScrollBar()->rect().width() - lineNumberArea_->rect().width() - margin;
-        const auto quot = width / widgetWidth;
-        blockHeight = qMax(qCeil(quot), 1);
-        qDebug() << fileName() << "[" << lineOffset_.size() << "]: offset: " << offset
-                 << ", blockHeight: " << blockHeight << qCeil(quot) << quot << "=" << width << "/" << widgetWidth << "("
-                 << rect().width() << verticalScrollBar()->rect().width() << lineNumberArea_->rect().width() << "), "
-                 << block.text();
-#endif
+int EditView::VisualLineCount(const QTextBlock &block, qreal width) const {
+    // Calculate the line count of block by self, the layout may not be done.
+    if (width <= 0) {
+        return 1;
     }
-    // lineOffset_ contains (line number + 1) elements.
-    offset += blockHeight;
-    lineOffset_.emplace_back(offset);
-    qCritical() << "<<<<<" << fileName() << "lineOffset_ size: " << lineOffset_.size()
-                << ", LineCount: " << LineCount();
+    const auto textWidth = QFontMetricsF(font()).horizontalAdvance(block.text(), -1);
+    return qMax(qCeil(textWidth / width), 1);
 }
 
 // Not BlockNumber, but LineNumber.
@@ -1567,10 +1921,9 @@ int EditView::LineNumber(const QTextCursor &cursor) const {
         if (!MainWindow::Instance().shouldWrapText()) {
             linePos = cursor.blockNumber() + lineNum;
         } else {
-            // Valid after HandleLineOffset().
-            if (cursor.blockNumber() <
-                (int)lineOffset().size() - 1) {  // lineOffset_ contains (line number + 1) elements.
-                linePos = lineOffset()[cursor.blockNumber()] + lineNum;
+            EnsureVisualLines();
+            if (cursor.blockNumber() < visualLines_.size()) {
+                linePos = visualLines_.PrefixSum(cursor.blockNumber()) + lineNum;
             } else {
                 linePos = cursor.blockNumber() + lineNum;
             }
@@ -1584,14 +1937,17 @@ int EditView::LineNumber(const QTextCursor &cursor) const {
 int EditView::LineCount() const {
     if (!MainWindow::Instance().shouldWrapText()) {
         return blockCount();
-    } else {
-        // Valid after HandleLineOffset().
-        if (lineOffset().size() > 0) {
-            return lineOffset()[lineOffset().size() - 1];
-        } else {
-            return 0;
-        }
     }
+    EnsureVisualLines();
+    return visualLines_.Sum();
+}
+
+int EditView::LineNumberOfBlock(int blockNumber) const {
+    if (!MainWindow::Instance().shouldWrapText()) {
+        return blockNumber;
+    }
+    EnsureVisualLines();
+    return visualLines_.PrefixSum(qBound(0, blockNumber, visualLines_.size()));
 }
 
 QSize LineNumberArea::sizeHint() const { return QSize(editView_->GetLineNumberAreaWidth(), 0); }
@@ -1626,35 +1982,44 @@ void LineNumberArea::mouseDoubleClickEvent(QMouseEvent *event) {
     }
 }
 
-void HighlightScrollBar::PaintLines(QPainter &painter, const QRect &aboveHandleRect, const QRect &handleRect,
-                                    const QRect &belowHandleRect, const QColor &color, int pos, bool inHandle) {
-    const int hightlightWidth = aboveHandleRect.width();
-    constexpr int hightlightHeight = 1;
+void HighlightScrollBar::RebuildMarkers(const QRect &grooveRect, int lineCount) {
+    markerGroove_ = grooveRect;
+    markerLineCount_ = lineCount;
+    markers_.clear();
 
-    // Paint above area: {aboveStart(0) ~ (aboveStart + height)}
-    if (pos >= aboveHandleRect.y() && pos < aboveHandleRect.y() + aboveHandleRect.height()) {
-        painter.save();
-        painter.setClipRect(aboveHandleRect);
-        const QRect rect(aboveHandleRect.left(), pos, hightlightWidth, hightlightHeight);
-        painter.fillRect(rect, color);
-        painter.restore();
-    }
-    // Paint below area: {belowStart ~ (belowStart + height)}
-    if (pos >= belowHandleRect.y() && pos < belowHandleRect.y() + belowHandleRect.height()) {
-        painter.save();
-        painter.setClipRect(belowHandleRect);
-        const QRect rect(belowHandleRect.left(), pos, hightlightWidth, hightlightHeight);
-        painter.fillRect(rect, color);
-        painter.restore();
+    // The later marker of the same pixel row wins, the same as painting them one by one.
+    constexpr int marginL = 3;
+    constexpr int marginR = -2 * marginL + 1;
+    const int width = std::max(grooveRect.width() + marginR, 1);
+    const int height = std::max(grooveRect.height(), 1);
+    std::vector<QRgb> rows(height, 0);
+    const auto ratio = lineCount == 0 ? 0.0 : static_cast<double>(grooveRect.height()) / lineCount;
+    for (const auto &lineInfos : editView_->scrollbarLineInfos()) {
+        for (const auto &lineInfo : lineInfos) {
+            const auto rgb = lineInfo.second.rgba();
+            for (const auto &lineNum : lineInfo.first) {
+                const auto row = qRound(lineNum * ratio);
+                if (row >= 0 && row < height) {
+                    rows[row] = rgb;
+                }
+                markers_.emplace_back(lineNum, rgb);
+            }
+        }
     }
-    // Paint handle area: {handleStart ~ (handleStart + height)}
-    if (inHandle && pos >= handleRect.y() && pos < handleRect.y() + handleRect.height()) {
-        painter.save();
-        painter.setClipRect(handleRect);
-        const QRect rect(handleRect.left(), pos, hightlightWidth, hightlightHeight);
-        painter.fillRect(rect, color);
-        painter.restore();
+    std::stable_sort(markers_.begin(), markers_.end(),
+                     [](const std::pair<int, QRgb> &lhs, const std::pair<int, QRgb> &rhs) {
+                         return lhs.first < rhs.first;
+                     });
+
+    markerImage_ = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
+    markerImage_.fill(Qt::transparent);
+    for (int y = 0; y < height; ++y) {
+        if (rows[y] != 0) {
+            auto line = reinterpret_cast<QRgb *>(markerImage_.scanLine(y));
+            std::fill(line, line + width, qPremultiply(rows[y]));
+        }
     }
+    qDebug() << "Scrollbar markers rebuilt, markers: " << markers_.size() << ", rows: " << height;
 }
 
 void HighlightScrollBar::paintEvent(QPaintEvent *event) {
@@ -1673,16 +2038,10 @@ void HighlightScrollBar::paintEvent(QPaintEvent *event) {
     }
 #endif
 
+    // The visual lines are measured again by LineCount() if the width changed.
     int height = editView_->document()->documentLayout()->documentSize().height();
-    if (editView_->layoutRequested_ && editView_->resized_ && height != height_) {
-        qCritical() << "Allow to call HandleLineOffset()";
-        editView_->HandleLineOffset();
-
-        height_ = height;
-        editView_->layoutRequested_ = false;
-        editView_->resized_ = false;
-    }
 
+    const bool invalid = editView_->hightlightScrollbarInvalid();
     editView_->setHightlightScrollbarInvalid(false);
 
     QPainter painter(this);
@@ -1721,28 +2080,33 @@ void HighlightScrollBar::paintEvent(QPaintEvent *event) {
     const auto firstVisibleLineNum = editView_->LineNumber(QTextCursor(editView_->firstVisibleBlock()));
     const auto lastVisibleLineNum = firstVisibleLineNum + viewRange + 1;
 
-    const auto &scrollbarLineInfos = editView_->scrollbarLineInfos();
     qDebug() << "value: " << value() << ", minimum: " << minimum() << ", maximum: " << maximum() << height
              << ", viewRange: {" << firstVisibleLineNum << "," << lastVisibleLineNum
              << "}, LineCount: " << editView_->LineCount() << ", lineHeight: " << lineHeight << grooveRect << sliderRect
-             << ", " << aboveHandleRect << handleRect << belowHandleRect << ", " << scrollbarLineInfos.size();
+             << ", " << aboveHandleRect << handleRect << belowHandleRect;
 
-    const auto ratio = (double)(grooveRect.height()) / editView_->LineCount();
-    for (const auto &info : scrollbarLineInfos) {
-        const auto &lineInfos = info;
-        for (const auto &lineInfo : lineInfos) {
-            const auto &lineNums = lineInfo.first;
-            for (const auto &lineNum : lineNums) {
-                // Get the Y positon from line number.
-                const auto pos = grooveRect.y() + qRound(lineNum * ratio);
-                const bool inHandle = (lineNum >= firstVisibleLineNum && lineNum <= lastVisibleLineNum);
-                qDebug() << "pos: " << pos << ", {" << grooveRect.y() << ", " << grooveRect.y() + grooveRect.height()
-                         << "}, lineNum: " << lineNum << ", ratio: " << ratio << grooveRect.height()
-                         << editView_->LineCount();
-                PaintLines(painter, aboveHandleRect, handleRect, belowHandleRect, lineInfo.second, pos, inHandle);
-            }
+    // Bin the markers into pixel rows only if changed, then blit the rows out of the handle.
+    const auto lineCount = editView_->LineCount();
+    if (invalid || grooveRect != markerGroove_ || lineCount != markerLineCount_) {
+        RebuildMarkers(grooveRect, lineCount);
+    }
+    for (const auto &rect : {aboveHandleRect, belowHandleRect}) {
+        if (rect.height() > 0) {
+            painter.drawImage(rect.topLeft(), markerImage_,
+                              QRect(0, rect.y() - grooveRect.y(), rect.width(), rect.height()));
         }
     }
+
+    // Only the visible lines are marked in the handle.
+    const auto ratio = lineCount == 0 ? 0.0 : static_cast<double>(grooveRect.height()) / lineCount;
+    painter.setClipRect(handleRect);
+    auto iter = std::lower_bound(
+        markers_.cbegin(), markers_.cend(), firstVisibleLineNum,
+        [](const std::pair<int, QRgb> &marker, int lineNum) { return marker.first < lineNum; });
+    for (; iter != markers_.cend() && iter->first <= lastVisibleLineNum; ++iter) {
+        const auto pos = grooveRect.y() + qRound(iter->first * ratio);
+        painter.fillRect(QRect(handleRect.left(), pos, handleRect.width(), 1), QColor::fromRgba(iter->second));
+    }
 }
 
 void HighlightScrollBar::sliderChange(QAbstractSlider::SliderChange change) {
@@ -207,6 +207,17 @@ void ExplorerTreeView::timerEvent(QTimerEvent *event) {
     QTreeView::timerEvent(event);
 }
 
+QString ExplorerTreeView::rootPath() const {
+    if (!rootPath_.isEmpty()) {
+        return QDir::cleanPath(rootPath_);
+    }
+    const auto index = proxyModel_->mapToSource(currentIndex());
+    if (!index.isValid()) {
+        return QString();
+    }
+    return model_->isDir(index) ? model_->filePath(index) : model_->fileInfo(index).absolutePath();
+}
+
 void ExplorerTreeView::GotoPathPosition(const QString &path) {
     gotoPath_ = path;
     gotoDir_ = path.section('/', 0, -2);
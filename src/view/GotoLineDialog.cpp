@@ -62,6 +62,21 @@ void GotoLineDialog::showEvent(QShowEvent *) {
 
 void GotoLineDialog::on_pushButtonOk_clicked() {
     auto lineStr = ui_->lineEditGotoLine->text();
+    auto largeFileView = MainWindow::Instance().largeFileView();
+    if (largeFileView != nullptr) {
+        qint64 largeLine = lineStr.toLongLong();
+        // The line count is unknown until indexing finished.
+        if (largeLine <= 0 || (largeFileView->indexed() && largeLine > largeFileView->lineCount())) {
+            qCritical() << "The line number is wrong: " << largeLine;
+            return;
+        }
+        largeFileView->GotoLine(largeLine - 1);
+        close();
+        return;
+    }
+    if (editView() == nullptr) {
+        return;
+    }
     int line = lineStr.toInt();
     if (line <= 0 || line > editView()->document()->blockCount()) {
         qCritical() << "The line number is wrong: " << line;
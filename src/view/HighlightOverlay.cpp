@@ -0,0 +1,69 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HighlightOverlay.h"
+#include <algorithm>
+
+namespace QEditor {
+void HighlightOverlay::SetLayer(int id, const QColor &background, bool fullWidth) {
+    auto &layer = layers_[id];
+    layer.background = background;
+    layer.fullWidth = fullWidth;
+}
+
+void HighlightOverlay::AddRange(int id, int start, int end) {
+    if (start > end) {
+        return;
+    }
+    auto &ranges = layers_[id].ranges;
+    // Mostly found from top to bottom.
+    if (ranges.empty() || ranges.back().start <= start) {
+        if (!ranges.empty() && ranges.back().end >= start) {
+            ranges.back().end = std::max(ranges.back().end, end);
+        } else {
+            ranges.push_back({start, end});
+        }
+        return;
+    }
+
+    // Merge with all ranges overlapped or adjacent.
+    auto first = std::partition_point(ranges.begin(), ranges.end(), [start](const Range &range) {
+        return range.end < start;
+    });
+    auto last = std::partition_point(first, ranges.end(), [end](const Range &range) { return range.start <= end; });
+    if (first == last) {
+        ranges.insert(first, {start, end});
+        return;
+    }
+    first->start = std::min(first->start, start);
+    first->end = std::max((last - 1)->end, end);
+    ranges.erase(first + 1, last);
+}
+
+void HighlightOverlay::ForEachRange(
+    int from, int to, const std::function<void(const QColor &, bool fullWidth, const Range &)> &visitor) const {
+    for (const auto &item : layers_) {
+        const auto &layer = item.second;
+        // Both starts and ends are sorted, since not overlapped.
+        auto iter = std::partition_point(layer.ranges.cbegin(), layer.ranges.cend(), [from](const Range &range) {
+            return range.end <= from && range.start < from;
+        });
+        for (; iter != layer.ranges.cend() && iter->start < to; ++iter) {
+            visitor(layer.background, layer.fullWidth, *iter);
+        }
+    }
+}
+}  // namespace QEditor
@@ -0,0 +1,1265 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LargeFileView.h"
+#include "Constants.h"
+#include "EditView.h"
+#include "Logger.h"
+#include "MainTabView.h"
+#include "MainWindow.h"
+#include "Toast.h"
+#include <QApplication>
+#include <QClipboard>
+#include <QContextMenuEvent>
+#include <QMessageBox>
+#include <QPainter>
+#include <QSaveFile>
+#include <QSet>
+#include <QScrollBar>
+#include <QStatusBar>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+
+namespace QEditor {
+LargeFileView::LargeFileView(const QFileInfo &fileInfo, QWidget *parent)
+    : QAbstractScrollArea(parent),
+      tabView_((TabView *)parent),
+      fileName_(fileInfo.fileName()),
+      filePath_(fileInfo.canonicalFilePath()),
+      file_(filePath_),
+      menu_(new QMenu(parent)) {
+    setStyleSheet(
+        "color:rgb(215,215,210); background-color:rgb(28,28,28); selection-color:lightGray; "
+        "selection-background-color:rgb(9,71,113); border:none;");
+    verticalScrollBar()->setStyleSheet(
+        "QScrollBar{background:rgb(28,28,28); border:none; width:15px;}"
+        "QScrollBar::handle{background:rgb(54,54,54); border:none;}"
+        "QScrollBar::add-line:vertical{border:none; background:none;}"
+        "QScrollBar::sub-line:vertical{border:none; background:none;}");
+    horizontalScrollBar()->setStyleSheet(
+        "QScrollBar{background:rgb(28,28,28); border:none; height:15px;}"
+        "QScrollBar::handle{background:rgb(54,54,54); border:none;}"
+        "QScrollBar::add-line:horizontal{border:none;background:none;}"
+        "QScrollBar::sub-line:horizontal{border:none;background:none;}");
+    menu_->setStyleSheet(
+        "QMenu{color:lightGray; background-color:rgb(40,40,40); margin:2px 2px; border:none;} "
+        "QMenu::item{color:rgb(225,225,225); background-color:rgb(40,40,40); "
+        "padding:5px 5px;} QMenu::item:selected{background-color:rgb(9,71,113);}"
+        "QMenu::item:pressed{border:1px solid rgb(60,60,60); background-color:rgb(29,91,133);} "
+        "QMenu::separator{height:1px; background-color:rgb(80,80,80);}");
+
+    setFont(QFont("Consolas", 11));
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setCursor(Qt::IBeamCursor);
+}
+
+LargeFileView::~LargeFileView() {
+    indexCanceled_ = true;
+    if (indexThread_.joinable()) {
+        indexThread_.join();
+    }
+    if (saveThread_.joinable()) {
+        saveThread_.join();
+    }
+    Unmap();
+}
+
+bool LargeFileView::Load() {
+    if (!Map()) {
+        return false;
+    }
+    DetectEncoding();
+    if (!IsByteNewLineCodec(fileEncoding_.mibEnum())) {
+        qCritical() << "Not support encoding for large file: " << fileEncoding_.name();
+        return false;
+    }
+    table_.Reset(data_, size_, &lineIndex_);
+    StartIndexing();
+    UpdateScrollBars();
+    qDebug() << "File mapped, " << filePath_ << ", size: " << size_ << ", encoding: " << fileEncoding_.name();
+    return true;
+}
+
+bool LargeFileView::Map() {
+    if (!file_.open(QFile::ReadOnly)) {
+        QMessageBox::warning(
+            this, tr(Constants::kAppName),
+            tr("Cannot read file %1:\n%2.").arg(QDir::toNativeSeparators(filePath_), file_.errorString()));
+        return false;
+    }
+    map_ = file_.map(0, file_.size());
+    if (map_ == nullptr) {
+        QMessageBox::warning(
+            this, tr(Constants::kAppName),
+            tr("Cannot map file %1:\n%2.").arg(QDir::toNativeSeparators(filePath_), file_.errorString()));
+        return false;
+    }
+    data_ = reinterpret_cast<const char *>(map_);
+    size_ = file_.size();
+    return true;
+}
+
+void LargeFileView::Unmap() {
+    if (map_ != nullptr) {
+        file_.unmap(map_);
+        map_ = nullptr;
+    }
+    file_.close();
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool LargeFileView::IsByteNewLineCodec(int mibEnum) {
+    // UCS-2, UCS-4, UTF-16 and UTF-32 serials.
+    static const QSet<int> wideMibs = {1000, 1001, 1013, 1014, 1015, 1017, 1018, 1019};
+    return !wideMibs.contains(mibEnum);
+}
+
+void LargeFileView::DetectEncoding() {
+    // Check Byte Order Mark.
+    const auto &bom = QByteArray::fromRawData(data_, std::min<qint64>(size_, 4));
+    auto bomCodec = QTextCodec::codecForUtfText(bom, nullptr);
+    if (bomCodec != nullptr) {
+        fileEncoding_ = FileEncoding(bomCodec, true);
+        if (bomCodec->mibEnum() == 106) {
+            data_ += 3;
+            size_ -= 3;
+        }
+        return;
+    }
+
+    // If no BOM, only the sampled windows are touched, not to page in the whole file.
+    fileEncoding_ = FileEncoding(FileEncoding::DetectCodec(data_, size_));
+}
+
+void LargeFileView::setFileEncoding(FileEncoding &&fileEncoding) {
+    if (!IsByteNewLineCodec(fileEncoding.mibEnum())) {
+        Toast::Instance().Show(Toast::kError, tr("Can't view large file in ") + fileEncoding.name());
+        return;
+    }
+    fileEncoding_ = std::move(fileEncoding);
+    maxLineWidth_ = 0;
+    viewport()->update();
+
+    // Update status bar info. if file encoding changes.
+    MainWindow::Instance().UpdateStatusBarRareInfo("Unix", fileEncoding_.name(), 0);
+}
+
+void LargeFileView::StartIndexing() {
+    if (indexThread_.joinable()) {
+        indexThread_.join();
+    }
+    const auto data = data_;
+    const auto size = size_;
+    const auto fileInfo = QFileInfo(filePath_);
+    indexThread_ = std::thread([this, data, size, fileInfo]() {
+        auto lineIndex = std::make_shared<LineIndex>();
+        // Only the first open pays for the scan.
+        if (!lineIndex->LoadCache(fileInfo)) {
+            if (!lineIndex->Build(data, size, indexCanceled_)) {
+                qDebug() << "Indexing canceled.";
+                return;
+            }
+            (void)lineIndex->StoreCache(fileInfo);
+        }
+        QMetaObject::invokeMethod(
+            this, [this, lineIndex]() { HandleIndexFinished(lineIndex); }, Qt::QueuedConnection);
+    });
+    MainWindow::Instance().statusBar()->showMessage(tr("Indexing lines of ") + fileName_ + "...");
+}
+
+void LargeFileView::HandleIndexFinished(const std::shared_ptr<LineIndex> &lineIndex) {
+    lineIndex_ = std::move(*lineIndex);
+    // No edit before indexed, so nothing lost.
+    table_.Reset(data_, size_, &lineIndex_);
+    UpdateScrollBars();
+    if (pendingLine_ != -1) {
+        auto line = pendingLine_;
+        pendingLine_ = -1;
+        GotoLine(line);
+    }
+    viewport()->update();
+    MainWindow::Instance().statusBar()->showMessage(tr("File loaded"), 2000);
+    if (tabView_->currentWidget() == this) {
+        UpdateStatusBarWithCursor();
+    }
+}
+
+void LargeFileView::StartFollowing() {
+    if (following()) {
+        return;
+    }
+    if (!lineIndex_.built()) {
+        Toast::Instance().Show(Toast::kWarning, tr("Indexing lines, can't follow until finished."));
+        return;
+    }
+    if (saving_ || table_.modified()) {
+        Toast::Instance().Show(Toast::kWarning, tr("Save the changes before following the file."));
+        return;
+    }
+    followBomSize_ = data_ - reinterpret_cast<const char *>(map_);
+    // The mapped bytes are read directly, so only poll the size here, no reading thread as EditView needs.
+    followTimer_ = new QTimer(this);
+    connect(followTimer_, &QTimer::timeout, this, &LargeFileView::HandleFollowTimeout);
+    followTimer_->start(Constants::kFileFollowPollInterval);
+    // The file may grow after mapped.
+    HandleFollowTimeout();
+    MainWindow::Instance().statusBar()->showMessage(tr("Following ") + fileName_, 2000);
+}
+
+void LargeFileView::StopFollowing() {
+    delete followTimer_;
+    followTimer_ = nullptr;
+}
+
+void LargeFileView::HandleFollowTimeout() {
+    // Wait for the index of the truncated file.
+    if (data_ != nullptr && !lineIndex_.built()) {
+        return;
+    }
+    const auto fileSize = QFileInfo(filePath_).size();
+    const auto mappedSize = (data_ == nullptr ? followBomSize_ : followBomSize_ + size_);
+    if (fileSize == mappedSize || (data_ == nullptr && fileSize < mappedSize)) {
+        return;
+    }
+    const bool appended = (data_ != nullptr && fileSize > mappedSize);
+    const auto oldSize = size_;
+    auto scrollBar = verticalScrollBar();
+    const bool atBottom = (scrollBar->value() == scrollBar->maximum());
+
+    // The pages beyond the end of a truncated file can't be touched, so unmap before painting again.
+    Unmap();
+    if (fileSize <= followBomSize_) {
+        // Truncated or rotated, map again after written.
+        lineIndex_.Clear();
+        table_.Reset(nullptr, 0, &lineIndex_);
+        SetCursor(0, 0);
+        UpdateScrollBars();
+        viewport()->update();
+        return;
+    }
+    if (!Map()) {
+        StopFollowing();
+        table_.Reset(nullptr, 0, &lineIndex_);
+        viewport()->update();
+        return;
+    }
+    data_ += followBomSize_;
+    size_ -= followBomSize_;
+
+    if (appended) {
+        // Not modified while following, so the pieces are simply reset, and the offsets before keep valid.
+        lineIndex_.Extend(data_, oldSize, size_);
+        table_.Reset(data_, size_, &lineIndex_);
+        UpdateScrollBars();
+        // Keep scrolling if at the bottom, otherwise not disturb the reading.
+        if (atBottom) {
+            scrollBar->setValue(scrollBar->maximum());
+        }
+    } else {
+        qDebug() << "File truncated, " << filePath_;
+        lineIndex_.Clear();
+        table_.Reset(data_, size_, &lineIndex_);
+        SetCursor(0, 0);
+        scrollBar->setValue(0);
+        UpdateScrollBars();
+        StartIndexing();
+    }
+    viewport()->update();
+    if (tabView_->currentWidget() == this) {
+        UpdateStatusBarWithCursor();
+    }
+}
+
+void LargeFileView::UpdateScrollBars() {
+    qint64 lines = lineIndex_.built() ? table_.lineCount() : 1;
+    auto maxLine = std::max<qint64>(0, lines - VisibleLineCount());
+    verticalScrollBar()->setRange(0, std::min<qint64>(maxLine, std::numeric_limits<int>::max()));
+    verticalScrollBar()->setPageStep(VisibleLineCount());
+    verticalScrollBar()->setSingleStep(1);
+
+    auto textWidth = viewport()->width() - GutterWidth();
+    horizontalScrollBar()->setRange(0, std::max(0, maxLineWidth_ - textWidth));
+    horizontalScrollBar()->setPageStep(textWidth);
+    horizontalScrollBar()->setSingleStep(fontMetrics().horizontalAdvance(QLatin1Char('9')));
+}
+
+qint64 LargeFileView::FirstVisibleLine() const { return verticalScrollBar()->value(); }
+
+int LargeFileView::VisibleLineCount() const { return std::max(1, viewport()->height() / LineHeight()); }
+
+int LargeFileView::GutterWidth() const {
+    int digits = 1;
+    qint64 max = std::max<qint64>(1, lineIndex_.built() ? table_.lineCount() : FirstVisibleLine() + 1);
+    while (max >= 10) {
+        max /= 10;
+        ++digits;
+    }
+    constexpr qreal padding = 15;
+    qreal monoSingleSpace = fontMetrics().horizontalAdvance(QLatin1Char('9'));
+    return monoSingleSpace * std::max(digits, 2) + padding;
+}
+
+void LargeFileView::EnsureLineVisible(qint64 line) {
+    auto first = FirstVisibleLine();
+    auto visible = VisibleLineCount();
+    if (line < first) {
+        verticalScrollBar()->setValue(line);
+    } else if (line >= first + visible) {
+        verticalScrollBar()->setValue(line - visible + 1);
+    }
+}
+
+QString LargeFileView::DecodeLine(qint64 start, qint64 end) {
+    if (end <= start) {
+        return QString();
+    }
+    const auto &bytes = table_.Read(start, end);
+    return fileEncoding_.codec()->toUnicode(bytes.constData(), bytes.size());
+}
+
+QString LargeFileView::ExpandTabs(const QString &text) const {
+    if (!text.contains(QLatin1Char('\t'))) {
+        return text;
+    }
+    const int tabCharNum = std::max(1, MainWindow::Instance().tabCharNum());
+    QString res;
+    res.reserve(text.size() + tabCharNum * 4);
+    for (const auto &ch : text) {
+        if (ch == QLatin1Char('\t')) {
+            res.append(QString(tabCharNum - res.size() % tabCharNum, QLatin1Char(' ')));
+        } else {
+            res.append(ch);
+        }
+    }
+    return res;
+}
+
+qreal LargeFileView::OffsetToX(qint64 lineStart, qint64 offset) {
+    return fontMetrics().horizontalAdvance(ExpandTabs(DecodeLine(lineStart, offset)));
+}
+
+qint64 LargeFileView::PointToOffset(const QPoint &pos, qint64 *line) {
+    if (data_ == nullptr) {
+        return -1;
+    }
+    qint64 targetLine = FirstVisibleLine() + std::max(0, pos.y()) / LineHeight();
+    if (lineIndex_.built() && targetLine >= table_.lineCount()) {
+        targetLine = table_.lineCount() - 1;
+    }
+    auto start = table_.LineStart(targetLine);
+    if (!lineIndex_.built()) {
+        // Not indexed yet, the line may exceed the end.
+        targetLine = table_.LineOf(start);
+        start = table_.LineStart(targetLine);
+    }
+    auto end = std::min<qint64>(table_.LineEnd(start),
+                                start + Constants::kMaxLargeFileLineDisplayBytes);
+    const auto &text = DecodeLine(start, end);
+
+    // Find the character under the x coordinate.
+    const auto &metrics = fontMetrics();
+    const int tabCharNum = std::max(1, MainWindow::Instance().tabCharNum());
+    const qreal x = pos.x() - GutterWidth() + horizontalScrollBar()->value();
+    qreal width = 0;
+    int column = 0;
+    int index = 0;
+    for (; index < text.size(); ++index) {
+        qreal advance;
+        if (text[index] == QLatin1Char('\t')) {
+            int spaces = tabCharNum - column % tabCharNum;
+            advance = metrics.horizontalAdvance(QLatin1Char(' ')) * spaces;
+            column += spaces;
+        } else {
+            advance = metrics.horizontalAdvance(text[index]);
+            ++column;
+        }
+        if (width + advance / 2 > x) {
+            break;
+        }
+        width += advance;
+    }
+    if (line != nullptr) {
+        *line = targetLine;
+    }
+    return start + fileEncoding_.codec()->fromUnicode(text.left(index)).size();
+}
+
+std::pair<qint64, qint64> LargeFileView::WordRangeAt(qint64 offset) {
+    auto line = table_.LineOf(offset);
+    auto start = table_.LineStart(line);
+    auto end = std::min<qint64>(table_.LineEnd(start),
+                                start + Constants::kMaxLargeFileLineDisplayBytes);
+    const auto &text = DecodeLine(start, end);
+    int index = DecodeLine(start, std::min(offset, end)).size();
+    if (index >= text.size()) {
+        return {offset, offset};
+    }
+
+    int left = index;
+    int right = index;
+    const auto charactor = text[index];
+    if (charactor == QLatin1Char(' ') || charactor == QLatin1Char('\t')) {
+        // Select all spaces.
+        while (left - 1 >= 0 && text[left - 1] == charactor) {
+            --left;
+        }
+        while (right < text.size() && text[right] == charactor) {
+            ++right;
+        }
+    } else {
+        auto isWordChar = [](const QChar &ch) { return ch.isLetterOrNumber() || ch == QLatin1Char('_'); };
+        if (!isWordChar(charactor)) {
+            ++right;
+        } else {
+            while (left - 1 >= 0 && isWordChar(text[left - 1])) {
+                --left;
+            }
+            while (right < text.size() && isWordChar(text[right])) {
+                ++right;
+            }
+        }
+    }
+    auto codec = fileEncoding_.codec();
+    return {start + codec->fromUnicode(text.left(left)).size(), start + codec->fromUnicode(text.left(right)).size()};
+}
+
+void LargeFileView::SetCursor(qint64 line, qint64 offset) {
+    currentLine_ = line;
+    cursorOffset_ = offset;
+    selectionStart_ = -1;
+    selectionEnd_ = -1;
+    selectionAnchor_ = offset;
+    viewport()->update();
+    UpdateStatusBarWithCursor();
+}
+
+void LargeFileView::MoveCursor(qint64 offset) {
+    auto line = table_.LineOf(offset);
+    SetCursor(line, offset);
+    EnsureLineVisible(line);
+}
+
+qint64 LargeFileView::PreviousCharOffset(qint64 offset) {
+    if (offset <= 0) {
+        return 0;
+    }
+    auto lineStart = table_.LineStart(table_.LineOf(offset));
+    if (offset == lineStart) {
+        // To the end of the previous line, before "\r\n".
+        auto previous = offset - 1;
+        if (previous > 0 && table_.At(previous - 1) == '\r') {
+            --previous;
+        }
+        return previous;
+    }
+    // Decode from the line start, not to start from the middle of a multi-byte character.
+    auto start = std::max<qint64>(lineStart, offset - Constants::kMaxLargeFileLineDisplayBytes);
+    auto text = DecodeLine(start, offset);
+    text.chop(text.size() > 1 && text.back().isLowSurrogate() ? 2 : 1);
+    return start + fileEncoding_.codec()->fromUnicode(text).size();
+}
+
+qint64 LargeFileView::NextCharOffset(qint64 offset) {
+    const auto size = table_.size();
+    if (offset >= size) {
+        return size;
+    }
+    auto lineEnd = table_.LineEnd(offset);
+    if (offset == lineEnd) {
+        // To the start of the next line, after "\r\n".
+        if (table_.At(offset) == '\r') {
+            ++offset;
+        }
+        return std::min(offset + 1, size);
+    }
+    // A character is 4 bytes at most in the byte newline codecs.
+    const auto &text = DecodeLine(offset, std::min<qint64>(lineEnd, offset + 4));
+    if (text.isEmpty()) {
+        return offset + 1;
+    }
+    auto length = fileEncoding_.codec()->fromUnicode(text.left(text.front().isHighSurrogate() ? 2 : 1)).size();
+    return std::min<qint64>(offset + std::max(1, length), lineEnd);
+}
+
+void LargeFileView::GotoLine(qint64 line) {
+    if (!lineIndex_.built()) {
+        // Jump after indexing finished.
+        pendingLine_ = line;
+        MainWindow::Instance().statusBar()->showMessage(tr("Indexing lines, will go to line ") +
+                                                        QString::number(line + 1) + tr(" later."));
+        return;
+    }
+    line = std::clamp<qint64>(line, 0, table_.lineCount() - 1);
+    SetCursor(line, table_.LineStart(line));
+    // Show the line in the middle of the viewport.
+    verticalScrollBar()->setValue(std::max<qint64>(0, line - VisibleLineCount() / 2));
+    horizontalScrollBar()->setValue(0);
+    setFocus();
+}
+
+qint64 LargeFileView::SearchBytes(const QByteArray &pattern, qint64 from, bool caseSensitive, bool backward) const {
+    const auto size = table_.size();
+    if (pattern.isEmpty() || from < 0 || from > size) {
+        return -1;
+    }
+    // Search window by window, not to copy the whole edited text. The windows overlap by the pattern size.
+    const qint64 window = Constants::kLargeFileSearchWindowSize;
+    const qint64 overlap = pattern.size() - 1;
+    if (!backward) {
+        for (qint64 start = from; start < size; start += window) {
+            auto end = std::min(size, start + window + overlap);
+            const auto &bytes = table_.Read(start, end);
+            auto pos = SearchBuffer(bytes.constData(), bytes.size(), pattern, caseSensitive, false);
+            if (pos != -1) {
+                return start + pos;
+            }
+            if (end == size) {
+                break;
+            }
+        }
+        return -1;
+    }
+    for (qint64 end = from; end > 0; end -= window) {
+        auto start = std::max<qint64>(0, end - window - overlap);
+        const auto &bytes = table_.Read(start, end);
+        auto pos = SearchBuffer(bytes.constData(), bytes.size(), pattern, caseSensitive, true);
+        if (pos != -1) {
+            return start + pos;
+        }
+        if (start == 0) {
+            break;
+        }
+    }
+    return -1;
+}
+
+qint64 LargeFileView::SearchBuffer(const char *data, qint64 size, const QByteArray &pattern, bool caseSensitive,
+                                   bool backward) {
+    auto lower = [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); };
+    auto hash = [lower](char c) { return std::hash<char>()(lower(c)); };
+    auto equal = [lower](char a, char b) { return lower(a) == lower(b); };
+
+    const char *begin = data;
+    const char *patternBegin = pattern.constData();
+    const char *patternEnd = patternBegin + pattern.size();
+    if (!backward) {
+        const char *end = data + size;
+        const char *found;
+        if (caseSensitive) {
+            found = std::search(begin, end, std::boyer_moore_horspool_searcher(patternBegin, patternEnd));
+        } else {
+            found = std::search(begin, end, std::boyer_moore_horspool_searcher(patternBegin, patternEnd, hash, equal));
+        }
+        return found == end ? -1 : found - begin;
+    }
+
+    // Search the reversed pattern in the reversed bytes.
+    using ReverseIter = std::reverse_iterator<const char *>;
+    ReverseIter reverseBegin(begin + size);
+    ReverseIter reverseEnd(begin);
+    ReverseIter patternReverseBegin(patternEnd);
+    ReverseIter patternReverseEnd(patternBegin);
+    ReverseIter found;
+    if (caseSensitive) {
+        found = std::search(reverseBegin, reverseEnd,
+                            std::boyer_moore_horspool_searcher(patternReverseBegin, patternReverseEnd));
+    } else {
+        found = std::search(reverseBegin, reverseEnd,
+                            std::boyer_moore_horspool_searcher(patternReverseBegin, patternReverseEnd, hash, equal));
+    }
+    if (found == reverseEnd) {
+        return -1;
+    }
+    // 'found' refers to the last byte of the match.
+    return (found.base() - begin) - pattern.size();
+}
+
+bool LargeFileView::FindNext(const QString &text, bool caseSensitive, bool backward, bool wrapAround) {
+    if (text.isEmpty() || data_ == nullptr) {
+        return false;
+    }
+    const auto &pattern = fileEncoding_.codec()->fromUnicode(text);
+    qint64 from;
+    if (backward) {
+        from = HasSelection() ? selectionStart_ : cursorOffset_;
+    } else {
+        from = HasSelection() ? selectionEnd_ : cursorOffset_;
+    }
+    auto pos = SearchBytes(pattern, from, caseSensitive, backward);
+    if (pos == -1 && wrapAround) {
+        pos = SearchBytes(pattern, backward ? table_.size() : 0, caseSensitive, backward);
+    }
+    if (pos == -1) {
+        MainWindow::Instance().statusBar()->showMessage(tr("Not found: ") + text, 2000);
+        return false;
+    }
+
+    auto line = table_.LineOf(pos);
+    SetCursor(line, pos + pattern.size());
+    selectionStart_ = pos;
+    selectionEnd_ = pos + pattern.size();
+    selectionAnchor_ = pos;
+    EnsureLineVisible(line);
+
+    // Make the match visible horizontally.
+    auto x = OffsetToX(table_.LineStart(line), pos);
+    auto textWidth = viewport()->width() - GutterWidth();
+    auto scrollX = horizontalScrollBar()->value();
+    if (x < scrollX || x > scrollX + textWidth - fontMetrics().horizontalAdvance(text)) {
+        horizontalScrollBar()->setMaximum(std::max<int>(horizontalScrollBar()->maximum(), x));
+        horizontalScrollBar()->setValue(std::max<int>(0, x - textWidth / 3));
+    }
+    viewport()->update();
+    UpdateStatusBarWithCursor();
+    return true;
+}
+
+void LargeFileView::AddMarkText(const QString &str) {
+    if (str.isEmpty() || markTexts_.contains(str)) {
+        return;
+    }
+    markTexts_.push_back(str);
+    viewport()->update();
+}
+
+bool LargeFileView::RemoveMarkText(const QString &str) {
+    bool res = markTexts_.removeOne(str);
+    if (res) {
+        viewport()->update();
+    }
+    return res;
+}
+
+void LargeFileView::ClearMarkTexts() {
+    markTexts_.clear();
+    viewport()->update();
+}
+
+QString LargeFileView::GetCursorText() {
+    if (data_ == nullptr) {
+        return "";
+    }
+    if (HasSelection()) {
+        auto end = std::min<qint64>(selectionEnd_, selectionStart_ + Constants::kMaxLargeFileLineDisplayBytes);
+        return DecodeLine(selectionStart_, end);
+    }
+    const auto &range = WordRangeAt(cursorOffset_);
+    return DecodeLine(range.first, range.second);
+}
+
+void LargeFileView::Copy() {
+    if (!HasSelection()) {
+        return;
+    }
+    if (selectionEnd_ - selectionStart_ > Constants::kMaxParseFileSize) {
+        Toast::Instance().Show(Toast::kWarning, tr("The selection is too large to copy."));
+        return;
+    }
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    clipboard->setText(DecodeLine(selectionStart_, selectionEnd_));
+}
+
+void LargeFileView::Cut() {
+    if (!HasSelection() || !CheckEditable()) {
+        return;
+    }
+    if (selectionEnd_ - selectionStart_ > Constants::kMaxParseFileSize) {
+        Toast::Instance().Show(Toast::kWarning, tr("The selection is too large to copy."));
+        return;
+    }
+    Copy();
+    ReplaceSelection(QString());
+}
+
+void LargeFileView::Paste() {
+    if (!CheckEditable()) {
+        return;
+    }
+    const auto &text = QGuiApplication::clipboard()->text();
+    if (text.isEmpty()) {
+        return;
+    }
+    ReplaceSelection(text);
+}
+
+void LargeFileView::Undo() {
+    if (!CheckEditable()) {
+        return;
+    }
+    auto cursor = table_.Undo();
+    if (cursor != -1) {
+        HandleEdited(cursor);
+    }
+}
+
+void LargeFileView::Redo() {
+    if (!CheckEditable()) {
+        return;
+    }
+    auto cursor = table_.Redo();
+    if (cursor != -1) {
+        HandleEdited(cursor);
+    }
+}
+
+bool LargeFileView::CheckEditable() {
+    if (data_ == nullptr) {
+        return false;
+    }
+    if (saving_) {
+        MainWindow::Instance().statusBar()->showMessage(tr("Saving, can't edit until finished."), 2000);
+        return false;
+    }
+    if (following()) {
+        MainWindow::Instance().statusBar()->showMessage(tr("Following, can't edit until stopped."), 2000);
+        return false;
+    }
+    if (!table_.editable()) {
+        MainWindow::Instance().statusBar()->showMessage(tr("Indexing lines, can't edit until finished."), 2000);
+        return false;
+    }
+    return true;
+}
+
+void LargeFileView::ReplaceSelection(const QString &text) {
+    auto start = HasSelection() ? selectionStart_ : cursorOffset_;
+    auto end = HasSelection() ? selectionEnd_ : cursorOffset_;
+    ReplaceRange(start, end, fileEncoding_.codec()->fromUnicode(text));
+}
+
+void LargeFileView::ReplaceRange(qint64 start, qint64 end, const QByteArray &bytes) {
+    if (!CheckEditable() || (end <= start && bytes.isEmpty())) {
+        return;
+    }
+    table_.Remove(start, end);
+    table_.Insert(start, bytes);
+    HandleEdited(start + bytes.size());
+}
+
+void LargeFileView::HandleEdited(qint64 cursor) {
+    UpdateScrollBars();
+    MoveCursor(cursor);
+    SetModifiedIcon(table_.modified());
+}
+
+void LargeFileView::SetModifiedIcon(bool modified) {
+    auto index = tabView_->indexOf(this);
+    if (modified) {
+        tabView_->setTabIcon(index, QIcon::fromTheme("modification-yes", QIcon(":/images/asterisk_blue.svg")));
+    } else {
+        tabView_->setTabIcon(index, QIcon());
+    }
+}
+
+bool LargeFileView::Save() {
+    if (!table_.modified()) {
+        return true;
+    }
+    if (saving_) {
+        return false;
+    }
+    // Opened here, so it's committed in this thread.
+    saveFile_ = std::make_unique<QSaveFile>(filePath_);
+    if (!saveFile_->open(QIODevice::WriteOnly)) {
+        QMessageBox::warning(
+            this, tr(Constants::kAppName),
+            tr("Cannot write file %1:\n%2.").arg(QDir::toNativeSeparators(filePath_), saveFile_->errorString()));
+        saveFile_.reset();
+        return false;
+    }
+    saving_ = true;
+    // Keep the BOM skipped by the map.
+    const auto bomSize = data_ - reinterpret_cast<const char *>(map_);
+    const auto bom = QByteArray(reinterpret_cast<const char *>(map_), bomSize);
+    const auto saveId = ++saveId_;
+    saveThread_ = std::thread([this, bom, saveId]() {
+        saveWritten_ = saveFile_->write(bom) == bom.size() && table_.WriteTo(saveFile_.get());
+        QMetaObject::invokeMethod(
+            this,
+            [this, saveId]() {
+                if (saveId == saveId_ && saving_) {
+                    (void)HandleSaveFinished();
+                }
+            },
+            Qt::QueuedConnection);
+    });
+    MainWindow::Instance().statusBar()->showMessage(tr("Saving ") + fileName_ + "...");
+    return true;
+}
+
+bool LargeFileView::WaitForSaving() {
+    if (!saving_) {
+        return true;
+    }
+    return HandleSaveFinished();
+}
+
+bool LargeFileView::HandleSaveFinished() {
+    saveThread_.join();
+    saving_ = false;
+
+    // The file can't be replaced while mapped on Windows. Nothing is painted before mapped again here.
+    const auto bomSize = data_ - reinterpret_cast<const char *>(map_);
+    Unmap();
+    const bool success = saveWritten_ && saveFile_->commit();
+    const auto errorString = saveFile_->errorString();
+    saveFile_.reset();  // The temporary file is removed if not committed.
+    if (!Map()) {
+        table_.Reset(nullptr, 0, &lineIndex_);
+        viewport()->update();
+        return false;
+    }
+    data_ += bomSize;
+    size_ -= bomSize;
+    if (!success) {
+        // Still the old file, keep the edits on it.
+        table_.SetOriginal(data_);
+        viewport()->update();
+        QMessageBox::warning(
+            this, tr(Constants::kAppName),
+            tr("Cannot write file %1:\n%2.").arg(QDir::toNativeSeparators(filePath_), errorString));
+        return false;
+    }
+
+    // The pieces refer to the old file, switch to the saved one. The text is the same, so is the cursor.
+    lineIndex_.Clear();
+    table_.Reset(data_, size_, &lineIndex_);
+    StartIndexing();
+    SetModifiedIcon(false);
+    UpdateScrollBars();
+    viewport()->update();
+    MainWindow::Instance().statusBar()->showMessage(tr("File saved"), 2000);
+    return true;
+}
+
+// Return true if save or discard, otherwise false.
+bool LargeFileView::MaybeSave() {
+    // Still modified if the last saving failed, then asked below.
+    (void)WaitForSaving();
+    if (!table_.modified()) {
+        return true;
+    }
+    QString text = tr("The document '%1' has been modified.\n"
+                      "Do you want to save your changes?")
+                       .arg(fileName());
+    QMessageBox warningBox(QMessageBox::Question, tr(Constants::kAppName), text,
+                           QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel, nullptr);
+    warningBox.setButtonText(QMessageBox::Save, tr("Save"));
+    warningBox.setButtonText(QMessageBox::Discard, tr("Discard"));
+    warningBox.setButtonText(QMessageBox::Cancel, tr("Cancel"));
+    int res = warningBox.exec();
+    switch (res) {
+        case QMessageBox::Save:
+            // Closing goes on only if written.
+            return Save() && WaitForSaving();
+        case QMessageBox::Discard:
+            return true;
+        case QMessageBox::Cancel:
+            return false;
+        default:
+            break;
+    }
+    return true;
+}
+
+void LargeFileView::ZoomIn() {
+    auto currentFont = font();
+    currentFont.setPointSize(font().pointSize() + 1);
+    setFont(currentFont);
+    maxLineWidth_ = 0;
+    UpdateScrollBars();
+    viewport()->update();
+}
+
+void LargeFileView::ZoomOut() {
+    auto currentFont = font();
+    currentFont.setPointSize(font().pointSize() - 1);
+    setFont(currentFont);
+    maxLineWidth_ = 0;
+    UpdateScrollBars();
+    viewport()->update();
+}
+
+void LargeFileView::UpdateStatusBarWithCursor() {
+    if (data_ == nullptr) {
+        return;
+    }
+    QString posOrSel;
+    if (HasSelection()) {
+        posOrSel = tr("Sel: ") + QString::number(selectionEnd_ - selectionStart_);
+    } else {
+        posOrSel = tr("Pos: ") + QString::number(cursorOffset_ + 1);
+    }
+    auto lineStart = table_.LineStart(currentLine_);
+    auto columnEnd = std::min<qint64>(cursorOffset_, lineStart + Constants::kMaxLargeFileLineDisplayBytes);
+    auto column = DecodeLine(lineStart, columnEnd).size();
+    auto lines = lineIndex_.built() ? QString::number(table_.lineCount()) : QString("...");
+    MainWindow::Instance().UpdateStatusBarFrequentInfo(
+        tr("Ln: ") + QString::number(currentLine_ + 1), tr("Col: ") + QString::number(column + 1), posOrSel,
+        tr("Lines: ") + lines, tr("Length: ") + QString::number(table_.size()));
+
+    // Update the rarely change information.
+    MainWindow::Instance().UpdateStatusBarRareInfo("Unix", fileEncoding_.name(), 0);
+}
+
+void LargeFileView::PaintHighlight(QPainter &painter, qint64 lineStart, qint64 start, qint64 end, int top,
+                                   const QColor &background) {
+    const qreal xOffset = GutterWidth() - horizontalScrollBar()->value();
+    const auto left = OffsetToX(lineStart, start);
+    const auto right = OffsetToX(lineStart, end);
+    painter.fillRect(QRectF(xOffset + left, top, std::max<qreal>(right - left, 1), LineHeight()), background);
+}
+
+void LargeFileView::paintEvent(QPaintEvent *event) {
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), QColor(28, 28, 28));
+    if (data_ == nullptr) {
+        return;
+    }
+
+    const auto lineHeight = LineHeight();
+    const auto ascent = fontMetrics().ascent();
+    const auto gutterWidth = GutterWidth();
+    const auto xOffset = gutterWidth - horizontalScrollBar()->value();
+    const auto viewportWidth = viewport()->width();
+    const auto viewportHeight = viewport()->height();
+
+    // Encode the mark texts once for byte searching.
+    std::vector<std::pair<QByteArray, QColor>> marks;
+    for (int i = 0; i < markTexts_.size(); ++i) {
+        marks.emplace_back(fileEncoding_.codec()->fromUnicode(markTexts_[i]), EditView::GetMarkTextBackground(i));
+    }
+
+    std::vector<std::pair<int, qint64>> lineNumbers;
+    int maxLineWidth = maxLineWidth_;
+    const auto textSize = table_.size();
+    qint64 line = FirstVisibleLine();
+    qint64 start = table_.LineStart(line);
+    painter.setClipRect(QRect(gutterWidth, 0, viewportWidth - gutterWidth, viewportHeight));
+    for (int top = 0; top < viewportHeight; top += lineHeight, ++line) {
+        if (lineIndex_.built() && line >= table_.lineCount()) {
+            break;
+        }
+        auto end = table_.LineEnd(start);
+        auto displayEnd = std::min<qint64>(end, start + Constants::kMaxLargeFileLineDisplayBytes);
+        if (line == currentLine_) {
+            painter.fillRect(QRect(gutterWidth, top, viewportWidth - gutterWidth, lineHeight), QColor(40, 40, 50));
+        }
+
+        // Mark texts.
+        const auto &lineBytes = marks.empty() ? QByteArray() : table_.Read(start, displayEnd);
+        for (const auto &mark : marks) {
+            const auto &bytes = mark.first;
+            if (bytes.isEmpty()) {
+                continue;
+            }
+            auto pos = lineBytes.constData();
+            const auto lineEnd = lineBytes.constData() + lineBytes.size();
+            while (true) {
+                pos = std::search(pos, lineEnd, bytes.constData(), bytes.constData() + bytes.size());
+                if (pos == lineEnd) {
+                    break;
+                }
+                auto offset = start + (pos - lineBytes.constData());
+                PaintHighlight(painter, start, offset, offset + bytes.size(), top, mark.second);
+                pos += bytes.size();
+            }
+        }
+
+        // Selection.
+        if (HasSelection() && selectionStart_ <= displayEnd && selectionEnd_ > start) {
+            auto selectionEnd = selectionEnd_;
+            if (selectionEnd > end) {
+                // Including '\n'.
+                selectionEnd = displayEnd;
+                auto x = xOffset + OffsetToX(start, displayEnd);
+                auto width = fontMetrics().horizontalAdvance(QLatin1Char(' '));
+                painter.fillRect(QRectF(x, top, width, lineHeight), QColor(9, 71, 113));
+            }
+            PaintHighlight(painter, start, std::max(selectionStart_, start), std::min(selectionEnd, displayEnd), top,
+                           QColor(9, 71, 113));
+        }
+
+        const auto &text = ExpandTabs(DecodeLine(start, displayEnd));
+        painter.setPen(QColor(215, 215, 210));
+        painter.drawText(xOffset, top + ascent, text);
+        int textWidth = fontMetrics().horizontalAdvance(text);
+        if (displayEnd < end) {
+            // The rest of a very long line is not shown.
+            painter.setPen(QColor(Qt::darkGray));
+            painter.drawText(xOffset + textWidth, top + ascent, " ...");
+            textWidth += fontMetrics().horizontalAdvance(" ...");
+        }
+        maxLineWidth = std::max(maxLineWidth, textWidth);
+        lineNumbers.emplace_back(top, line);
+
+        // Move to the next line.
+        auto next = end;
+        if (next < textSize && table_.At(next) == '\r') {
+            ++next;
+        }
+        if (next >= textSize) {
+            break;
+        }
+        start = next + 1;
+    }
+    painter.setClipping(false);
+
+    // Line number area.
+    auto currentFont = font();
+    currentFont.setPointSize(font().pointSize() + 1);
+    painter.setFont(currentFont);
+    painter.fillRect(QRect(0, 0, gutterWidth, viewportHeight), QColor(38, 38, 38));
+    for (const auto &lineNumber : lineNumbers) {
+        if (currentLine_ == lineNumber.second) {
+            painter.setPen(QColor(255, 0, 143));
+        } else {
+            painter.setPen(QColor(43, 145, 175));
+        }
+        QRectF rect = QRectF(0, lineNumber.first, gutterWidth - 8, lineHeight);
+        painter.drawText(rect, Qt::AlignRight | Qt::AlignVCenter, QString::number(lineNumber.second + 1));
+    }
+
+    if (maxLineWidth > maxLineWidth_) {
+        maxLineWidth_ = maxLineWidth;
+        UpdateScrollBars();
+    }
+}
+
+void LargeFileView::resizeEvent(QResizeEvent *event) {
+    QAbstractScrollArea::resizeEvent(event);
+    UpdateScrollBars();
+}
+
+void LargeFileView::scrollContentsBy(int, int) { viewport()->update(); }
+
+void LargeFileView::wheelEvent(QWheelEvent *event) {
+    // If Ctrl-Key pressed.
+    if (QApplication::keyboardModifiers() != Qt::ControlModifier) {
+        QAbstractScrollArea::wheelEvent(event);
+        return;
+    }
+    if ((!event->pixelDelta().isNull() && event->pixelDelta().y() > 0) ||
+        (!event->angleDelta().isNull() && event->angleDelta().y() > 0)) {
+        ZoomIn();
+    } else {
+        ZoomOut();
+    }
+}
+
+void LargeFileView::keyPressEvent(QKeyEvent *event) {
+    if (data_ == nullptr) {
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    if (event->matches(QKeySequence::Copy)) {
+        Copy();
+        return;
+    }
+    if (event->matches(QKeySequence::Cut)) {
+        Cut();
+        return;
+    }
+    if (event->matches(QKeySequence::Paste)) {
+        Paste();
+        return;
+    }
+    if (event->matches(QKeySequence::Undo)) {
+        Undo();
+        return;
+    }
+    if (event->matches(QKeySequence::Redo)) {
+        Redo();
+        return;
+    }
+
+    // Before indexing finished, only move in the first screen.
+    qint64 lastLine = lineIndex_.built() ? table_.lineCount() - 1 : VisibleLineCount() - 1;
+    qint64 line = currentLine_;
+    switch (event->key()) {
+        case Qt::Key_Up:
+            --line;
+            break;
+        case Qt::Key_Down:
+            ++line;
+            break;
+        case Qt::Key_PageUp:
+            line -= VisibleLineCount();
+            break;
+        case Qt::Key_PageDown:
+            line += VisibleLineCount();
+            break;
+        case Qt::Key_Left:
+            MoveCursor(PreviousCharOffset(cursorOffset_));
+            return;
+        case Qt::Key_Right:
+            MoveCursor(NextCharOffset(cursorOffset_));
+            return;
+        case Qt::Key_Home:
+            if (event->modifiers() & Qt::ControlModifier) {
+                line = 0;
+            }
+            break;
+        case Qt::Key_End:
+            if (event->modifiers() & Qt::ControlModifier) {
+                line = lastLine;
+                break;
+            }
+            MoveCursor(table_.LineEnd(table_.LineStart(line)));
+            return;
+        case Qt::Key_Backspace:
+            if (HasSelection()) {
+                ReplaceSelection(QString());
+            } else {
+                ReplaceRange(PreviousCharOffset(cursorOffset_), cursorOffset_, QByteArray());
+            }
+            return;
+        case Qt::Key_Delete:
+            if (HasSelection()) {
+                ReplaceSelection(QString());
+            } else {
+                ReplaceRange(cursorOffset_, NextCharOffset(cursorOffset_), QByteArray());
+            }
+            return;
+        case Qt::Key_Return:
+        case Qt::Key_Enter: {
+            // Follow the line ending of the current line.
+            auto lineEnd = table_.LineEnd(table_.LineStart(currentLine_));
+            ReplaceSelection(lineEnd < table_.size() && table_.At(lineEnd) == '\r' ? "\r\n" : "\n");
+            return;
+        }
+        default: {
+            const auto &text = event->text();
+            if (!text.isEmpty() && (text[0].isPrint() || text[0] == QLatin1Char('\t')) &&
+                !(event->modifiers() & (Qt::ControlModifier | Qt::AltModifier))) {
+                ReplaceSelection(text);
+                return;
+            }
+            QAbstractScrollArea::keyPressEvent(event);
+            return;
+        }
+    }
+    line = std::clamp<qint64>(line, 0, std::max<qint64>(0, lastLine));
+    SetCursor(line, table_.LineStart(line));
+    EnsureLineVisible(line);
+}
+
+void LargeFileView::mousePressEvent(QMouseEvent *event) {
+    if (event->button() != Qt::LeftButton) {
+        QAbstractScrollArea::mousePressEvent(event);
+        return;
+    }
+    qint64 line;
+    auto offset = PointToOffset(event->pos(), &line);
+    if (offset == -1) {
+        return;
+    }
+    SetCursor(line, offset);
+}
+
+void LargeFileView::mouseMoveEvent(QMouseEvent *event) {
+    if (!(event->buttons() & Qt::LeftButton) || selectionAnchor_ == -1) {
+        QAbstractScrollArea::mouseMoveEvent(event);
+        return;
+    }
+    qint64 line;
+    auto offset = PointToOffset(event->pos(), &line);
+    if (offset == -1) {
+        return;
+    }
+    currentLine_ = line;
+    cursorOffset_ = offset;
+    selectionStart_ = std::min(selectionAnchor_, offset);
+    selectionEnd_ = std::max(selectionAnchor_, offset);
+    viewport()->update();
+    UpdateStatusBarWithCursor();
+}
+
+void LargeFileView::mouseDoubleClickEvent(QMouseEvent *event) {
+    if (event->button() != Qt::LeftButton) {
+        QAbstractScrollArea::mouseDoubleClickEvent(event);
+        return;
+    }
+    qint64 line;
+    auto offset = PointToOffset(event->pos(), &line);
+    if (offset == -1) {
+        return;
+    }
+    const auto &range = WordRangeAt(offset);
+    SetCursor(line, range.second);
+    selectionStart_ = range.first;
+    selectionEnd_ = range.second;
+    selectionAnchor_ = range.first;
+    viewport()->update();
+    UpdateStatusBarWithCursor();
+}
+
+void LargeFileView::contextMenuEvent(QContextMenuEvent *event) {
+    menu_->clear();
+    QAction *findAction = new QAction(tr("Find..."), this);
+    connect(findAction, &QAction::triggered, this, []() { MainWindow::Instance().Find(); });
+    menu_->addAction(findAction);
+    QAction *gotoLineAction = new QAction(tr("Go to Line..."), this);
+    connect(gotoLineAction, &QAction::triggered, this, []() { MainWindow::Instance().GotoLine(); });
+    menu_->addAction(gotoLineAction);
+
+    menu_->addSeparator();
+    QAction *markUnmarkAction = new QAction(tr("Mark or Unmark"), this);
+    markUnmarkAction->setShortcut(QKeySequence(Qt::SHIFT + Qt::Key_F8));
+    connect(markUnmarkAction, &QAction::triggered, this, []() { MainWindow::Instance().MarkUnmarkCursorText(); });
+    menu_->addAction(markUnmarkAction);
+    QAction *unmarkAllAction = new QAction(tr("Unmark All"), this);
+    unmarkAllAction->setShortcut(QKeySequence(Qt::CTRL, Qt::SHIFT + Qt::Key_F8));
+    connect(unmarkAllAction, &QAction::triggered, this, []() { MainWindow::Instance().UnmarkAll(); });
+    menu_->addAction(unmarkAllAction);
+
+    menu_->addSeparator();
+    if (HasSelection()) {
+        auto cutAction = new QAction(tr("Cu&t"), this);
+        cutAction->setStatusTip(tr("Cut the current selection's contents to the clipboard"));
+        connect(cutAction, &QAction::triggered, this, [this]() { Cut(); });
+        menu_->addAction(cutAction);
+        auto copyAction = new QAction(tr("&Copy"), this);
+        copyAction->setStatusTip(tr("Copy the current selection's contents to the clipboard"));
+        connect(copyAction, &QAction::triggered, this, [this]() { Copy(); });
+        menu_->addAction(copyAction);
+    }
+    auto pasteAction = new QAction(tr("&Paste"), this);
+    pasteAction->setStatusTip(tr("Paste the clipboard's contents into the current selection"));
+    connect(pasteAction, &QAction::triggered, this, [this]() { Paste(); });
+    menu_->addAction(pasteAction);
+
+    menu_->addSeparator();
+    auto followAction = new QAction(tr("Follow File Changes"), this);
+    followAction->setStatusTip(tr("Show the text written to the file, like 'tail -f'"));
+    followAction->setCheckable(true);
+    followAction->setChecked(following());
+    connect(followAction, &QAction::triggered, this, [this](bool checked) {
+        if (checked) {
+            StartFollowing();
+        } else {
+            StopFollowing();
+        }
+    });
+    menu_->addAction(followAction);
+    menu_->exec(event->globalPos());
+}
+}  // namespace QEditor
@@ -21,6 +21,7 @@
 #include "MainWindow.h"
 #include "RecentFiles.h"
 #include "Settings.h"
+#include "StreamDecompressor.h"
 #include "Toast.h"
 #include <QAbstractButton>
 #include <QApplication>
@@ -102,6 +103,10 @@ void TabView::UpdateWindowTitle(int index) {
         } else {
             title = tabText(index);
         }
+        auto largeFileView = (index == -1 ? CurrentLargeFileView() : GetLargeFileView(index));
+        if (largeFileView != nullptr) {
+            path = largeFileView->filePath();
+        }
     }
 
     if (!title.isEmpty()) {
@@ -119,6 +124,15 @@ void TabView::HandleCurrentIndexChanged(int index) {
     qDebug() << "index: " << index;
     UpdateWindowTitle(index);
 
+    auto largeFileView = GetLargeFileView(index);
+    if (largeFileView != nullptr) {
+        largeFileView->UpdateStatusBarWithCursor();
+        if (MainWindow::Instance().IsExplorerDockViewShowing()) {
+            MainWindow::Instance().SetExplorerDockViewPosition(largeFileView->filePath());
+        }
+        return;
+    }
+
     auto editView = GetEditView(index);
 #if defined(USE_DIFF_TEXT_VIEW)
     if (editView == nullptr) {
@@ -128,6 +142,10 @@ void TabView::HandleCurrentIndexChanged(int index) {
     if (editView == nullptr) {
         return;
     }
+    // The tabs of last session are restored when activated, except while adding them.
+    if (!autoLoading_) {
+        editView->Restore();
+    }
     editView->UpdateStatusBarWithCursor();
     editView->TrigerParser();
     if (editView->fileLoaded()) {
@@ -161,6 +179,13 @@ void TabView::HandleTabBarClicked(int index) {
                 if (index == i) {
                     continue;
                 }
+                auto largeFileView = GetLargeFileView(i);
+                if (largeFileView != nullptr) {
+                    if (largeFileView->MaybeSave()) {
+                        DeleteWidget(largeFileView);
+                    }
+                    continue;
+                }
                 auto textView = GetEditView(i);
                 if (textView == nullptr) {
                     continue;
@@ -174,6 +199,13 @@ void TabView::HandleTabBarClicked(int index) {
         menu_->addAction(closeAllAction);
         connect(closeAllAction, &QAction::triggered, this, [this]() {
             for (int i = count() - 1; i >= 0; --i) {
+                auto largeFileView = GetLargeFileView(i);
+                if (largeFileView != nullptr) {
+                    if (largeFileView->MaybeSave()) {
+                        DeleteWidget(largeFileView);
+                    }
+                    continue;
+                }
                 auto textView = GetEditView(i);
                 if (textView == nullptr) {
                     continue;
@@ -298,6 +330,10 @@ void TabView::HandleTabBarDoubleClicked(int index) {
 }
 
 void TabView::HandleTabCloseRequested(int index) {
+    auto largeFileView = GetLargeFileView(index);
+    if (largeFileView != nullptr && !largeFileView->MaybeSave()) {
+        return;
+    }
     auto currentEditView = GetEditView(index);
     if (currentEditView == nullptr) {
         DeleteWidget(index);
@@ -309,55 +345,44 @@ void TabView::HandleTabCloseRequested(int index) {
 }
 
 bool TabView::ActionSave() {
+    auto largeFileView = CurrentLargeFileView();
+    if (largeFileView != nullptr) {
+        return largeFileView->Save();
+    }
     auto currentEditView = CurrentEditView();
-    if (!currentEditView->ShouldSave()) {
+    if (currentEditView == nullptr || !currentEditView->ShouldSave()) {
         return true;
     }
 
     if (currentEditView->filePath().isEmpty()) {  // New file.
-        if (currentEditView->SaveAs()) {
-            openFiles().insert(currentEditView->filePath());
-            RecentFiles::UpdateFiles(currentEditView->filePath());
-            MainWindow::Instance().UpdateRecentFilesMenu();
-            if (currentEditView->newFileNum() != 0) {
-                NewFileNum::SetNumber(currentEditView->newFileNum(), false);
-            }
-            return true;
-        }
-    } else {  // Open file.
-        return currentEditView->SaveFile(currentEditView->filePath());
+        return currentEditView->SaveAs();
     }
-    return false;
+    // Open file.
+    return currentEditView->SaveFile(currentEditView->filePath());
 }
 
 bool TabView::ActionSaveAs() {
     auto currentEditView = CurrentEditView();
-    if (currentEditView->filePath().isEmpty()) {  // New file.
-        if (currentEditView->SaveAs()) {
-            openFiles().insert(currentEditView->filePath());
-            RecentFiles::UpdateFiles(currentEditView->filePath());
-            MainWindow::Instance().UpdateRecentFilesMenu();
-            if (currentEditView->newFileNum() != 0) {
-                NewFileNum::SetNumber(currentEditView->newFileNum(), false);
-            }
-            return true;
-        }
-    } else {  // Open file.
-        auto oldFilePath = currentEditView->filePath();
-        if (currentEditView->SaveAs()) {
-            if (currentEditView->filePath() != oldFilePath) {
-                openFiles().remove(oldFilePath);
-                openFiles().insert(currentEditView->filePath());
-                RecentFiles::UpdateFiles(currentEditView->filePath());
-                MainWindow::Instance().UpdateRecentFilesMenu();
-            }
-            return true;
-        }
+    if (currentEditView == nullptr) {
+        return false;
     }
-    return false;
+    return currentEditView->SaveAs();
+}
+
+void TabView::HandleFileSavedAs(EditView *editView, const QString &oldFilePath) {
+    if (!oldFilePath.isEmpty()) {
+        openFiles().remove(oldFilePath);
+    }
+    openFiles().insert(editView->filePath());
+    RecentFiles::UpdateFiles(editView->filePath());
+    MainWindow::Instance().UpdateRecentFilesMenu();
 }
 
 bool TabView::TabCloseMaybeSave() {
+    auto largeFileView = CurrentLargeFileView();
+    if (largeFileView != nullptr && !largeFileView->MaybeSave()) {
+        return false;
+    }
     auto currentEditView = CurrentEditView();
     if (currentEditView == nullptr) {
         DeleteWidget(currentWidget());
@@ -366,7 +391,22 @@ bool TabView::TabCloseMaybeSave() {
     return TabCloseMaybeSaveInner(currentEditView);
 }
 
+bool TabView::LargeFilesMaybeSave() {
+    // Their edits are not auto stored.
+    for (int i = 0; i < count(); ++i) {
+        auto largeFileView = GetLargeFileView(i);
+        if (largeFileView != nullptr && !largeFileView->MaybeSave()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool TabView::TabCloseMaybeSaveInner(EditView *editView) {
+    // Check the restored text, not the empty document.
+    if (editView->pendingRestore() && editView->ShouldSave()) {
+        editView->Restore();
+    }
     if (editView->filePath().isEmpty()) {  // New file.
         if (editView->document()->isEmpty()) {
             // Close tab.
@@ -385,11 +425,13 @@ bool TabView::TabCloseMaybeSaveInner(EditView *editView) {
         warningBox.setButtonText(QMessageBox::Discard, tr("Discard"));
         warningBox.setButtonText(QMessageBox::Cancel, tr("Cancel"));
         int res = warningBox.exec();
-        if (res == QMessageBox::Discard || (res == QMessageBox::Save && editView->SaveAs())) {
+        if (res == QMessageBox::Discard || (res == QMessageBox::Save && editView->SaveAs() && editView->WaitForSaving())) {
             // Close tab.
             if (editView->newFileNum() != 0) {
                 NewFileNum::SetNumber(editView->newFileNum(), false);
             }
+            // Added when saved.
+            openFiles().remove(editView->filePath());
             DeleteWidget(editView);
         }
     } else {  // Open file.
@@ -425,8 +467,18 @@ bool TabView::TabForceCloseInner(EditView *editView) {
 }
 
 void TabView::AutoStore() {
+    // Not to overwrite the last session before loaded.
+    if (!autoLoaded_) {
+        return;
+    }
     QVector<EditView *> editViews;
+    QVector<LargeFileView *> largeFileViews;
     for (int i = 0; i < count(); ++i) {
+        auto largeFileView = GetLargeFileView(i);
+        if (largeFileView != nullptr) {
+            largeFileViews.push_back(largeFileView);
+            continue;
+        }
         auto editView = GetEditView(i);
         if (editView == nullptr) {
             continue;
@@ -436,12 +488,14 @@ void TabView::AutoStore() {
     FileRecorder fileRecorder;
     fileRecorder.SetPos(currentIndex());
     fileRecorder.SetEditViews(editViews);
+    fileRecorder.SetLargeFileViews(largeFileViews);
     fileRecorder.StoreFiles();
 }
 
 bool TabView::AutoLoad() {
     // If a file opened before auto load.
     auto currentEditView = CurrentEditView();
+    autoLoading_ = true;
 
     FileRecorder fileRecorder;
     fileRecorder.LoadFiles();
@@ -486,51 +540,96 @@ bool TabView::AutoLoad() {
             RecentFiles::UpdateFiles(filePathTip);
             MainWindow::Instance().UpdateRecentFilesMenu();
 
+            if (fileInfo.IsOriginalOpenFile() && ShouldUseLargeFileView(filePathTip)) {
+                if (!OpenLargeFile(qFileInfo)) {
+                    openFiles_.remove(filePathTip);
+                }
+                continue;
+            }
+
             editView = new EditView(qFileInfo, this);
             if (fileInfo.IsChangedOpenFile()) {
                 modified = true;
             }
         }
 
+        // Not load or set the text until the tab is activated or prefetched.
         if (fileInfo.IsOriginalOpenFile()) {
-            if (!LoadFile(editView, fileInfo.path_)) {
-                delete editView;
-                continue;
-            }
+            editView->SetPendingRestore(true);
         } else {
-            const auto &text = fileRecorder.GetText(i);
             int mibEnum = fileRecorder.GetMibEnum(i);
-            // qDebug() << "load plain text: " << text << ", mibEnum: " << mibEnum << ", for tab " << i;
             editView->setFileEncoding(FileEncoding(mibEnum));
-            editView->setPlainText(text);
-            editView->setFileLoaded(true);
+            editView->SetPendingRestore(false, fileRecorder.GetText(i));
+            if (fileInfo.index_ != -1) {
+                editView->AdoptJournal(fileInfo.index_);
+            }
         }
 
         addTab(editView, fileName);
         editView->SetModified(modified);
-        setCurrentIndex(count() - 1);
         setTabToolTip(count() - 1, filePathTip);
     }
+    autoLoading_ = false;
+    autoLoaded_ = true;
+    AutoStore();
 
     // Not switch the current tab, if a file opened before auto load.
+    bool loaded = true;
     if (currentEditView != nullptr) {
         setCurrentWidget(currentEditView);
-        return true;
+    } else {
+        qDebug() << "fileCount: " << fileCount << ", focused index: " << fileRecorder.GetPos();
+        loaded = (fileCount != 0);
+        if (loaded) {
+            setCurrentIndex(fileRecorder.GetPos());
+        }
     }
 
-    qDebug() << "fileCount: " << fileCount << ", focused index: " << fileRecorder.GetPos();
-    bool loaded = (fileCount != 0);
-    if (loaded) {
-        setCurrentIndex(fileRecorder.GetPos());
+    // The focused tab firstly, then the others in background.
+    if (CurrentEditView() != nullptr) {
+        HandleCurrentIndexChanged(currentIndex());
     }
+    QTimer::singleShot(Constants::kTabPrefetchInterval, this, &TabView::PrefetchPendingTab);
     return loaded;
 }
 
+void TabView::PrefetchPendingTab() {
+    // Restore one tab at a time, the nearest to the current tab firstly.
+    EditView *nearestEditView = nullptr;
+    int nearestDistance = count();
+    for (int i = 0; i < count(); ++i) {
+        auto editView = GetEditView(i);
+        if (editView == nullptr) {
+            continue;
+        }
+        // Not to load many files in parallel.
+        if (editView->loading()) {
+            QTimer::singleShot(Constants::kTabPrefetchInterval, this, &TabView::PrefetchPendingTab);
+            return;
+        }
+        int distance = qAbs(i - currentIndex());
+        if (editView->pendingRestore() && distance < nearestDistance) {
+            nearestEditView = editView;
+            nearestDistance = distance;
+        }
+    }
+    if (nearestEditView == nullptr) {
+        qDebug() << "All tabs restored.";
+        return;
+    }
+    nearestEditView->Restore();
+    QTimer::singleShot(Constants::kTabPrefetchInterval, this, &TabView::PrefetchPendingTab);
+}
+
 void TabView::DeleteWidget(int index) {
     QWidget *widget = this->widget(index);
     if (widget == nullptr) {
         qFatal("The widget should not be null");
     }
+    auto largeFileView = qobject_cast<LargeFileView *>(widget);
+    if (largeFileView != nullptr) {
+        openFiles().remove(largeFileView->filePath());
+    }
     removeTab(index);
     delete widget;
 }
@@ -539,6 +638,10 @@ void TabView::DeleteWidget(QWidget *widget) {
     if (widget == nullptr) {
         qFatal("The widget should not be null");
     }
+    auto largeFileView = qobject_cast<LargeFileView *>(widget);
+    if (largeFileView != nullptr) {
+        openFiles().remove(largeFileView->filePath());
+    }
     removeTab(indexOf(widget));
     delete widget;
 }
@@ -576,7 +679,6 @@ void TabView::ViewDiff(DiffView *diffView, const QList<FormattedText> &formatted
     }
 
     if (diffView->AllowHighlightScrollbar()) {
-        diffView->HandleLineOffset();
         // cursor = diffView->textCursor();
         int lastLine = -1;
         std::vector<int> lines;
@@ -696,7 +798,7 @@ void TabView::SwapDiff(int index) {
 #endif
 }
 
-void TabView::OpenFile() { OpenFile(QFileDialog::getOpenFileName(this)); }
+void TabView::OpenFile() { OpenFiles(QFileDialog::getOpenFileNames(this)); }
 
 void TabView::OpenFile(const QString &filePath) {
     if (filePath.isEmpty()) {
@@ -720,6 +822,13 @@ void TabView::OpenFile(const QString &filePath) {
     RecentFiles::UpdateFiles(fileInfo.canonicalFilePath());
     MainWindow::Instance().UpdateRecentFilesMenu();
 
+    if (ShouldUseLargeFileView(fileInfo.canonicalFilePath())) {
+        if (!OpenLargeFile(fileInfo)) {
+            openFiles_.remove(fileInfo.canonicalFilePath());
+        }
+        return;
+    }
+
     auto editView = new EditView(fileInfo, this);
     editView->setNewFileNum(0);  // Set new file number as 0 for open file.
     if (!LoadFile(editView, filePath)) {
@@ -733,6 +842,81 @@ void TabView::OpenFile(const QString &filePath) {
     setTabToolTip(count() - 1, filePath);
 }
 
+void TabView::OpenFiles(const QStringList &filePaths) {
+    // Not open the sub folders recursively.
+    QStringList canonicalFilePaths;
+    for (const auto &filePath : filePaths) {
+        QFileInfo fileInfo(filePath);
+        if (fileInfo.isDir()) {
+            for (const auto &childFileInfo : QDir(filePath).entryInfoList(QDir::Files, QDir::Name)) {
+                canonicalFilePaths.append(childFileInfo.canonicalFilePath());
+            }
+        } else if (fileInfo.isFile()) {
+            canonicalFilePaths.append(fileInfo.canonicalFilePath());
+        }
+    }
+    if (canonicalFilePaths.size() == 1) {
+        OpenFile(canonicalFilePaths.first());
+        return;
+    }
+
+    QStringList decodingFilePaths;
+    for (const auto &filePath : canonicalFilePaths) {
+        // Don't open file multiple times.
+        if (openFiles_.contains(filePath)) {
+            continue;
+        }
+        openFiles_.insert(filePath);
+        RecentFiles::UpdateFiles(filePath);
+        if (ShouldUseLargeFileView(filePath)) {
+            if (!OpenLargeFile(QFileInfo(filePath))) {
+                openFiles_.remove(filePath);
+            }
+            continue;
+        }
+        decodingFilePaths.append(filePath);
+    }
+    MainWindow::Instance().UpdateRecentFilesMenu();
+    if (decodingFilePaths.isEmpty()) {
+        return;
+    }
+
+    if (batchFileOpener_ == nullptr) {
+        batchFileOpener_ = new BatchFileOpener(this);
+        connect(batchFileOpener_, &BatchFileOpener::sigFileDecoded, this, &TabView::HandleFileDecoded);
+        connect(batchFileOpener_, &BatchFileOpener::sigProgressChanged, this, [](int finishedCount, int totalCount) {
+            MainWindow::Instance().statusBar()->showMessage(
+                tr("Opening files... %1/%2").arg(finishedCount).arg(totalCount));
+        });
+        connect(batchFileOpener_, &BatchFileOpener::sigFinished, this,
+                []() { MainWindow::Instance().statusBar()->showMessage(tr("Files opened"), 2000); });
+    }
+    batchFocusPending_ = true;
+    batchFileOpener_->Open(decodingFilePaths);
+}
+
+void TabView::HandleFileDecoded(const BatchFileOpener::Result &result) {
+    if (!result.success_) {
+        openFiles_.remove(result.filePath_);
+        Toast::Instance().Show(
+            Toast::kWarning,
+            tr("Cannot read file %1:\n%2.").arg(QDir::toNativeSeparators(result.filePath_), result.errorString_));
+        return;
+    }
+    QFileInfo fileInfo(result.filePath_);
+    auto editView = new EditView(fileInfo, this);
+    editView->setNewFileNum(0);  // Set new file number as 0 for open file.
+    editView->SetLoadedText(result.text_, FileEncoding(QTextCodec::codecForMib(result.mibEnum_), result.hasBom_),
+                            result.loadedSize_, result.compressed_);
+    addTab(editView, fileInfo.fileName());
+    editView->SetModified(false);
+    setTabToolTip(count() - 1, result.filePath_);
+    if (batchFocusPending_) {
+        batchFocusPending_ = false;
+        setCurrentIndex(count() - 1);
+    }
+}
+
 bool TabView::LoadFile(EditView *editView, const QString &filePath) {
     QFile file(filePath);
     if (!file.open(QFile::ReadOnly | QFile::Text)) {
@@ -754,39 +938,40 @@ bool TabView::LoadFile(EditView *editView, const QString &filePath, FileEncoding
         return false;
     }
 
-    // Check Byte Order Mark.
-    if (forceUseFileEncoding || fileEncoding.hasBom()) {
-        QTextStream in(&file);
-#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-        in.setCodec(fileEncoding.codec());
-        const auto &text = in.readAll();
-        qDebug() << "text: " << text << ", bytearry: " << text.toUtf8();
-#else
-        in.setEncoding(QStringConverter::Utf8);
-        const auto &bytes = in.readAll();
-        const auto &text = fileEncoding.codec()->toUnicode(bytes.toUtf8());
-        qCritical() << "text: " << text;
-#endif
-        editView->setPlainText(text);
-        editView->setFileEncoding(std::move(fileEncoding));
-    } else {
-        // If no BOM.
-        const auto &ansiText = fileEncoding.ProcessAnsi(file);
-        editView->setPlainText(ansiText);
-        editView->setFileEncoding(std::move(fileEncoding));
-    }
-    qDebug() << "encoding: " << editView->fileEncoding().name() << ", file: " << file.fileName();
+    // Read and decode in background, the text is appended to the view as loaded.
+    editView->LoadFile(filePath, std::move(fileEncoding), forceUseFileEncoding);
+    qDebug() << "Start loading, " << editView->fileName();
+    return true;
+}
 
-#ifndef QT_NO_CURSOR
-    QGuiApplication::setOverrideCursor(Qt::WaitCursor);
-#endif
-#ifndef QT_NO_CURSOR
-    QGuiApplication::restoreOverrideCursor();
-#endif
+bool TabView::ShouldUseLargeFileView(const QString &filePath) {
+    auto largeFileSize = Settings().Get("file", "large_file_size", Constants::kMaxParseFileSize).toLongLong();
+    QFile file(filePath);
+    if (file.size() <= largeFileSize) {
+        return false;
+    }
+    if (!file.open(QFile::ReadOnly)) {
+        return false;  // Let LoadFile() report the error.
+    }
+    // The compressed file is decompressed into EditView.
+    if (StreamDecompressor::DetectFormat(file.peek(6)) != StreamDecompressor::kNone) {
+        return false;
+    }
+    // The line index works on single byte '\n', so UTF-16/32 files still go to EditView.
+    return LargeFileView::IsByteNewLineCodec(FileEncoding(file).mibEnum());
+}
 
-    MainWindow::Instance().statusBar()->showMessage(tr("File loaded"), 2000);
-    qDebug() << "File loaded, " << editView->fileName();
-    editView->setFileLoaded(true);
+bool TabView::OpenLargeFile(const QFileInfo &fileInfo) {
+    auto largeFileView = new LargeFileView(fileInfo, this);
+    if (!largeFileView->Load()) {
+        delete largeFileView;
+        return false;
+    }
+    addTab(largeFileView, fileInfo.fileName());
+    setCurrentIndex(count() - 1);
+    setTabToolTip(count() - 1, fileInfo.canonicalFilePath());
+    largeFileView->setFocus();
+    Toast::Instance().Show(Toast::kInfo, tr("Large file opened, editable after the lines indexed."));
     return true;
 }
 
@@ -826,6 +1011,11 @@ void TabView::ApplySpecialCharsVisible(int index) {
 }
 
 void TabView::tabInserted(int index) {
+    if (GetLargeFileView(index) != nullptr) {
+        ChangeTabCloseButtonToolTip(index, tr("Double click to force close."));
+        AutoStore();
+        return;
+    }
     auto editView = qobject_cast<EditView *>(widget(index));
     if (editView == nullptr) {
         return;
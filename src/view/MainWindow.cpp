@@ -15,6 +15,7 @@
  */
 
 #include "MainWindow.h"
+#include "AutoSaveJournal.h"
 #include "ComboView.h"
 #include "ExplorerTreeView.h"
 #include "Logger.h"
@@ -39,6 +40,7 @@ MainWindow::MainWindow() : tabView_(new TabView(this)) {
     toolBarVisible_ = settings.Get("view", "toolbar_visible", true).toBool();
     shouldWrapText_ = settings.Get("view", "wrap_text", true).toBool();
     specialCharsVisible_ = settings.Get("view", "all_chars_visible", false).toBool();
+    miniMapVisible_ = settings.Get("view", "minimap_visible", true).toBool();
     explorerVisible_ = settings.Get("view", "explorer_visible", true).toBool();
     outlineVisible_ = settings.Get("view", "outline_visible", true).toBool();
     hierarchyVisible_ = settings.Get("view", "hierarchy_visible", true).toBool();
@@ -274,6 +276,12 @@ void MainWindow::CreateActions() {
     selectMenu->addAction(replaceAct);
     searchToolBar->addAction(replaceAct);
 
+    QAction *findInFilesAct = new QAction(tr("Find in F&iles..."), this);
+    findInFilesAct->setShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_F));
+    findInFilesAct->setStatusTip(tr("Find in the files of the explorer"));
+    connect(findInFilesAct, &QAction::triggered, this, &MainWindow::FindInFiles);
+    selectMenu->addAction(findInFilesAct);
+
     selectMenu->addSeparator();
 
     const QIcon gotoLineIcon = QIcon::fromTheme("select-got-line", QIcon(":/images/goto-line.svg"));
@@ -404,6 +412,13 @@ void MainWindow::CreateActions() {
     viewMenu->addAction(showAllCharsAct);
     viewToolBar->addAction(showAllCharsAct);
 
+    QAction *showMiniMapAct = new QAction(tr("Show Minimap"), this);
+    showMiniMapAct->setStatusTip(tr("ShowMinimap"));
+    showMiniMapAct->setCheckable(true);
+    showMiniMapAct->setChecked(miniMapVisible_);
+    connect(showMiniMapAct, &QAction::triggered, this, &MainWindow::SwitchMiniMapVisible);
+    viewMenu->addAction(showMiniMapAct);
+
     viewMenu->addSeparator();
 
     QToolBar *viewToolBar2 = addToolBar(tr("View addin"));
@@ -520,6 +535,17 @@ void MainWindow::SetExplorerDockViewPosition(const QString &path) {
     tree->GotoPathPosition(path);
 }
 
+QString MainWindow::ExplorerRootPath() {
+    if (explorerDockView_ == nullptr) {
+        return QString();
+    }
+    auto tree = ((ExplorerTreeView *)explorerDockView_->widget());
+    if (tree == nullptr) {
+        return QString();
+    }
+    return tree->rootPath();
+}
+
 void MainWindow::ShowExplorerDockView() {
     if (explorerDockView_ == nullptr) {
         auto dir = CreateExplorerDockView();
@@ -722,11 +748,14 @@ void MainWindow::dragEnterEvent(QDragEnterEvent *event) {
 void MainWindow::dropEvent(QDropEvent *event) {
     qDebug() << "event: " << event->pos() << ", " << event->mimeData()->text() << ", " << event->mimeData()->urls()
              << ", " << event->mimeData()->html();
-    auto urls = event->mimeData()->urls();
-    if (!urls.isEmpty()) {
-        qDebug() << "file: " << urls[0].toLocalFile();
-        OpenWith(urls[0].toLocalFile());
+    QStringList filePaths;
+    for (const auto &url : event->mimeData()->urls()) {
+        if (url.isLocalFile()) {
+            filePaths.append(url.toLocalFile());
+        }
     }
+    qDebug() << "files: " << filePaths;
+    tabView_->OpenFiles(filePaths);
 }
 
 void MainWindow::showEvent(QShowEvent *event) {
@@ -744,7 +773,14 @@ void MainWindow::showEvent(QShowEvent *event) {
     }
 }
 
-void MainWindow::closeEvent(QCloseEvent *event) { tabView_->AutoStore(); }
+void MainWindow::closeEvent(QCloseEvent *event) {
+    if (!tabView_->LargeFilesMaybeSave()) {
+        event->ignore();
+        return;
+    }
+    tabView_->AutoStore();
+    AutoSaveJournal::Instance().Stop();
+}
 
 bool MainWindow::IsLeftOrRightSeparator(const QPointF &pos) {
     constexpr auto distance_threhold = 3;
@@ -888,6 +924,14 @@ bool MainWindow::FindNext() {
     if (searchingString().isEmpty()) {
         return false;
     }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        return largeFileView->FindNext(searchingString(), GetSearcher()->checkBoxFindMatchCase(), false,
+                                       GetSearcher()->checkBoxFindWrapAround());
+    }
+    if (editView() == nullptr) {
+        return false;
+    }
     auto cursor = searcher_->FindNext(searchingString(), editView()->textCursor());
     if (!cursor.isNull()) {
         editView()->setTextCursor(cursor);
@@ -900,6 +944,14 @@ bool MainWindow::FindPrevious() {
     if (searchingString().isEmpty()) {
         return false;
     }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        return largeFileView->FindNext(searchingString(), GetSearcher()->checkBoxFindMatchCase(), true,
+                                       GetSearcher()->checkBoxFindWrapAround());
+    }
+    if (editView() == nullptr) {
+        return false;
+    }
     auto cursor = searcher_->FindPrevious(searchingString(), editView()->textCursor());
     if (!cursor.isNull()) {
         editView()->setTextCursor(cursor);
@@ -917,6 +969,14 @@ bool MainWindow::Replace() {
     return true;
 }
 
+bool MainWindow::FindInFiles() {
+    if (searchDialog_ == nullptr) {
+        searchDialog_ = new SearchDialog(this);
+    }
+    searchDialog_->Start(2);
+    return true;
+}
+
 bool MainWindow::MarkUnmarkCursorText() {
     auto editView = this->editView();
     if (editView != nullptr) {
@@ -927,6 +987,14 @@ bool MainWindow::MarkUnmarkCursorText() {
         editView->HighlightFocus();
         return true;
     }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        const auto &text = largeFileView->GetCursorText();
+        if (!largeFileView->RemoveMarkText(text)) {
+            largeFileView->AddMarkText(text);
+        }
+        return true;
+    }
     return false;
 }
 
@@ -937,6 +1005,11 @@ bool MainWindow::UnmarkAll() {
         editView->HighlightFocus();
         return true;
     }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        largeFileView->ClearMarkTexts();
+        return true;
+    }
     return false;
 }
 
@@ -993,6 +1066,11 @@ bool MainWindow::ZoomIn() {
         diffView->ZoomIn();
         return true;
     }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        largeFileView->ZoomIn();
+        return true;
+    }
     return false;
 }
 
@@ -1007,6 +1085,11 @@ bool MainWindow::ZoomOut() {
         diffView->ZoomOut();
         return true;
     }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        largeFileView->ZoomOut();
+        return true;
+    }
     return false;
 }
 
@@ -1164,6 +1247,19 @@ void MainWindow::SwitchSpecialCharsVisible() {
     Settings().Set("view", "all_chars_visible", specialCharsVisible_);
 }
 
+void MainWindow::SwitchMiniMapVisible() {
+    miniMapVisible_ = !miniMapVisible_;
+    for (int i = 0; i < tabView()->count(); ++i) {
+        auto editView = tabView()->GetEditView(i);
+        if (editView == nullptr) {
+            continue;
+        }
+        editView->ApplyMiniMapVisible();
+    }
+
+    Settings().Set("view", "minimap_visible", miniMapVisible_);
+}
+
 void MainWindow::SwitchExplorerWindowVisible() {
     explorerVisible_ = !explorerVisible_;
     if (IsExplorerDockViewShowing() != explorerVisible_) {
@@ -1221,6 +1317,11 @@ void MainWindow::Copy() {
     auto diffView = this->diffView();
     if (diffView != nullptr) {
         diffView->copy();
+        return;
+    }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        largeFileView->Copy();
     }
 }
 
@@ -1233,6 +1334,11 @@ void MainWindow::Cut() {
     auto diffView = this->diffView();
     if (diffView != nullptr) {
         diffView->cut();
+        return;
+    }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        largeFileView->Cut();
     }
 }
 
@@ -1245,6 +1351,11 @@ void MainWindow::Paste() {
     auto diffView = this->diffView();
     if (diffView != nullptr) {
         diffView->paste();
+        return;
+    }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        largeFileView->Paste();
     }
 }
 
@@ -1262,6 +1373,11 @@ void MainWindow::Undo() {
     auto diffView = this->diffView();
     if (diffView != nullptr) {
         diffView->undo();
+        return;
+    }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        largeFileView->Undo();
     }
 }
 
@@ -1274,6 +1390,11 @@ void MainWindow::Redo() {
     auto diffView = this->diffView();
     if (diffView != nullptr) {
         diffView->redo();
+        return;
+    }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        largeFileView->Redo();
     }
 }
 
@@ -1382,6 +1503,11 @@ void MainWindow::HandleEncodingChanged(int index) {
         qDebug() << "Non user click, return.";
         return;
     }
+    auto largeFileView = this->largeFileView();
+    if (largeFileView != nullptr) {
+        largeFileView->setFileEncoding(FileEncoding(encoding_->currentText()));
+        return;
+    }
     auto editView = this->editView();
     if (editView == nullptr) {
         return;
@@ -0,0 +1,182 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MarkScanner.h"
+#include "CapabilityManager.h"
+#include "Logger.h"
+#include <QElapsedTimer>
+#include <QTextBlock>
+#include <algorithm>
+
+namespace QEditor {
+MarkScanner::MarkScanner(const QTextDocument *document, QObject *parent) : QObject(parent), document_(document) {}
+
+MarkScanner::~MarkScanner() { Cancel(); }
+
+void MarkScanner::Scan(const QVector<QString> &patterns) {
+    automaton_ = std::make_shared<const AhoCorasick>(patterns);
+    StartScan();
+}
+
+void MarkScanner::StartScan() {
+    Cancel();
+    blockNumbers_.clear();
+    if (automaton_->empty()) {
+        automaton_.reset();
+        emit sigScanned();
+        return;
+    }
+
+    // The block separators are '\n' in the plain text.
+    auto text = document_->toPlainText();
+    blockCount_ = document_->blockCount();
+    scanning_ = true;
+    stale_ = false;
+    const auto scanId = ++scanId_;
+    const auto automaton = automaton_;
+    thread_ = std::thread([this, automaton, text, scanId]() {
+        QElapsedTimer timer;
+        timer.start();
+        auto blockNumbers = std::make_shared<std::vector<std::vector<int>>>(automaton->patternCount());
+        if (!ScanText(*automaton, text, 0, *blockNumbers, canceled_)) {
+            qDebug() << "Scanning marks canceled.";
+            return;
+        }
+        CapabilityManager::Record(CapabilityManager::kScrollbarScan, text.size(), timer.nsecsElapsed());
+        qDebug() << "Marks scanned, patterns: " << automaton->patternCount() << ", chars: " << text.size()
+                 << ", cost: " << timer.elapsed() << "ms";
+        QMetaObject::invokeMethod(
+            this, [this, scanId, blockNumbers]() { HandleScanFinished(scanId, *blockNumbers); },
+            Qt::QueuedConnection);
+    });
+}
+
+void MarkScanner::Cancel() {
+    canceled_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    canceled_ = false;
+    scanning_ = false;
+}
+
+void MarkScanner::HandleScanFinished(int scanId, std::vector<std::vector<int>> &blockNumbers) {
+    if (scanId != scanId_) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    scanning_ = false;
+    if (stale_) {
+        // The snapshot is out of date.
+        StartScan();
+        return;
+    }
+    blockNumbers_ = std::move(blockNumbers);
+    emit sigScanned();
+}
+
+void MarkScanner::HandleContentsChange(int from, int charsAdded) {
+    if (automaton_ == nullptr) {
+        return;
+    }
+    if (scanning_) {
+        stale_ = true;
+        return;
+    }
+
+    // The blocks from 'first' to 'last' replace the changed ones, the same as EditView::UpdateVisualLines().
+    auto first = document_->findBlock(from);
+    auto last = document_->findBlock(from + charsAdded);
+    if (!last.isValid()) {
+        last = document_->lastBlock();
+    }
+    const int newCount = last.blockNumber() - first.blockNumber() + 1;
+    const int oldCount = newCount - (document_->blockCount() - blockCount_);
+    if (!first.isValid() || oldCount <= 0 || first.blockNumber() + oldCount > blockCount_) {
+        StartScan();
+        return;
+    }
+
+    QString text;
+    for (auto block = first; block.isValid(); block = block.next()) {
+        if (block != first) {
+            text += '\n';
+        }
+        text += block.text();
+        if (block == last) {
+            break;
+        }
+    }
+    std::vector<std::vector<int>> newBlockNumbers(automaton_->patternCount());
+    (void)ScanText(*automaton_, text, first.blockNumber(), newBlockNumbers, canceled_);
+
+    // Replace the numbers of the old blocks, and shift the ones after.
+    const int begin = first.blockNumber();
+    const int end = begin + oldCount;
+    const int delta = newCount - oldCount;
+    bool changed = false;
+    for (size_t i = 0; i < blockNumbers_.size(); ++i) {
+        auto &numbers = blockNumbers_[i];
+        const auto &newNumbers = newBlockNumbers[i];
+        auto lower = std::lower_bound(numbers.begin(), numbers.end(), begin);
+        auto upper = std::lower_bound(lower, numbers.end(), end);
+        if (delta == 0 && std::equal(lower, upper, newNumbers.cbegin(), newNumbers.cend())) {
+            continue;
+        }
+        changed = true;
+        std::for_each(upper, numbers.end(), [delta](int &number) { number += delta; });
+        auto index = lower - numbers.begin();
+        numbers.erase(lower, upper);
+        numbers.insert(numbers.begin() + index, newNumbers.cbegin(), newNumbers.cend());
+    }
+    blockCount_ = document_->blockCount();
+    if (changed) {
+        emit sigScanned();
+    }
+}
+
+bool MarkScanner::ScanText(const AhoCorasick &automaton, const QString &text, int blockNumber,
+                           std::vector<std::vector<int>> &blockNumbers, const std::atomic<bool> &canceled) {
+    constexpr int checkCancelInterval = 64 * 1024;
+    // The same as searching one by one, the next match starts after the last one.
+    std::vector<int> lastEnds(automaton.patternCount(), -1);
+    int state = AhoCorasick::kRoot;
+    const auto data = text.constData();
+    const auto size = text.size();
+    for (int i = 0; i < size; ++i) {
+        const auto ch = data[i].unicode();
+        if (ch == '\n') {
+            ++blockNumber;
+            state = AhoCorasick::kRoot;
+            continue;
+        }
+        state = automaton.Next(state, ch);
+        for (auto pattern : automaton.Matches(state)) {
+            if (i - automaton.patternLength(pattern) < lastEnds[pattern]) {
+                continue;
+            }
+            lastEnds[pattern] = i;
+            blockNumbers[pattern].emplace_back(blockNumber);
+        }
+        if (i % checkCancelInterval == 0 && canceled) {
+            return false;
+        }
+    }
+    return true;
+}
+}  // namespace QEditor
@@ -0,0 +1,334 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MiniMap.h"
+#include "Constants.h"
+#include "EditView.h"
+#include "Logger.h"
+#include <QElapsedTimer>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QTextBlock>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <memory>
+
+namespace QEditor {
+namespace {
+constexpr auto kRowsPerBlock = 2;  // At most, the second row is the line spacing.
+constexpr auto kCharsPerPixel = 2;
+constexpr auto kTabWidth = 4;
+constexpr auto kAlpha = 0xb0;
+constexpr QRgb kClassColors[] = {qRgb(170, 170, 165), qRgb(181, 206, 168), qRgb(110, 110, 110), qRgb(106, 153, 85)};
+}  // namespace
+
+MiniMap::MiniMap(EditView *editView) : QWidget(editView), editView_(editView) {
+    setCursor(Qt::PointingHandCursor);
+    connect(editView_->verticalScrollBar(), &QScrollBar::valueChanged, this, [this]() { update(); });
+}
+
+MiniMap::~MiniMap() { Cancel(); }
+
+void MiniMap::HandleContentsChange(int from, int charsAdded) {
+    if (isHidden()) {
+        outdated_ = true;
+        return;
+    }
+    if (summarizing_) {
+        stale_ = true;
+        return;
+    }
+
+    // The blocks from 'first' to 'last' replace the changed ones, the same as EditView::UpdateVisualLines().
+    const auto document = editView_->document();
+    auto first = document->findBlock(from);
+    auto last = document->findBlock(from + charsAdded);
+    if (!last.isValid()) {
+        last = document->lastBlock();
+    }
+    const int blockCount = static_cast<int>(summaries_.size());
+    const int newCount = last.blockNumber() - first.blockNumber() + 1;
+    const int oldCount = newCount - (document->blockCount() - blockCount);
+    if (!first.isValid() || oldCount <= 0 || first.blockNumber() + oldCount > blockCount ||
+        newCount > Constants::kMaxMiniMapInlineBlocks) {
+        StartSummarize();
+        return;
+    }
+
+    std::vector<Summary> summaries;
+    summaries.reserve(newCount);
+    for (auto block = first; block.isValid(); block = block.next()) {
+        const auto text = block.text();
+        summaries.emplace_back(SummarizeBlock(text.constData(), text.size()));
+        if (block == last) {
+            break;
+        }
+    }
+    const auto begin = summaries_.begin() + first.blockNumber();
+    if (oldCount == newCount && !imageInvalid_) {
+        // Draw the strip of the changed blocks only.
+        std::copy(summaries.cbegin(), summaries.cend(), begin);
+        const auto firstRow = RowOfBlock(first.blockNumber());
+        const auto lastRow = std::max(RowOfBlock(last.blockNumber() + 1) - 1, RowOfBlock(last.blockNumber()));
+        DrawRows(firstRow, lastRow);
+        update(0, firstRow, width(), lastRow - firstRow + 1);
+        return;
+    }
+    // The blocks after are moved to other rows.
+    summaries_.erase(begin, begin + oldCount);
+    summaries_.insert(summaries_.begin() + first.blockNumber(), summaries.cbegin(), summaries.cend());
+    imageInvalid_ = true;
+    update();
+}
+
+void MiniMap::paintEvent(QPaintEvent *event) {
+    // Rebuild once for the changes before painted, such as the chunks appended when loading.
+    if (imageInvalid_) {
+        RebuildImage();
+    }
+    QPainter painter(this);
+    painter.fillRect(event->rect(), QColor(28, 28, 28));
+    painter.drawImage(event->rect().topLeft(), image_, event->rect());
+
+    // The visible blocks.
+    const auto firstBlock = editView_->firstVisibleBlock().blockNumber();
+    const auto lastBlock = editView_->cursorForPosition(QPoint(0, editView_->viewport()->height() - 1)).blockNumber();
+    const auto top = std::min(RowOfBlock(firstBlock), image_.height());
+    const auto bottom = std::min(RowOfBlock(lastBlock + 1), image_.height());
+    painter.fillRect(QRect(0, top, width(), std::max(bottom - top, 1)), QColor(255, 255, 255, 24));
+}
+
+void MiniMap::resizeEvent(QResizeEvent *event) {
+    QWidget::resizeEvent(event);
+    imageInvalid_ = true;
+}
+
+void MiniMap::showEvent(QShowEvent *event) {
+    QWidget::showEvent(event);
+    if (outdated_) {
+        StartSummarize();
+    }
+}
+
+void MiniMap::mousePressEvent(QMouseEvent *event) {
+    if (event->button() == Qt::LeftButton) {
+        ScrollTo(event->pos().y());
+    }
+}
+
+void MiniMap::mouseMoveEvent(QMouseEvent *event) {
+    if (event->buttons() & Qt::LeftButton) {
+        ScrollTo(event->pos().y());
+    }
+}
+
+MiniMap::Summary MiniMap::SummarizeBlock(const QChar *data, int size) {
+    Summary summary;
+    int column = 0;
+    int i = 0;
+    for (; i < size && (data[i] == ' ' || data[i] == '\t'); ++i) {
+        column += (data[i] == '\t' ? kTabWidth : 1);
+    }
+    summary.indent = std::min(column, 0xffff);
+    const bool comment = (i < size && data[i] == '#') || (i + 1 < size && data[i] == '/' && data[i + 1] == '/');
+    int counts[kClassCount]{};
+    int length = column;
+    for (; i < size; ++i) {
+        const auto ch = data[i];
+        column += (ch == '\t' ? kTabWidth : 1);
+        if (ch.isSpace()) {
+            continue;
+        }
+        length = column;
+        if (comment) {
+            ++counts[kComment];
+        } else if (ch.isLetter() || ch == '_') {
+            ++counts[kWord];
+        } else if (ch.isDigit()) {
+            ++counts[kNumber];
+        } else {
+            ++counts[kSymbol];
+        }
+    }
+    summary.length = std::min(length, 0xffff);
+    for (int c = 0; c < kClassCount; ++c) {
+        summary.counts[c] = std::min(counts[c], 0xffff);
+    }
+    return summary;
+}
+
+bool MiniMap::SummarizeText(const QString &text, std::vector<Summary> &summaries, const std::atomic<bool> &canceled) {
+    constexpr int checkCancelInterval = 1024;
+    const auto data = text.constData();
+    const auto size = text.size();
+    int start = 0;
+    while (true) {
+        auto end = text.indexOf('\n', start);
+        if (end == -1) {
+            end = size;
+        }
+        summaries.emplace_back(SummarizeBlock(data + start, end - start));
+        if (end == size) {
+            return true;
+        }
+        start = end + 1;
+        if (summaries.size() % checkCancelInterval == 0 && canceled) {
+            return false;
+        }
+    }
+}
+
+void MiniMap::StartSummarize() {
+    Cancel();
+    // Not to copy the text for each change while hidden.
+    if (isHidden()) {
+        outdated_ = true;
+        return;
+    }
+    outdated_ = false;
+    // The block separators are '\n' in the plain text.
+    auto text = editView_->document()->toPlainText();
+    summarizing_ = true;
+    stale_ = false;
+    const auto summarizeId = ++summarizeId_;
+    thread_ = std::thread([this, text, summarizeId]() {
+        QElapsedTimer timer;
+        timer.start();
+        auto summaries = std::make_shared<std::vector<Summary>>();
+        if (!SummarizeText(text, *summaries, canceled_)) {
+            qDebug() << "Summarizing blocks canceled.";
+            return;
+        }
+        qDebug() << "Blocks summarized, blocks: " << summaries->size() << ", cost: " << timer.elapsed() << "ms";
+        QMetaObject::invokeMethod(
+            this, [this, summarizeId, summaries]() { HandleSummarized(summarizeId, *summaries); },
+            Qt::QueuedConnection);
+    });
+}
+
+void MiniMap::Cancel() {
+    canceled_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    canceled_ = false;
+    summarizing_ = false;
+}
+
+void MiniMap::HandleSummarized(int summarizeId, std::vector<Summary> &summaries) {
+    if (summarizeId != summarizeId_) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    summarizing_ = false;
+    if (stale_) {
+        // The snapshot is out of date.
+        StartSummarize();
+        return;
+    }
+    summaries_ = std::move(summaries);
+    imageInvalid_ = true;
+    update();
+}
+
+qreal MiniMap::BlocksPerRow() const {
+    const auto blockCount = static_cast<qreal>(summaries_.size());
+    return std::max(blockCount / std::max(height(), 1), 1.0 / kRowsPerBlock);
+}
+
+int MiniMap::RowOfBlock(int blockNumber) const { return static_cast<int>(blockNumber / BlocksPerRow()); }
+
+int MiniMap::BlockOfRow(int row) const {
+    const int blockCount = static_cast<int>(summaries_.size());
+    return std::min(static_cast<int>(row * BlocksPerRow()), blockCount - 1);
+}
+
+void MiniMap::RebuildImage() {
+    const auto rowCount = std::min(height(), static_cast<int>(std::ceil(summaries_.size() / BlocksPerRow())));
+    if (width() <= 0 || rowCount <= 0) {
+        image_ = QImage();
+        imageInvalid_ = false;
+        return;
+    }
+    image_ = QImage(width(), rowCount, QImage::Format_ARGB32_Premultiplied);
+    DrawRows(0, rowCount - 1);
+    imageInvalid_ = false;
+}
+
+void MiniMap::DrawRows(int firstRow, int lastRow) {
+    firstRow = std::max(firstRow, 0);
+    lastRow = std::min(lastRow, image_.height() - 1);
+    const auto width = image_.width();
+    for (int row = firstRow; row <= lastRow; ++row) {
+        auto line = reinterpret_cast<QRgb *>(image_.scanLine(row));
+        std::fill(line, line + width, 0);
+        // The rows after the first of a block are the line spacing.
+        const auto begin = BlockOfRow(row);
+        if (RowOfBlock(begin) != row) {
+            continue;
+        }
+        const auto end = std::max(static_cast<int>((row + 1) * BlocksPerRow()), begin + 1);
+
+        // Merge the blocks of the row, the empty ones not counted.
+        int indent = INT_MAX;
+        int length = 0;
+        qint64 counts[kClassCount]{};
+        qint64 total = 0;
+        for (int i = begin; i < end && i < static_cast<int>(summaries_.size()); ++i) {
+            const auto &summary = summaries_[i];
+            if (summary.length == 0) {
+                continue;
+            }
+            indent = std::min(indent, static_cast<int>(summary.indent));
+            length = std::max(length, static_cast<int>(summary.length));
+            for (int c = 0; c < kClassCount; ++c) {
+                counts[c] += summary.counts[c];
+                total += summary.counts[c];
+            }
+        }
+        if (total == 0) {
+            continue;
+        }
+
+        // Blend the colors of the classes by the chars of each.
+        qint64 red = 0;
+        qint64 green = 0;
+        qint64 blue = 0;
+        for (int c = 0; c < kClassCount; ++c) {
+            red += qRed(kClassColors[c]) * counts[c];
+            green += qGreen(kClassColors[c]) * counts[c];
+            blue += qBlue(kClassColors[c]) * counts[c];
+        }
+        const auto color = qPremultiply(qRgba(red / total, green / total, blue / total, kAlpha));
+        const auto left = std::min(indent / kCharsPerPixel, width);
+        const auto right = std::min(std::max((length + kCharsPerPixel - 1) / kCharsPerPixel, left + 1), width);
+        std::fill(line + left, line + right, color);
+    }
+}
+
+void MiniMap::ScrollTo(int y) {
+    if (image_.isNull()) {
+        return;
+    }
+    // Center the block of the row.
+    const auto blockNumber = BlockOfRow(qBound(0, y, image_.height() - 1));
+    auto scrollBar = editView_->verticalScrollBar();
+    scrollBar->setValue(editView_->LineNumberOfBlock(blockNumber) - scrollBar->pageStep() / 2);
+}
+}  // namespace QEditor
@@ -15,13 +15,21 @@
  */
 
 #include "SearchDialog.h"
+#include "Constants.h"
 #include "Logger.h"
 #include "MainWindow.h"
 #include "SearchTargets.h"
 #include "Settings.h"
 #include "ui_SearchDialog.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QScrollBar>
+#include <QSet>
 #include <QTextBlock>
+#include <QThread>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 
 #ifdef Q_OS_WIN
 namespace WinTheme {
@@ -158,39 +166,41 @@ SearchDialog::SearchDialog(QWidget *parent, int index)
     };
     if (index == 0) {  // Find
         ui_->lineEditFindFindWhat->setFocus();
-    } else {  // Replace
+    } else if (index == 1) {  // Replace
         ui_->lineEditReplaceFindWhat->setFocus();
+    } else {  // Find in files
+        ui_->lineEditFilesFindWhat->setFocus();
     }
 
     // QCoreApplication::postEvent(this, event);
     ui_->lineEditFindFindWhat->installEventFilter(new LambdaEventFilter(ui_->lineEditFindFindWhat, historyLambda));
     ui_->lineEditReplaceFindWhat->installEventFilter(
         new LambdaEventFilter(ui_->lineEditReplaceFindWhat, historyLambda));
+    ui_->lineEditFilesFindWhat->installEventFilter(new LambdaEventFilter(ui_->lineEditFilesFindWhat, historyLambda));
 
     ui_->checkBoxFindWrapAround->setChecked(true);
 
     connect(ui_->lineEditFindFindWhat, &QLineEdit::textChanged, this, [this](const QString &text) {
-        if (!editView()->AllowHighlightScrollbar()) {
-            return;
+        if (editView() != nullptr) {
+            editView()->ScanSearchText(text);
         }
-        const auto &lineNums = MainWindow::Instance().GetSearcher()->FindAllLineNum(text);
-        auto &scrollbarInfos = editView()->scrollbarLineInfos()[ScrollBarHighlightCategory::kCategorySearch];
-        scrollbarInfos.clear();
-        scrollbarInfos.emplace_back(std::make_pair(lineNums, QColor(0xff00c000)));
-        editView()->setHightlightScrollbarInvalid(true);
     });
     ui_->lineEditFindFindWhat->setText(GetSelectedText());
     connect(ui_->lineEditReplaceFindWhat, &QLineEdit::textChanged, this, [this](const QString &text) {
-        if (!editView()->AllowHighlightScrollbar()) {
-            return;
+        if (editView() != nullptr) {
+            editView()->ScanSearchText(text);
         }
-        const auto &lineNums = MainWindow::Instance().GetSearcher()->FindAllLineNum(text);
-        auto &scrollbarInfos = editView()->scrollbarLineInfos()[ScrollBarHighlightCategory::kCategorySearch];
-        scrollbarInfos.clear();
-        scrollbarInfos.emplace_back(std::make_pair(lineNums, QColor(0xff00c000)));
-        editView()->setHightlightScrollbarInvalid(true);
     });
     ui_->lineEditReplaceFindWhat->setText(GetSelectedText());
+
+    auto searcher = MainWindow::Instance().GetSearcher();
+    connect(searcher, &Searcher::sigFound, this, &SearchDialog::HandleFound);
+    connect(searcher, &Searcher::sigFindAllFinished, this, &SearchDialog::HandleFindAllFinished);
+
+    fileSearcher_ = new FileSearcher(this);
+    connect(fileSearcher_, &FileSearcher::sigFound, this, &SearchDialog::HandleFilesFound);
+    connect(fileSearcher_, &FileSearcher::sigProgressChanged, this, &SearchDialog::HandleFilesProgressChanged);
+    connect(fileSearcher_, &FileSearcher::sigFinished, this, &SearchDialog::HandleFilesFinished);
 }
 
 SearchDialog::~SearchDialog() { delete ui_; }
@@ -214,9 +224,12 @@ void SearchDialog::Start(int index) {
     if (index == 0) {  // Find.
         ui_->lineEditFindFindWhat->setText(GetSelectedText());
         ui_->lineEditFindFindWhat->setFocus();
-    } else {  // Replace.
+    } else if (index == 1) {  // Replace.
         ui_->lineEditReplaceFindWhat->setText(GetSelectedText());
         ui_->lineEditReplaceFindWhat->setFocus();
+    } else {  // Find in files.
+        ui_->lineEditFilesFindWhat->setText(GetSelectedText());
+        ui_->lineEditFilesFindWhat->setFocus();
     }
     setCurrentTabIndex(index);
     show();
@@ -257,24 +270,24 @@ void SearchDialog::setCurrentTabIndex(int index) { ui_->tabWidget->setCurrentInd
 void SearchDialog::closeEvent(QCloseEvent *) {
     historyIndex_ = -1;
     searchInput_.clear();
-    if (editView()->AllowHighlightScrollbar()) {
-        auto &scrollbarInfos = editView()->scrollbarLineInfos()[ScrollBarHighlightCategory::kCategorySearch];
-        scrollbarInfos.clear();
-        editView()->setHightlightScrollbarInvalid(true);
+    if (editView() != nullptr) {
+        editView()->ScanSearchText(QString());
     }
 }
 
 void SearchDialog::hideEvent(QHideEvent *) {
     historyIndex_ = -1;
     searchInput_.clear();
-    if (editView()->AllowHighlightScrollbar()) {
-        auto &scrollbarInfos = editView()->scrollbarLineInfos()[ScrollBarHighlightCategory::kCategorySearch];
-        scrollbarInfos.clear();
-        editView()->setHightlightScrollbarInvalid(true);
+    if (editView() != nullptr) {
+        editView()->ScanSearchText(QString());
     }
 }
 
 const QString SearchDialog::GetSelectedText() {
+    auto largeFileView = MainWindow::Instance().largeFileView();
+    if (largeFileView != nullptr) {
+        return largeFileView->GetCursorText();
+    }
     if (editView() == nullptr) {
         return "";
     }
@@ -288,7 +301,8 @@ const QString SearchDialog::GetSelectedText() {
 }
 
 void SearchDialog::on_pushButtonFindFindNext_clicked() {
-    if (editView() == nullptr) {
+    auto largeFileView = MainWindow::Instance().largeFileView();
+    if (editView() == nullptr && largeFileView == nullptr) {
         return;
     }
     auto const &target = ui_->lineEditFindFindWhat->text();
@@ -298,6 +312,14 @@ void SearchDialog::on_pushButtonFindFindNext_clicked() {
     MainWindow::Instance().setSearchingString(target);
     SearchTargets::UpdateTargets(target);
 
+    if (largeFileView != nullptr) {
+        // Only plain text search for large file view.
+        (void)largeFileView->FindNext(target, ui_->checkBoxFindMatchCase->isChecked(),
+                                      ui_->checkBoxFindBackward->isChecked(),
+                                      ui_->checkBoxFindWrapAround->isChecked());
+        return;
+    }
+
     auto cursor = searcher_->FindNext(target, editView()->textCursor());
     if (!cursor.isNull()) {
         editView()->setTextCursor(cursor);
@@ -306,6 +328,7 @@ void SearchDialog::on_pushButtonFindFindNext_clicked() {
 
 void SearchDialog::on_pushButtonFindFindAllInCurrent_clicked() {
     if (editView() == nullptr) {
+        ShowLargeFileUnsupported();
         return;
     }
     if (searchResultList_ == nullptr) {
@@ -313,7 +336,7 @@ void SearchDialog::on_pushButtonFindFindAllInCurrent_clicked() {
     }
     MainWindow::Instance().ShowSearchDockView();
 
-    auto sessionItem = searchResultList_->StartSearchSession(editView());
+    auto sessionId = searchResultList_->StartSearchSession(editView());
     qDebug() << "Find all start....";
     auto const &target = ui_->lineEditFindFindWhat->text();
     InitSetting();
@@ -322,67 +345,14 @@ void SearchDialog::on_pushButtonFindFindAllInCurrent_clicked() {
     MainWindow::Instance().setSearchingString(target);
     SearchTargets::UpdateTargets(target);
 
-    QProgressDialog progressDialog(this);
-    progressDialog.setMinimumWidth(540);
-    progressDialog.setCancelButtonText(tr("&Cancel"));
-
-    constexpr auto findProgressValue = 60;
-    constexpr auto addListProgressValue = 35;
-    constexpr auto finishProgressValue = 5;
-    constexpr auto maxProgressValue = findProgressValue + addListProgressValue + finishProgressValue;
-    progressDialog.setWindowTitle(tr("Finding all positions..."));
-    progressDialog.setRange(0, maxProgressValue);
-    std::vector<QTextCursor> findResult = searcher_->FindAll(target, [&progressDialog](int progress) {
-        if (progressDialog.wasCanceled()) {
-            return false;
-        }
-        progressDialog.setValue(findProgressValue * progress / maxProgressValue);
-        QCoreApplication::processEvents();
-        return true;
-    });
-    qDebug() << "Find all finish....";
-
-    // TODO:
-    // To support display dynamic visible list items, and do fetchMore for user scrolling.
-    progressDialog.setWindowTitle(tr("Preparing result list..."));
-    for (size_t i = 0; i < findResult.size(); ++i) {
-        if (progressDialog.wasCanceled()) {
-            searchResultList_->FinishSearchSession(sessionItem, target, i, false);
-            return;
-        }
-        const auto &item = findResult[i];
-        qDebug() << "Display item start....";
-        const auto currentBlock = item.block();
-        int lineNum = item.blockNumber();
-        const auto highlightingTarget = item.selectedText().toHtmlEscaped();
-        const auto htmlTarget = QString("<span style=\"font-size:14px;font-family:Consolas;color:#BCE08C\">") +
-                                highlightingTarget + QString("</span>");
-        const auto plainText = currentBlock.text();
-        auto escapedStr = plainText.toHtmlEscaped();
-        escapedStr.replace(highlightingTarget, htmlTarget, Qt::CaseSensitive);
-        qDebug() << "Line " << lineNum << ": highlightingTarget: " << highlightingTarget
-                 << ", htmlTarget: " << htmlTarget << ", currentStr: " << escapedStr;
-
-        auto htmlText = QString("<div style=\"font-size:14px;font-family:Consolas;color:#BEBEBE\">") + tr("Line ") +
-                        QString("<span style=\"font-size:14px;font-family:Consolas;color:#2891AF\">") +
-                        QString::number(lineNum + 1) + QString("</span>") + ":  " + escapedStr + QString("</div>");
-        qDebug() << "Line " << lineNum << ": text: " << htmlText;
-        searchResultList_->AddSearchResult(sessionItem, lineNum, htmlText, plainText, item);
-        progressDialog.setValue(findProgressValue + addListProgressValue * (i + 1) / findResult.size());
-        QCoreApplication::processEvents();
-        qDebug() << "Display item end....";
-    }
-    progressDialog.setWindowTitle(tr("Showing results in list..."));
-    searchResultList_->FinishSearchSession(sessionItem, target, findResult.size());
-    progressDialog.setValue(maxProgressValue);
-    QCoreApplication::processEvents();
+    StartFindAll(target, sessionId);
 }
 
 void SearchDialog::on_pushButtonFindCount_clicked() {
     if (editView() == nullptr) {
+        ShowLargeFileUnsupported();
         return;
     }
-    std::vector<QTextCursor> res;
     auto const &target = ui_->lineEditFindFindWhat->text();
     InitSetting();
 
@@ -390,12 +360,163 @@ void SearchDialog::on_pushButtonFindCount_clicked() {
     MainWindow::Instance().setSearchingString(target);
     SearchTargets::UpdateTargets(target);
 
-    res = searcher_->FindAll(target);
-    auto info = QString("<b><font color=#67A9FF size=4>") + QString::number(res.size()) + tr(" matches in ") +
-                editView()->fileName() + "</font></b>";
+    StartFindAll(target, 0);
+}
+
+void SearchDialog::ShowLargeFileUnsupported() {
+    // The matches are found in a QTextDocument, not in the mapped bytes of a large file.
+    if (MainWindow::Instance().largeFileView() != nullptr) {
+        ui_->labelInfo->setText(QString("<b><font color=#FF6767 size=4>") +
+                                tr("Count and Find All are not supported in large file, use Find Next.") +
+                                "</font></b>");
+    }
+}
+
+void SearchDialog::StartFindAll(const QString &target, int sessionId) {
+    // Finish the last one first.
+    searcher_->CancelFindAll();
+
+    findAllView_ = editView();
+    findAllSession_ = sessionId;
+    findAllTarget_ = target;
+    findAllRevision_ = editView()->document()->revision();
+    findAllCount_ = 0;
+
+    // Modal, not to change the text while finding.
+    findAllProgress_ = new QProgressDialog(this);
+    findAllProgress_->setAttribute(Qt::WA_DeleteOnClose);
+    findAllProgress_->setWindowModality(Qt::WindowModal);
+    findAllProgress_->setMinimumWidth(540);
+    findAllProgress_->setCancelButtonText(tr("&Cancel"));
+    findAllProgress_->setWindowTitle(tr("Finding all positions..."));
+    findAllProgress_->setRange(0, 100);
+    connect(findAllProgress_, &QProgressDialog::canceled, searcher_, &Searcher::CancelFindAll);
+
+    searcher_->StartFindAll(target);
+}
+
+void SearchDialog::HandleFound(const TextMatches &matches, int progress) {
+    if (findAllView_ == nullptr || findAllView_->document()->revision() != findAllRevision_) {
+        qDebug() << "The text is closed or changed, stop finding.";
+        searcher_->CancelFindAll();
+        return;
+    }
+    if (findAllProgress_ != nullptr) {
+        findAllProgress_->setValue(progress);
+    }
+    findAllCount_ += static_cast<int>(matches.size());
+    if (findAllSession_ != 0) {
+        searchResultList_->AddSearchResults(findAllSession_, matches);
+    }
+}
+
+void SearchDialog::HandleFindAllFinished(bool canceled) {
+    qDebug() << "Find all finish...., canceled: " << canceled;
+    if (findAllProgress_ != nullptr) {
+        // Not to cancel again by closing.
+        findAllProgress_->disconnect(searcher_);
+        findAllProgress_->close();
+        findAllProgress_ = nullptr;
+    }
+    if (findAllView_ == nullptr) {
+        return;
+    }
+    if (findAllSession_ != 0) {
+        searchResultList_->FinishSearchSession(findAllSession_, findAllTarget_, findAllCount_, !canceled);
+        findAllSession_ = 0;
+        return;
+    }
+    if (!canceled) {
+        auto info = QString("<b><font color=#67A9FF size=4>") + QString::number(findAllCount_) + tr(" matches in ") +
+                    findAllView_->fileName() + "</font></b>";
+        ui_->labelInfo->setText(info);
+    }
+}
+
+void SearchDialog::on_pushButtonFilesFindAll_clicked() {
+    auto const &target = ui_->lineEditFilesFindWhat->text();
+    if (target.isEmpty()) {
+        return;
+    }
+    // The explorer's root, or the directory of the current file.
+    auto rootPath = MainWindow::Instance().ExplorerRootPath();
+    if (rootPath.isEmpty() && editView() != nullptr && !editView()->filePath().isEmpty()) {
+        rootPath = QFileInfo(editView()->filePath()).absolutePath();
+    }
+    if (rootPath.isEmpty()) {
+        ui_->labelInfo->setText(QString("<b><font color=#FFA0A0 size=4>") +
+                                tr("Select a directory in the explorer to find in.") + "</font></b>");
+        return;
+    }
+    InitSetting();
+
+    // Record search string history.
+    MainWindow::Instance().setSearchingString(target);
+    SearchTargets::UpdateTargets(target);
+
+    if (searchResultList_ == nullptr) {
+        searchResultList_ = MainWindow::Instance().GetSearchResultList();
+    }
+    MainWindow::Instance().ShowSearchDockView();
+
+    // Finish the last one first.
+    fileSearcher_->Cancel();
+    filesSession_ = searchResultList_->StartFilesSearchSession(rootPath);
+    filesRootPath_ = rootPath;
+    filesTarget_ = target;
+    filesHitCount_ = 0;
+    filesFileCount_ = 0;
+    filesTimer_.start();
+
+    FileSearcher::Filter filter;
+    const auto &globs = ui_->lineEditFilesFilters->text().split(QRegularExpression("[\\s,;]+"));
+    for (const auto &glob : globs) {
+        if (!glob.isEmpty()) {
+            filter.globs_.append(glob);
+        }
+    }
+    filter.maxFileSize_ = static_cast<qint64>(ui_->spinBoxFilesMaxSize->value()) * 1024 * 1024;
+    fileSearcher_->Start(rootPath, filter, searcher_->MakeFindFunction(target));
+}
+
+void SearchDialog::on_pushButtonFilesCancel_clicked() {
+    if (fileSearcher_->searching()) {
+        fileSearcher_->Cancel();
+        return;
+    }
+    close();
+}
+
+void SearchDialog::HandleFilesFound(const std::vector<FileSearcher::FileMatches> &batch) {
+    if (filesSession_ == 0) {
+        return;
+    }
+    searchResultList_->AddFileSearchResults(filesSession_, batch);
+    for (const auto &fileMatches : batch) {
+        filesHitCount_ += static_cast<int>(fileMatches.hits_.size());
+    }
+    filesFileCount_ += static_cast<int>(batch.size());
+}
+
+void SearchDialog::HandleFilesProgressChanged(int scannedCount, int skippedCount) {
+    const auto filesPerSecond = scannedCount * 1000LL / std::max<qint64>(filesTimer_.elapsed(), 1);
+    auto info = QString("<b><font color=#67A9FF size=4>") + tr("Scanned ") + QString::number(scannedCount) +
+                tr(" files (") + QString::number(filesPerSecond) + tr(" files/s), skipped ") +
+                QString::number(skippedCount) + tr(", found ") + QString::number(filesHitCount_) + tr(" hits in ") +
+                QString::number(filesFileCount_) + tr(" files") + "</font></b>";
     ui_->labelInfo->setText(info);
 }
 
+void SearchDialog::HandleFilesFinished(bool canceled) {
+    qDebug() << "Find in files finish...., canceled: " << canceled << ", cost: " << filesTimer_.elapsed() << "ms";
+    if (filesSession_ == 0) {
+        return;
+    }
+    searchResultList_->FinishFilesSearchSession(filesSession_, filesRootPath_, filesTarget_, filesHitCount_,
+                                                filesFileCount_, !canceled);
+    filesSession_ = 0;
+}
+
 void SearchDialog::on_pushButtonFindCancel_clicked() { close(); }
 
 void SearchDialog::on_pushButtonReplaceCancel_clicked() { close(); }
@@ -418,6 +539,9 @@ void SearchDialog::on_pushButtonReplaceFindNext_clicked() {
 }
 
 void SearchDialog::on_pushButtonReplaceReplace_clicked() {
+    if (editView() == nullptr) {
+        return;
+    }
     auto const &target = ui_->lineEditReplaceFindWhat->text();
     auto const &text = ui_->lineEditReplaceReplaceWith->text();
     InitSetting();
@@ -734,7 +858,7 @@ QTextCursor Searcher::_FindNext(const QString &text, const QTextCursor &startCur
     bool res;
     QTextCursor cursor;
     if (radioButtonFindRe_) {
-        const QRegularExpression reTarget = QRegularExpression(text);
+        const auto &reTarget = CachedRegularExpression(text);
         res = _Find<QRegularExpression>(reTarget, startCursor, cursor, backward);
     } else {
         if (radioButtonFindExtended_) {
@@ -758,78 +882,387 @@ QTextCursor Searcher::_FindNext(const QString &text, const QTextCursor &startCur
     }
 }
 
-std::vector<QTextCursor> Searcher::FindAll(const QString &target, std::function<bool(int)> progressCallback) {
-    std::vector<QTextCursor> cursors;
-    if (editView() == nullptr) {
-        return cursors;
+const QRegularExpression &Searcher::CachedRegularExpression(const QString &pattern) {
+    if (regularExpression_.pattern() != pattern ||
+        regularExpression_.patternOptions() != QRegularExpression::MultilineOption) {
+        regularExpression_ = QRegularExpression(pattern, QRegularExpression::MultilineOption);
+        // Compile by JIT once.
+        regularExpression_.optimize();
     }
-    setCheckBoxFindBackward(false);
-    setCheckBoxFindWrapAround(false);
-    QTextCursor savedCursor = editView()->textCursor();
-    QTextCursor cursor = editView()->textCursor();
-    cursor.movePosition(QTextCursor::Start, QTextCursor::MoveAnchor);
-    int firstStart = -1;
-    while (true) {
-        cursor = _FindNext(target, cursor, false);
-        if (!cursor.isNull()) {
-            if (cursor.selectionStart() == firstStart) {
-                break;
-            }
-            if (firstStart == -1) {
-                firstStart = cursor.selectionStart();
-            }
-            if (progressCallback) {
-                constexpr long long maxProgressValue = 100;
-                int progress = maxProgressValue * cursor.position() / editView()->document()->characterCount();
-                auto success = progressCallback(progress);
-                qDebug() << "progress: " << progress << ", pos: " << cursor.position()
-                         << ", count: " << editView()->document()->characterCount();
-                if (!success) {
-                    break;
+    return regularExpression_;
+}
+
+Searcher::~Searcher() {
+    canceled_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+TextFindFunction Searcher::MakeFindFunction(const QString &target) {
+    if (radioButtonFindRe_) {
+        // The ranges start and end at lines, '^' and '$' match in each line as QTextDocument::find().
+        // Matched in the text up to 'to' from the offset, not a copy of the range.
+        const auto re = CachedRegularExpression(target);
+        return [re](const QString &text, int from, int to, TextMatches &matches) {
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
+            auto iter = re.globalMatch(text.leftRef(to), from);
+#else
+            auto iter = re.globalMatch(QStringView(text).left(to), from);
+#endif
+            while (iter.hasNext()) {
+                const auto match = iter.next();
+                if (match.capturedLength() > 0) {
+                    matches.emplace_back(match.capturedStart(), match.capturedLength());
                 }
             }
-            cursors.emplace_back(cursor);
+            return to;
+        };
+    }
+    auto pattern = target;
+    if (radioButtonFindExtended_) {
+        HandleEscapeChars(pattern);
+    }
+    const auto search = std::make_shared<const TextSearch>(pattern, checkBoxFindMatchCase_, checkBoxFindWholeWord_);
+    return [search](const QString &text, int from, int to, TextMatches &matches) {
+        return search->FindAll(text.constData(), text.size(), from, to, matches);
+    };
+}
+
+void Searcher::StartFindAll(const QString &target) {
+    CancelFindAll();
+    if (editView() == nullptr) {
+        return;
+    }
+
+    // The block separators are '\n' in the plain text.
+    auto text = editView()->document()->toPlainText();
+    const auto find = MakeFindFunction(target);
+    // A regular expression in lines matches the chunks ending at line ends by all cores.
+    const bool wholeText = radioButtonFindRe_ && !IsLineLocal(target);
+    const bool parallel = radioButtonFindRe_ && !wholeText;
+    findingAll_ = true;
+    const auto findId = ++findId_;
+    thread_ = std::thread([this, text, find, findId, wholeText, parallel]() {
+        QElapsedTimer timer;
+        timer.start();
+        bool finished;
+        if (parallel) {
+            finished = FindInParallel(text, find, findId);
         } else {
+            // A match may go over the chunk end, so find the next chunk after it.
+            finished = FindInSequence(text, find, wholeText ? text.size() : Constants::kSearchChunkSize, findId);
+        }
+        if (!finished) {
+            qDebug() << "Finding all canceled.";
+            return;
+        }
+        qDebug() << "Found all, parallel: " << parallel << ", chars: " << text.size() << ", cost: " << timer.elapsed()
+                 << "ms";
+        QMetaObject::invokeMethod(
+            this, [this, findId]() { HandleFindAllFinished(findId); }, Qt::QueuedConnection);
+    });
+}
+
+bool Searcher::FindInSequence(const QString &text, const FindFunction &find, int chunkSize, int findId) {
+    const int size = text.size();
+    int from = 0;
+    do {
+        int to = -1;
+        if (size - from > chunkSize) {
+            to = text.indexOf('\n', from + chunkSize);
+        }
+        to = (to == -1 ? size : to + 1);
+        auto matches = std::make_shared<TextMatches>();
+        from = find(text, from, to, *matches);
+        if (canceled_) {
+            return false;
+        }
+        PostFound(findId, matches, (size == 0 ? 100 : static_cast<int>(100LL * std::min(from, size) / size)));
+    } while (from < size);
+    return true;
+}
+
+bool Searcher::FindInParallel(const QString &text, const FindFunction &find, int findId) {
+    // The chunks end at line ends.
+    const int size = text.size();
+    std::vector<std::pair<int, int>> ranges;
+    for (int from = 0; from < size;) {
+        int to = -1;
+        if (size - from > Constants::kSearchChunkSize) {
+            to = text.indexOf('\n', from + Constants::kSearchChunkSize);
+        }
+        to = (to == -1 ? size : to + 1);
+        ranges.emplace_back(from, to);
+        from = to;
+    }
+
+    // The workers take the chunks in turn, and the matches are posted in order of the chunks.
+    std::vector<std::shared_ptr<TextMatches>> results(ranges.size());
+    std::atomic<size_t> nextRange{0};
+    std::mutex mutex;
+    std::condition_variable found;
+    auto work = [&]() {
+        for (auto index = nextRange++; index < ranges.size() && !canceled_; index = nextRange++) {
+            auto matches = std::make_shared<TextMatches>();
+            (void)find(text, ranges[index].first, ranges[index].second, *matches);
+            std::lock_guard<std::mutex> lock(mutex);
+            results[index] = std::move(matches);
+            found.notify_one();
+        }
+        // Wake up to check the cancellation.
+        std::lock_guard<std::mutex> lock(mutex);
+        found.notify_one();
+    };
+    std::vector<std::thread> workers;
+    const auto workerCount = std::min<size_t>(std::max(QThread::idealThreadCount(), 1), ranges.size());
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back(work);
+    }
+    for (size_t index = 0; index < ranges.size(); ++index) {
+        std::shared_ptr<TextMatches> matches;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            found.wait(lock, [&]() { return results[index] != nullptr || canceled_; });
+            matches = std::move(results[index]);
+        }
+        if (canceled_) {
             break;
         }
+        PostFound(findId, matches, static_cast<int>(100LL * ranges[index].second / size));
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    if (size == 0) {
+        PostFound(findId, std::make_shared<TextMatches>(), 100);
     }
-    editView()->setTextCursor(savedCursor);
-    return cursors;
+    return !canceled_;
 }
 
-std::vector<int> Searcher::FindAllLineNum(const QString &target) {
-    std::vector<int> lineNums;
-    if (editView() == nullptr) {
-        return lineNums;
+void Searcher::PostFound(int findId, const std::shared_ptr<TextMatches> &matches, int progress) {
+    QMetaObject::invokeMethod(
+        this,
+        [this, findId, matches, progress]() {
+            if (findId == findId_) {
+                emit sigFound(*matches, progress);
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+// Value of the single char escaped at 'pos', after the '\', or -1 if not a single char. 'length' is set to the
+// chars after the '\'.
+static int EscapedChar(const QString &pattern, int pos, int &length) {
+    length = 1;
+    const auto ch = pattern[pos];
+    if (!ch.isLetterOrNumber()) {
+        return ch.unicode();
+    }
+    switch (ch.unicode()) {
+        case 'a':
+            return 0x07;
+        case 'e':
+            return 0x1B;
+        case 'f':
+            return 0x0C;
+        case 'n':
+            return '\n';
+        case 'r':
+            return '\r';
+        case 't':
+            return '\t';
+        case 'x': {
+            // \xhh or \x{hhh..}.
+            auto isHex = [](QChar ch) { return ch.isDigit() || (ch.toLower() >= 'a' && ch.toLower() <= 'f'); };
+            bool braced = (pos + 1 < pattern.size() && pattern[pos + 1] == '{');
+            int start = pos + (braced ? 2 : 1);
+            int end = start;
+            while (end < pattern.size() && (braced || end < start + 2) && isHex(pattern[end])) {
+                ++end;
+            }
+            if (braced && (end >= pattern.size() || pattern[end] != '}')) {
+                return -1;
+            }
+            length = end - pos + (braced ? 1 : 0);
+            return end == start ? 0 : pattern.mid(start, end - start).toInt(nullptr, 16);
+        }
+        default:
+            return -1;
     }
+}
 
-    // Force options.
-    setCheckBoxFindMatchCase(true);
-    setRadioButtonFindNormal(true);
+// Whether the escape at 'pos', after the '\', never matches '\n' nor depends on the text ends.
+static bool IsLineLocalEscape(const QString &pattern, int pos, bool inClass, int &length) {
+    auto value = EscapedChar(pattern, pos, length);
+    if (value != -1) {
+        return value != '\n';
+    }
+    const auto ch = pattern[pos].unicode();
+    const auto next = (pos + 1 < pattern.size() ? pattern[pos + 1] : QChar());
+    // Digits, horizontal spaces, word chars, and not newline.
+    if (ch == 'd' || ch == 'h' || ch == 'w' || (!inClass && ch == 'N' && next != '{')) {
+        return true;
+    }
+    if (inClass) {
+        return false;
+    }
+    // Word boundaries, and the back references which match the same as the groups.
+    if (ch == 'b' || ch == 'B' || ch == 'g' || ch == 'k') {
+        return true;
+    }
+    // \1 to \9 are always back references, but \12 may be an octal escape.
+    return ch >= '1' && ch <= '9' && !next.isDigit();
+}
 
-    QTextCursor savedCursor = editView()->textCursor();
-    QTextCursor cursor = editView()->textCursor();
-    cursor.movePosition(QTextCursor::Start, QTextCursor::MoveAnchor);
-    int firstStart = -1;
-    while (true) {
-        cursor = FindNext(target, cursor);
-        if (!cursor.isNull()) {
-            if (cursor.selectionStart() == firstStart) {
-                break;
+// Parse the char class at 'pos', after the '['. Return the position after the ']', or -1 if it may match '\n'.
+static int ParseLineLocalClass(const QString &pattern, int pos) {
+    static const QSet<QString> posixClasses = {"alnum", "alpha", "blank", "digit", "graph", "lower",
+                                               "print", "punct", "upper", "word",  "xdigit"};
+    const int size = pattern.size();
+    // The negated class matches '\n'.
+    if (pos < size && pattern[pos] == '^') {
+        return -1;
+    }
+    bool first = true;
+    int last = -1;  // The last single char, to check the range.
+    while (pos < size) {
+        const auto ch = pattern[pos];
+        if (ch == ']' && !first) {
+            return pos + 1;
+        }
+        first = false;
+        int value = -1;
+        if (ch == '[' && pos + 1 < size && pattern[pos + 1] == ':') {
+            auto end = pattern.indexOf(":]", pos + 2);
+            if (end == -1 || !posixClasses.contains(pattern.mid(pos + 2, end - pos - 2))) {
+                return -1;
+            }
+            pos = end + 2;
+        } else if (ch == '\\') {
+            int length;
+            if (pos + 1 >= size || !IsLineLocalEscape(pattern, pos + 1, true, length)) {
+                return -1;
+            }
+            value = EscapedChar(pattern, pos + 1, length);
+            pos += 1 + length;
+        } else if (ch == '-' && last != -1 && pos + 1 < size && pattern[pos + 1] != ']') {
+            // A range covering '\n', e.g. [\t-\r].
+            int high = pattern[pos + 1].unicode();
+            int length = 1;
+            if (high == '\\') {
+                high = (pos + 2 < size ? EscapedChar(pattern, pos + 2, length) : -1);
+                ++length;
             }
-            if (firstStart == -1) {
-                firstStart = cursor.selectionStart();
+            if (high == -1 || (last <= '\n' && high >= '\n')) {
+                return -1;
             }
-            const auto lineNum = editView()->LineNumber(cursor);
-            qDebug() << "cursor: " << cursor.position() << cursor.blockNumber() << cursor.block().firstLineNumber()
-                     << lineNum << cursor.block().text();
-            lineNums.emplace_back(lineNum);
+            pos += 1 + length;
         } else {
-            break;
+            value = ch.unicode();
+            ++pos;
+        }
+        if (value == '\n') {
+            return -1;
+        }
+        last = value;
+    }
+    return -1;
+}
+
+bool Searcher::IsLineLocal(const QString &pattern) {
+    // Only the constructs proven not to match '\n' are allowed, the others may match over lines.
+    // The anchors of the text ends and the modifiers out of the multiline mode are not allowed either.
+    const int size = pattern.size();
+    int pos = 0;
+    while (pos < size) {
+        const auto ch = pattern[pos];
+        if (ch == '\n') {
+            return false;
+        }
+        if (ch == '\\') {
+            int length;
+            if (pos + 1 >= size || !IsLineLocalEscape(pattern, pos + 1, false, length)) {
+                return false;
+            }
+            pos += 1 + length;
+            continue;
+        }
+        if (ch == '[') {
+            pos = ParseLineLocalClass(pattern, pos + 1);
+            if (pos == -1) {
+                return false;
+            }
+            continue;
+        }
+        if (ch == '(' && pos + 1 < size && pattern[pos + 1] == '*') {
+            // The verbs may change the newline convention.
+            return false;
         }
+        if (ch == '(' && pos + 1 < size && pattern[pos + 1] == '?') {
+            pos += 2;
+            if (pos < size && pattern[pos] == '#') {
+                auto end = pattern.indexOf(')', pos);
+                if (end == -1) {
+                    return false;
+                }
+                pos = end + 1;
+                continue;
+            }
+            // The option settings, (?s), (?-m) and (?^) change the lines.
+            int end = pos;
+            while (end < size && (pattern[end].isLetter() || pattern[end] == '-' || pattern[end] == '^')) {
+                ++end;
+            }
+            if (end < size && (pattern[end] == ')' || pattern[end] == ':')) {
+                bool unset = false;
+                for (int i = pos; i < end; ++i) {
+                    if (pattern[i] == '^' || (!unset && pattern[i] == 's') || (unset && pattern[i] == 'm')) {
+                        return false;
+                    }
+                    unset = unset || pattern[i] == '-';
+                }
+                pos = end;
+            }
+            continue;
+        }
+        ++pos;
+    }
+    return true;
+}
+
+void Searcher::CancelFindAll() {
+    canceled_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    canceled_ = false;
+    if (findingAll_) {
+        findingAll_ = false;
+        ++findId_;
+        emit sigFindAllFinished(true);
+    }
+}
+
+void Searcher::HandleFindAllFinished(int findId) {
+    if (findId != findId_) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    findingAll_ = false;
+    emit sigFindAllFinished(false);
+}
+
+TextMatches Searcher::FindAll(const QString &target) {
+    TextMatches matches;
+    if (editView() == nullptr) {
+        return matches;
     }
-    editView()->setTextCursor(savedCursor);
-    return lineNums;
+    const auto text = editView()->document()->toPlainText();
+    (void)MakeFindFunction(target)(text, 0, text.size(), matches);
+    return matches;
 }
 
 // Replace 'target' with 'text'.
@@ -925,13 +1358,16 @@ int Searcher::ReplaceAll(const QString &target, const QString &text) {
     // Reserve the original cursor firstly.
     QTextCursor originalCursor = editView()->textCursor();
 
-    // To replace all targets.
-    editView()->textCursor().beginEditBlock();
+    // To replace all targets, from the last not to move the positions before.
     auto res = FindAll(target);
-    for (auto it = res.rbegin(); it != res.rend(); ++it) {
-        it->insertText(extendedText);
+    QTextCursor cursor(editView()->document());
+    cursor.beginEditBlock();
+    for (auto it = res.crbegin(); it != res.crend(); ++it) {
+        cursor.setPosition(it->first);
+        cursor.setPosition(it->first + it->second, QTextCursor::KeepAnchor);
+        cursor.insertText(extendedText);
     }
-    editView()->textCursor().endEditBlock();
+    cursor.endEditBlock();
 
     editView()->setTextCursor(originalCursor);
     return res.size();
@@ -15,90 +15,116 @@
  */
 
 #include "SearchResultList.h"
+#include "LargeFileView.h"
 #include "Logger.h"
 #include "MainTabView.h"
 #include "MainWindow.h"
-#include "SearchResultItem.h"
 #include <QApplication>
 #include <QClipboard>
 #include <QHeaderView>
-#include <QHelpEvent>
-#include <QLabel>
-#include <QLineEdit>
-#include <QPlainTextEdit>
-#include <QStyleFactory>
-#include <QTextEdit>
-#include <QToolTip>
+#include <QMenu>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <algorithm>
+#include <memory>
 
 namespace QEditor {
-void HtmlDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const {
+void SearchResultDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                                 const QModelIndex &index) const {
     QStyleOptionViewItem itemOption = option;
     initStyleOption(&itemOption, index);
-
-    qDebug() << itemOption.widget << itemOption.widget->style();
     QStyle *style = itemOption.widget ? itemOption.widget->style() : QApplication::style();
 
-    QTextDocument doc;
-    doc.setHtml(itemOption.text);
-
     // Painting item without text
     itemOption.text = QString();
-    // stackoverflow.com/questions/19635281/qlistview-stylesheet-not-working-with-delegate
     style->drawControl(QStyle::CE_ItemViewItem, &itemOption, painter, itemOption.widget);
 
-    // Highlighting text if item is selected
-    QAbstractTextDocumentLayout::PaintContext ctx;
-    if (itemOption.state & QStyle::State_Selected) {
-        ctx.palette.setColor(QPalette::Text, itemOption.palette.color(QPalette::Active, QPalette::HighlightedText));
-    }
-
-    QRect textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &itemOption);
+    // Only the parts in the visible width.
+    const auto textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &itemOption, itemOption.widget);
+    const QFontMetrics metrics(itemOption.font);
     painter->save();
-    painter->translate(textRect.topLeft());
-    painter->setClipRect(textRect.translated(-textRect.topLeft()));
-    doc.documentLayout()->draw(painter, ctx);
+    painter->setFont(itemOption.font);
+    painter->setClipRect(textRect);
+    int x = textRect.left();
+    for (const auto &part : Parts(index)) {
+        if (x > textRect.right()) {
+            break;
+        }
+        painter->setPen(part.second);
+        painter->drawText(QRect(x, textRect.top(), textRect.right() - x + 1, textRect.height()),
+                          Qt::AlignLeft | Qt::AlignVCenter | Qt::TextSingleLine, part.first);
+        x += metrics.horizontalAdvance(part.first);
+    }
     painter->restore();
 }
 
-QSize HtmlDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const {
+QSize SearchResultDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const {
     QStyleOptionViewItem itemOption = option;
     initStyleOption(&itemOption, index);
+    const QFontMetrics metrics(itemOption.font);
+    int width = 0;
+    for (const auto &part : Parts(index)) {
+        width += metrics.horizontalAdvance(part.first);
+    }
+    return QSize(width, metrics.height() + 6);
+}
 
-    QTextDocument doc;
-    doc.setHtml(itemOption.text);
-    const auto plainText = doc.toPlainText();
-    qDebug() << "itemOption.text: " << itemOption.text << ", doc.toPlainText: " << doc.toPlainText()
-             << ", index: " << index.row() << index.column() << index.data() << ", doc width: " << doc.idealWidth()
-             << doc.textWidth() << itemOption.rect.width();
-    const auto width = QFontMetricsF(option.widget->font()).horizontalAdvance(plainText, -1);
-    return QSize(width, doc.size().height());
+std::vector<std::pair<QString, QColor>> SearchResultDelegate::Parts(const QModelIndex &index) const {
+    const auto &text = index.data().toString();
+    switch (index.data(SearchResultModel::kKindRole).toInt()) {
+        case SearchResultModel::kTop:
+            return {{text, QColor(0xC3, 0xAE, 0x8B)}};
+        case SearchResultModel::kSession:
+            if (index.data(SearchResultModel::kSuspendedRole).toBool()) {
+                return {{text, QColor(0xE3, 0xCE, 0xAB)}, {"  " + tr("[Suspended]"), QColor(0xFF, 0xA0, 0xA0)}};
+            }
+            return {{text, QColor(0xE3, 0xCE, 0xAB)}};
+        case SearchResultModel::kFile:
+            return {{text, QColor(0xC3, 0xAE, 0x8B)}};
+        default:
+            break;
+    }
+    // The tabs are expanded in each part, not to measure them by the position.
+    auto expand = [](QString part) { return part.replace('\t', "    "); };
+    const QColor textColor(0xBE, 0xBE, 0xBE);
+    const auto highlight = index.data(SearchResultModel::kHighlightRole).toPoint();
+    if (index.data(SearchResultModel::kRemovedRole).toBool()) {
+        return {{tr("Line "), textColor},
+                {QString::number(index.data(SearchResultModel::kLineRole).toInt()), QColor(0x28, 0x91, 0xAF)},
+                {":  ", textColor},
+                {tr("[Removed]"), QColor(0xFF, 0xA0, 0xA0)}};
+    }
+    return {{tr("Line "), textColor},
+            {QString::number(index.data(SearchResultModel::kLineRole).toInt()), QColor(0x28, 0x91, 0xAF)},
+            {":  ", textColor},
+            {expand(text.left(highlight.x())), textColor},
+            {expand(text.mid(highlight.x(), highlight.y())), QColor(0xBC, 0xE0, 0x8C)},
+            {expand(text.mid(highlight.x() + highlight.y())), textColor}};
 }
 
 SearchResultList::SearchResultList(TabView *tabView)
-    : QTreeWidget(&MainWindow::Instance()), tabView_(tabView), menu_(new QMenu(this)) {
-    // setHeaderLabel("Result...");
+    : QTreeView(&MainWindow::Instance()),
+      tabView_(tabView),
+      model_(new SearchResultModel(this)),
+      menu_(new QMenu(this)) {
     // setStyle(QStyleFactory::create("windows"));
     SetQss();
-    // setRootIsDecorated(false);
+    setModel(model_);
     setHeaderHidden(true);
     setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    // Not to measure each row.
+    setUniformRowHeights(true);
 
     QHeaderView *headerView = header();
-    // headerView->setSectionResizeMode(QHeaderView::ResizeToContents);
-    // headerView->setStretchLastSection(false);
     headerView->setSectionResizeMode(QHeaderView::Stretch);
 
-    clear();
-
     setIndentation(15);
 
-    connect(this, &QTreeWidget::itemDoubleClicked, this, &SearchResultList::HandleItemDoubleClicked);
-    connect(this, &QTreeWidget::itemClicked, this, &SearchResultList::HandleItemClicked);
+    connect(this, &QTreeView::doubleClicked, this, &SearchResultList::HandleIndexDoubleClicked);
 
-    // Create custom delegate
-    QEditor::HtmlDelegate *delegate = new HtmlDelegate();
-    // Set delegate to the treeview object
-    setItemDelegate(delegate);
+    setItemDelegate(new SearchResultDelegate(this));
+    expand(model_->topIndex());
 }
 
 void SearchResultList::SetQss() {
@@ -132,51 +158,68 @@ void SearchResultList::SetQss() {
         "QMenu::separator{height:1px; background-color:rgb(80,80,80);}");
 }
 
-void SearchResultList::setTopItem(QTreeWidgetItem *topItem) { topItem_ = topItem; }
-
-QTreeWidgetItem *SearchResultList::topItem() {
-    if (topItem_ == nullptr) {
-        topItem_ = new SearchResultItem();
-        addTopLevelItem(topItem_);
+void SearchResultList::HandleIndexDoubleClicked(const QModelIndex &index) {
+    const SearchResultModel::Group *group = nullptr;
+    const auto hit = model_->hit(index, &group);
+    if (hit == nullptr) {
+        return;
     }
-    return topItem_;
-}
-
-void SearchResultList::HandleItemDoubleClicked(QTreeWidgetItem *item, int column) {
-    qDebug() << ", " << item << ", col: " << column;
-    auto searchItem = (SearchResultItem *)item;
-    auto editView = searchItem->editView();
+    if (group->kind_ == SearchResultModel::kFile) {
+        tabView_->OpenFile(group->filePath_);
+        // A file over the large file size opens in the large file view, which goes to the line after indexed.
+        auto largeFileView = MainWindow::Instance().largeFileView();
+        if (largeFileView != nullptr) {
+            largeFileView->GotoLine(hit->line_);
+            return;
+        }
+        auto editView = MainWindow::Instance().editView();
+        if (editView == nullptr) {
+            return;
+        }
+        const auto line = hit->line_;
+        const auto column = hit->offset_;
+        const auto length = hit->length_;
+        if (editView->fileLoaded()) {
+            SelectInLine(editView, line, column, length);
+            return;
+        }
+        // Loaded in background, select once the text is complete.
+        auto connection = std::make_shared<QMetaObject::Connection>();
+        *connection =
+            connect(editView, &EditView::sigFileLoaded, this, [editView, line, column, length, connection]() {
+                QObject::disconnect(*connection);
+                SelectInLine(editView, line, column, length);
+            });
+        return;
+    }
+    auto editView = group->editView_;
     if (editView == nullptr) {
         qDebug() << "editView_ is null";
         return;
     }
+    const auto position = model_->Position(index);
+    if (position == -1) {
+        return;
+    }
     tabView_->setCurrentWidget(editView);
-    auto cursor = editView->textCursor();
     // Move to the position and select the searched text.
-    cursor.setPosition(searchItem->position());
-    for (int i = 0; i < searchItem->len(); ++i) {
-        cursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor);
-    }
+    auto cursor = editView->textCursor();
+    cursor.setPosition(position);
+    cursor.setPosition(std::min(position + hit->length_, editView->document()->characterCount() - 1),
+                       QTextCursor::KeepAnchor);
     editView->GotoCursor(cursor);
 }
 
-void SearchResultList::HandleItemClicked(QTreeWidgetItem *item, int column) {
-    // item->setBackgroundColor(0, QColor(255, 71, 255));
-}
-
-bool SearchResultList::event(QEvent *event) {
-    qDebug() << event->type();
-    if (event->type() == QEvent::ToolTip) {
-        QHelpEvent *helpEvent = static_cast<QHelpEvent *>(event);
-        auto item = itemAt(helpEvent->pos());
-        if (item != nullptr) {
-            qDebug() << item->toolTip(0);
-            QToolTip::showText(helpEvent->globalPos(), item->toolTip(0));
-        } else {
-            event->ignore();
-        }
+void SearchResultList::SelectInLine(EditView *editView, int line, int column, int length) {
+    const auto block = editView->document()->findBlockByNumber(line);
+    if (!block.isValid()) {
+        return;
     }
-    return QTreeWidget::event(event);
+    auto cursor = editView->textCursor();
+    cursor.setPosition(block.position() + std::min(column, block.length() - 1));
+    cursor.setPosition(std::min(cursor.position() + length, block.position() + block.length() - 1),
+                       QTextCursor::KeepAnchor);
+    editView->GotoCursor(cursor);
 }
 
 void SearchResultList::contextMenuEvent(QContextMenuEvent *event) {
@@ -184,7 +227,7 @@ void SearchResultList::contextMenuEvent(QContextMenuEvent *event) {
     QAction *collapseAllAction = new QAction(tr("Collapse All"));
     connect(collapseAllAction, &QAction::triggered, this, [this]() {
         collapseAll();
-        topItem()->setExpanded(true);
+        expand(model_->topIndex());
     });
     menu_->addAction(collapseAllAction);
     QAction *expandAllAction = new QAction(tr("Expand All"));
@@ -195,9 +238,9 @@ void SearchResultList::contextMenuEvent(QContextMenuEvent *event) {
     QAction *copySelectedAction = new QAction(tr("Copy Selected"));
     connect(copySelectedAction, &QAction::triggered, this, [this]() {
         QString text;
-        const auto items = selectedItems();
-        for (const auto &item : items) {
-            text += item->toolTip(0) + '\n';
+        const auto indexes = selectionModel()->selectedIndexes();
+        for (const auto &index : indexes) {
+            text += model_->PlainText(index) + '\n';
         }
         QClipboard *clipboard = QGuiApplication::clipboard();
         clipboard->setText(text);
@@ -205,52 +248,36 @@ void SearchResultList::contextMenuEvent(QContextMenuEvent *event) {
     menu_->addAction(copySelectedAction);
     QAction *copyAllAction = new QAction(tr("Copy All"));
     connect(copyAllAction, &QAction::triggered, this, [this]() {
-        QString text;
-        for (int i = 0; i < topItem()->childCount(); ++i) {
-            const auto sessionItem = topItem()->child(i);
-            text += sessionItem->toolTip(0) + "\n";
-            for (int j = 0; j < sessionItem->childCount(); ++j) {
-                const auto item = sessionItem->child(j);
-                qDebug() << item->toolTip(0);
-                text += "    " + item->toolTip(0) + '\n';
-            }
-            text += '\n';
-        }
         QClipboard *clipboard = QGuiApplication::clipboard();
-        clipboard->setText(text);
+        clipboard->setText(model_->AllPlainText());
     });
     menu_->addAction(copyAllAction);
 
     menu_->addSeparator();
+    const QPersistentModelIndex index = indexAt(event->pos());
     QAction *clearSelectedItemAction = new QAction(tr("Clear Selected"));
-    connect(clearSelectedItemAction, &QAction::triggered, this, [&event, this]() {
-        auto item = itemAt(event->pos());
-        if (item == nullptr) {
-            return;
-        }
-        if (item->parent() != nullptr) {
-            item->parent()->removeChild(item);
+    connect(clearSelectedItemAction, &QAction::triggered, this, [index, this]() {
+        if (index.isValid() && index.parent().isValid()) {
+            model_->Remove(index);
         }
     });
     menu_->addAction(clearSelectedItemAction);
     QAction *clearSelectedResultAction = new QAction(tr("Clear Containing Result"));
-    connect(clearSelectedResultAction, &QAction::triggered, this, [&event, this]() {
-        auto item = itemAt(event->pos());
-        if (item == nullptr) {
+    connect(clearSelectedResultAction, &QAction::triggered, this, [index, this]() {
+        if (!index.isValid() || !index.parent().isValid()) {
             return;
         }
-        qDebug() << "item: " << item->toolTip(0);
-        while (item->parent() != topItem()) {
-            item = item->parent();
-            qDebug() << "item: " << item->toolTip(0);
+        QModelIndex session = index;
+        while (session.parent() != model_->topIndex()) {
+            session = session.parent();
         }
-        topItem()->removeChild(item);
+        model_->Remove(session);
     });
     menu_->addAction(clearSelectedResultAction);
     QAction *clearAllAction = new QAction(tr("Clear All"));
     connect(clearAllAction, &QAction::triggered, this, [this]() {
-        clear();
-        setTopItem(nullptr);
+        model_->Clear();
+        expand(model_->topIndex());
     });
     menu_->addAction(clearAllAction);
 
@@ -268,55 +295,49 @@ void SearchResultList::mousePressEvent(QMouseEvent *event) {
     } else {
         setSelectionMode(SelectionMode::SingleSelection);
     }
-    QTreeWidget::mousePressEvent(event);
+    QTreeView::mousePressEvent(event);
 }
 
-QTreeWidgetItem *SearchResultList::StartSearchSession(EditView *editView) {
-    editView_ = editView;
-    const QString &title = editView->fileName();
-    SearchResultItem *sessionItem = new SearchResultItem();
-    sessionItem->setText(0, QString("<div style=\"font-size:14px;font-family:Consolas;color:#E3CEAB\">") +
-                                tr("Searching ") + title + QString("</div>"));
-    topItem()->insertChild(0, sessionItem);
-    return sessionItem;
-}
+int SearchResultList::StartSearchSession(EditView *editView) { return model_->StartSession(editView); }
 
-void SearchResultList::AddSearchResult(QTreeWidgetItem *sessionItem, const int lineNum, const QString &htmlText,
-                                       const QString &plainText, const QTextCursor &cursor) {
-    SearchResultItem *searchItem = new SearchResultItem(editView_);
-    searchItem->setText(0, htmlText);
-    searchItem->setToolTip(0, plainText);
-    searchItem->setPosition(cursor.selectionStart());
-    searchItem->setLen(cursor.selectionEnd() - cursor.selectionStart());
-    searchItem->setLine(lineNum);
-    sessionItem->addChild(searchItem);
+void SearchResultList::AddSearchResults(int sessionId, const TextMatches &matches) {
+    model_->AddHits(sessionId, matches);
 }
 
-void SearchResultList::FinishSearchSession(QTreeWidgetItem *sessionItem, const QString &target, int matchCount,
-                                           bool finished) {
+void SearchResultList::FinishSearchSession(int sessionId, const QString &target, int matchCount, bool finished) {
     // Update current session's search info.
-    const QString &fileName = editView_->fileName();
+    const auto group = model_->group(model_->sessionIndex(sessionId));
+    if (group == nullptr) {
+        return;
+    }
+    const auto fileName = (group->editView_ == nullptr ? QString() : group->editView_->fileName());
     const auto title =
         fileName + " " + QString(tr("(Search ")) + "\"" + target + "\": " + QString::number(matchCount) + tr(" hits)");
-    auto html =
-        QString("<div style=\"font-size:14px;font-family:Consolas;color:#E3CEAB\">") + title + QString("</div>");
-    if (!finished) {
-        html += QString("<div style=\"font-size:14px;font-family:Consolas;color:#FFA0A0\">");
-        html += tr("[Suspended]");
-        html += QString("</div>");
-    }
-    sessionItem->setToolTip(0, title);
-    sessionItem->setText(0, html);
-    expandItem(sessionItem);
-    setCurrentItem(sessionItem);
+    model_->FinishSession(sessionId, title, finished);
+    ShowSession(sessionId);
+}
 
-    // Update header's total result count.
-    auto info = QString::number(topItem()->childCount()) + tr(" results:");
-    auto htmlText =
-        QString("<div style=\"font-size:15px;font-family:Consolas;color:#C3AE8B\">") + info + QString("</div>");
-    topItem()->setText(0, htmlText);
+int SearchResultList::StartFilesSearchSession(const QString &rootPath) { return model_->StartFilesSession(rootPath); }
 
-    // header()->resizeSection(0, minimumWidth());
-    resizeColumnToContents(0);
+void SearchResultList::AddFileSearchResults(int sessionId, const std::vector<FileSearcher::FileMatches> &batch) {
+    model_->AddFiles(sessionId, batch);
+}
+
+void SearchResultList::FinishFilesSearchSession(int sessionId, const QString &rootPath, const QString &target,
+                                                int matchCount, int fileCount, bool finished) {
+    const auto title = rootPath + " " + QString(tr("(Search ")) + "\"" + target + "\": " + QString::number(matchCount) +
+                       tr(" hits in ") + QString::number(fileCount) + tr(" files)");
+    model_->FinishSession(sessionId, title, finished);
+    ShowSession(sessionId);
+}
+
+void SearchResultList::ShowSession(int sessionId) {
+    const auto &index = model_->sessionIndex(sessionId);
+    if (!index.isValid()) {
+        return;
+    }
+    expand(model_->topIndex());
+    expand(index);
+    setCurrentIndex(index);
 }
 }  // namespace QEditor
@@ -0,0 +1,424 @@
+/**
+ * Copyright 2022 QEditor QH
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "SearchResultModel.h"
+#include "Constants.h"
+#include <QPoint>
+#include <QTextBlock>
+#include <algorithm>
+
+namespace QEditor {
+SearchResultModel::SearchResultModel(QObject *parent) : QAbstractItemModel(parent) {
+    auto top = std::make_unique<Group>();
+    top->parent_ = &root_;
+    top_ = top.get();
+    root_.children_.emplace_back(std::move(top));
+}
+
+int SearchResultModel::StartSession(EditView *editView) {
+    auto session = std::make_unique<Group>();
+    session->kind_ = kSession;
+    session->editView_ = editView;
+    session->title_ = tr("Searching ") + editView->fileName();
+    // Shift the offsets instead of keeping a cursor for each hit.
+    const auto group = session.get();
+    session->connection_ = connect(editView->document(), &QTextDocument::contentsChange, this,
+                                   [this, group](int position, int charsRemoved, int charsAdded) {
+                                       group->offsets_.HandleContentsChange(position, charsRemoved, charsAdded);
+                                       if (group->fetchedCount_ > 0) {
+                                           const auto &parent = IndexOf(group);
+                                           const int first = static_cast<int>(group->children_.size());
+                                           emit dataChanged(index(first, 0, parent),
+                                                            index(first + group->fetchedCount_ - 1, 0, parent));
+                                       }
+                                   });
+    return AddSession(std::move(session));
+}
+
+int SearchResultModel::StartFilesSession(const QString &rootPath) {
+    auto session = std::make_unique<Group>();
+    session->kind_ = kSession;
+    session->title_ = tr("Searching in ") + rootPath;
+    return AddSession(std::move(session));
+}
+
+int SearchResultModel::AddSession(std::unique_ptr<Group> session) {
+    // The latest session is the first.
+    const auto sessionId = ++lastSessionId_;
+    sessions_.insert(sessionId, session.get());
+    session->parent_ = top_;
+    beginInsertRows(topIndex(), 0, 0);
+    top_->children_.insert(top_->children_.begin(), std::move(session));
+    for (size_t i = 0; i < top_->children_.size(); ++i) {
+        top_->children_[i]->row_ = static_cast<int>(i);
+    }
+    endInsertRows();
+    emit dataChanged(topIndex(), topIndex());
+    return sessionId;
+}
+
+void SearchResultModel::AddHits(int sessionId, const TextMatches &matches) {
+    auto session = sessions_.value(sessionId, nullptr);
+    if (session == nullptr || session->editView_ == nullptr) {
+        return;
+    }
+    const auto document = session->editView_->document();
+    session->hits_.reserve(session->hits_.size() + matches.size());
+    QTextBlock block;
+    for (const auto &match : matches) {
+        if (!block.isValid() || !block.contains(match.first)) {
+            block = document->findBlock(match.first);
+        }
+        session->hits_.emplace_back(Hit{block.blockNumber(), match.first, match.second});
+        session->offsets_.Append(match.first, match.second);
+    }
+    FetchFirstPage(session);
+}
+
+void SearchResultModel::AddFiles(int sessionId, const std::vector<FileSearcher::FileMatches> &batch) {
+    auto session = sessions_.value(sessionId, nullptr);
+    if (session == nullptr || batch.empty()) {
+        return;
+    }
+    const int first = static_cast<int>(session->children_.size());
+    beginInsertRows(IndexOf(session), first, first + static_cast<int>(batch.size()) - 1);
+    for (const auto &fileMatches : batch) {
+        auto file = std::make_unique<Group>();
+        file->kind_ = kFile;
+        file->parent_ = session;
+        file->row_ = static_cast<int>(session->children_.size());
+        file->title_ = fileMatches.filePath_ + " (" + QString::number(fileMatches.hits_.size()) + tr(" hits, ") +
+                       fileMatches.codecName_ + ")";
+        file->filePath_ = fileMatches.filePath_;
+        file->hits_.reserve(fileMatches.hits_.size());
+        file->lineTexts_ = fileMatches.lineTexts_;
+        file->lineTextIndexes_.reserve(fileMatches.hits_.size());
+        file->lineTextColumns_.reserve(fileMatches.hits_.size());
+        for (const auto &hit : fileMatches.hits_) {
+            file->hits_.emplace_back(Hit{hit.line_, hit.column_, hit.length_});
+            file->lineTextIndexes_.emplace_back(hit.lineTextIndex_);
+            file->lineTextColumns_.emplace_back(hit.lineTextColumn_);
+        }
+        file->fetchedCount_ = std::min(static_cast<int>(file->hits_.size()), Constants::kSearchResultFetchSize);
+        session->children_.emplace_back(std::move(file));
+    }
+    endInsertRows();
+}
+
+void SearchResultModel::FinishSession(int sessionId, const QString &title, bool finished) {
+    auto session = sessions_.value(sessionId, nullptr);
+    if (session == nullptr) {
+        return;
+    }
+    session->title_ = title;
+    session->finished_ = finished;
+    const auto &index = IndexOf(session);
+    emit dataChanged(index, index);
+}
+
+void SearchResultModel::FetchFirstPage(Group *group) {
+    const auto count = std::min(static_cast<int>(group->hits_.size()), Constants::kSearchResultFetchSize);
+    if (group->fetchedCount_ >= count) {
+        return;
+    }
+    const int first = static_cast<int>(group->children_.size()) + group->fetchedCount_;
+    beginInsertRows(IndexOf(group), first, static_cast<int>(group->children_.size()) + count - 1);
+    group->fetchedCount_ = count;
+    endInsertRows();
+}
+
+QModelIndex SearchResultModel::topIndex() const { return IndexOf(top_); }
+
+QModelIndex SearchResultModel::sessionIndex(int sessionId) const {
+    auto session = sessions_.value(sessionId, nullptr);
+    if (session == nullptr) {
+        return QModelIndex();
+    }
+    return IndexOf(session);
+}
+
+const SearchResultModel::Group *SearchResultModel::group(const QModelIndex &index) const {
+    if (!index.isValid()) {
+        return nullptr;
+    }
+    return GroupOf(index);
+}
+
+const SearchResultModel::Hit *SearchResultModel::hit(const QModelIndex &index, const Group **group) const {
+    if (!index.isValid()) {
+        return nullptr;
+    }
+    const auto parent = static_cast<const Group *>(index.internalPointer());
+    const int hitIndex = index.row() - static_cast<int>(parent->children_.size());
+    if (hitIndex < 0) {
+        return nullptr;
+    }
+    if (group != nullptr) {
+        *group = parent;
+    }
+    return &parent->hits_[hitIndex];
+}
+
+int SearchResultModel::Position(const QModelIndex &index) const {
+    const Group *parent = nullptr;
+    if (hit(index, &parent) == nullptr || parent->kind_ != kSession) {
+        return -1;
+    }
+    const int hitIndex = index.row() - static_cast<int>(parent->children_.size());
+    if (parent->offsets_.removed(hitIndex)) {
+        return -1;
+    }
+    return parent->offsets_.Offset(hitIndex);
+}
+
+QString SearchResultModel::PlainText(const QModelIndex &index) const {
+    const Group *parent = nullptr;
+    if (hit(index, &parent) == nullptr) {
+        return data(index).toString();
+    }
+    const int hitIndex = index.row() - static_cast<int>(parent->children_.size());
+    return tr("Line ") + QString::number(Line(parent, hitIndex) + 1) + ":  " + LineText(parent, hitIndex, nullptr);
+}
+
+QString SearchResultModel::AllPlainText() const {
+    QString text;
+    auto appendHits = [this, &text](const Group *group, const QString &indent) {
+        for (int i = 0; i < static_cast<int>(group->hits_.size()); ++i) {
+            text += indent + tr("Line ") + QString::number(Line(group, i) + 1) + ":  " + LineText(group, i, nullptr) +
+                    '\n';
+        }
+    };
+    for (const auto &session : top_->children_) {
+        text += session->title_ + '\n';
+        for (const auto &file : session->children_) {
+            text += "    " + file->title_ + '\n';
+            appendHits(file.get(), "        ");
+        }
+        appendHits(session.get(), "    ");
+        text += '\n';
+    }
+    return text;
+}
+
+void SearchResultModel::Remove(const QModelIndex &index) {
+    if (!index.isValid()) {
+        return;
+    }
+    const auto parent = static_cast<Group *>(index.internalPointer());
+    const int row = index.row();
+    const auto &parentIndex = IndexOf(parent);
+    const int childCount = static_cast<int>(parent->children_.size());
+    if (row < childCount) {
+        const auto group = parent->children_[row].get();
+        if (group == top_) {
+            Clear();
+            return;
+        }
+        for (auto iter = sessions_.begin(); iter != sessions_.end(); ++iter) {
+            if (iter.value() == group) {
+                sessions_.erase(iter);
+                break;
+            }
+        }
+        beginRemoveRows(parentIndex, row, row);
+        parent->children_.erase(parent->children_.begin() + row);
+        for (int i = row; i < childCount - 1; ++i) {
+            parent->children_[i]->row_ = i;
+        }
+        endRemoveRows();
+        if (parent == top_) {
+            emit dataChanged(topIndex(), topIndex());
+        }
+        return;
+    }
+
+    const int hitIndex = row - childCount;
+    beginRemoveRows(parentIndex, row, row);
+    parent->hits_.erase(parent->hits_.begin() + hitIndex);
+    if (parent->kind_ == kFile) {
+        // The line text may be shared by the other hits, kept.
+        parent->lineTextIndexes_.erase(parent->lineTextIndexes_.begin() + hitIndex);
+        parent->lineTextColumns_.erase(parent->lineTextColumns_.begin() + hitIndex);
+    } else {
+        parent->offsets_.Remove(hitIndex);
+    }
+    --parent->fetchedCount_;
+    endRemoveRows();
+}
+
+void SearchResultModel::Clear() {
+    beginResetModel();
+    top_->children_.clear();
+    sessions_.clear();
+    endResetModel();
+}
+
+QModelIndex SearchResultModel::index(int row, int column, const QModelIndex &parent) const {
+    if (!hasIndex(row, column, parent)) {
+        return QModelIndex();
+    }
+    auto group = GroupOf(parent);
+    if (group == nullptr) {
+        return QModelIndex();
+    }
+    // The pointer is of the parent, as the hits have no object.
+    return createIndex(row, column, group);
+}
+
+QModelIndex SearchResultModel::parent(const QModelIndex &index) const {
+    if (!index.isValid()) {
+        return QModelIndex();
+    }
+    return IndexOf(static_cast<const Group *>(index.internalPointer()));
+}
+
+int SearchResultModel::rowCount(const QModelIndex &parent) const {
+    if (parent.column() > 0) {
+        return 0;
+    }
+    auto group = GroupOf(parent);
+    if (group == nullptr) {
+        return 0;
+    }
+    return static_cast<int>(group->children_.size()) + group->fetchedCount_;
+}
+
+int SearchResultModel::columnCount(const QModelIndex &) const { return 1; }
+
+bool SearchResultModel::hasChildren(const QModelIndex &parent) const {
+    auto group = GroupOf(parent);
+    return group != nullptr && (!group->children_.empty() || !group->hits_.empty());
+}
+
+QVariant SearchResultModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid()) {
+        return QVariant();
+    }
+    const auto group = GroupOf(index);
+    if (group != nullptr) {
+        switch (role) {
+            case Qt::DisplayRole:
+            case Qt::ToolTipRole:
+                if (group == top_) {
+                    return QString::number(top_->children_.size()) + tr(" results:");
+                }
+                return group->title_;
+            case kKindRole:
+                return static_cast<int>(group->kind_);
+            case kSuspendedRole:
+                return !group->finished_;
+            default:
+                return QVariant();
+        }
+    }
+
+    const auto parent = static_cast<const Group *>(index.internalPointer());
+    const int hitIndex = index.row() - static_cast<int>(parent->children_.size());
+    switch (role) {
+        case Qt::DisplayRole:
+        case Qt::ToolTipRole:
+            return LineText(parent, hitIndex, nullptr);
+        case kKindRole:
+            return static_cast<int>(kHit);
+        case kLineRole:
+            return Line(parent, hitIndex) + 1;
+        case kHighlightRole: {
+            int column = 0;
+            (void)LineText(parent, hitIndex, &column);
+            return QPoint(column, parent->hits_[hitIndex].length_);
+        }
+        case kRemovedRole:
+            return parent->kind_ == kSession && parent->offsets_.removed(hitIndex);
+        default:
+            return QVariant();
+    }
+}
+
+bool SearchResultModel::canFetchMore(const QModelIndex &parent) const {
+    auto group = GroupOf(parent);
+    return group != nullptr && group->fetchedCount_ < static_cast<int>(group->hits_.size());
+}
+
+void SearchResultModel::fetchMore(const QModelIndex &parent) {
+    auto group = GroupOf(parent);
+    if (group == nullptr) {
+        return;
+    }
+    const auto count =
+        std::min(static_cast<int>(group->hits_.size()) - group->fetchedCount_, Constants::kSearchResultFetchSize);
+    if (count <= 0) {
+        return;
+    }
+    const int first = static_cast<int>(group->children_.size()) + group->fetchedCount_;
+    beginInsertRows(parent, first, first + count - 1);
+    group->fetchedCount_ += count;
+    endInsertRows();
+}
+
+SearchResultModel::Group *SearchResultModel::GroupOf(const QModelIndex &index) const {
+    if (!index.isValid()) {
+        return const_cast<Group *>(&root_);
+    }
+    const auto parent = static_cast<Group *>(index.internalPointer());
+    if (index.row() < static_cast<int>(parent->children_.size())) {
+        return parent->children_[index.row()].get();
+    }
+    return nullptr;
+}
+
+QModelIndex SearchResultModel::IndexOf(const Group *group) const {
+    if (group == &root_) {
+        return QModelIndex();
+    }
+    return createIndex(group->row_, 0, group->parent_);
+}
+
+int SearchResultModel::Line(const Group *group, int hitIndex) const {
+    if (group->kind_ == kFile || group->editView_ == nullptr) {
+        return group->hits_[hitIndex].line_;
+    }
+    return group->editView_->document()->findBlock(group->offsets_.Offset(hitIndex)).blockNumber();
+}
+
+QString SearchResultModel::LineText(const Group *group, int hitIndex, int *column) const {
+    if (group->kind_ == kFile) {
+        if (column != nullptr) {
+            *column = group->lineTextColumns_[hitIndex];
+        }
+        return group->lineTexts_[group->lineTextIndexes_[hitIndex]];
+    }
+    if (column != nullptr) {
+        *column = 0;
+    }
+    if (group->editView_ == nullptr) {
+        return QString();
+    }
+    const auto offset = group->offsets_.Offset(hitIndex);
+    const auto block = group->editView_->document()->findBlock(offset);
+    auto text = block.text();
+    auto start = 0;
+    if (text.size() > Constants::kMaxSearchResultLineLength) {
+        // A part around the match.
+        start = std::max(0, offset - block.position() - Constants::kMaxSearchResultLineLength / 4);
+        text = text.mid(start, Constants::kMaxSearchResultLineLength);
+    }
+    if (column != nullptr) {
+        *column = offset - block.position() - start;
+    }
+    return text;
+}
+}  // namespace QEditor
@@ -15,7 +15,10 @@
  */
 
 #include "TextHighlighter.h"
+#include "CapabilityManager.h"
+#include "Constants.h"
 #include "Logger.h"
+#include <QElapsedTimer>
 
 namespace QEditor {
 TextHighlighter::TextHighlighter(const FileType &fileType, QTextDocument *parent, const QString &focused_str,
@@ -384,6 +387,8 @@ void TextHighlighter::SetupCLang() {
 }
 
 void TextHighlighter::highlightBlock(const QString &text) {
+    QElapsedTimer timer;
+    timer.start();
     // Handle multiple lines regular firstly.
     if (commentStartExpressions_.size() != commentEndExpressions_.size()) {
         qFatal("Comments start and end expressions list must be equal");
@@ -442,5 +447,14 @@ void TextHighlighter::highlightBlock(const QString &text) {
             setFormat(match.capturedStart(), match.capturedLength(), rule.format);
         }
     }
+
+    // Record the cost of the blocks highlighted together.
+    measuredNsecs_ += timer.nsecsElapsed();
+    measuredChars_ += text.size() + 1;
+    if (measuredChars_ >= Constants::kCapabilityMinSampleChars) {
+        CapabilityManager::Record(CapabilityManager::kHighlighting, measuredChars_, measuredNsecs_);
+        measuredNsecs_ = 0;
+        measuredChars_ = 0;
+    }
 }
 }  // namespace QEditor